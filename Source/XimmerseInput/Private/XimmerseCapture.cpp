@@ -0,0 +1,204 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseCapture.h"
+#include "XimmerseDeviceRegistry.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Longest time in milliseconds the writer thread sleeps without checking for filled blocks */
+#define WRITER_WAIT_TIME	100
+
+FXimmerseCaptureWriter::FXimmerseCaptureWriter()
+	: NumBlocksFilled(0)
+	, NextRecordInBlock(0)
+	, NumBlocksWritten(0)
+	, StartTime(0.0)
+	, File(nullptr)
+	, BlockFilledEvent(nullptr)
+	, Thread(nullptr)
+{
+}
+
+FXimmerseCaptureWriter::~FXimmerseCaptureWriter()
+{
+	Close();
+}
+
+bool FXimmerseCaptureWriter::Open(const FString& Filename)
+{
+	Close();
+
+	File = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename);
+	if (File == nullptr)
+	{
+		return false;
+	}
+
+	FXimmerseCaptureFileHeader Header;
+	Header.Magic = XIMMERSE_CAPTURE_MAGIC;
+	Header.Version = XIMMERSE_CAPTURE_VERSION;
+	Header.RecordSize = sizeof(FXimmerseCaptureRecord);
+	Header.Reserved = 0;
+	File->Write((const uint8*)&Header, sizeof(Header));
+
+	// everything Append touches is allocated up front
+	Records.SetNumUninitialized(NumBlocks * RecordsPerBlock);
+	NumBlocksFilled = 0;
+	NextRecordInBlock = 0;
+	NumBlocksWritten = 0;
+	NumDroppedRecords.Reset();
+	StartTime = FPlatformTime::Seconds();
+
+	bStopRequested = false;
+	BlockFilledEvent = FPlatformProcess::GetSynchEventFromPool();
+	Thread = FRunnableThread::Create(this, TEXT("XimmerseCaptureWriter"), 0, TPri_BelowNormal);
+
+	FPlatformMisc::MemoryBarrier();
+	bRecording = true;
+	return true;
+}
+
+void FXimmerseCaptureWriter::Close()
+{
+	if (File == nullptr)
+	{
+		return;
+	}
+
+	// once no append is in flight the producer side belongs to us
+	bRecording = false;
+	while (NumAppending.GetValue() > 0)
+	{
+		FPlatformProcess::Yield();
+	}
+
+	Thread->Kill(true);
+	delete Thread;
+	Thread = nullptr;
+
+	FPlatformProcess::ReturnSynchEventToPool(BlockFilledEvent);
+	BlockFilledEvent = nullptr;
+
+	// the writer thread has written every full block, only the partial one is left
+	File->Write((const uint8*)GetBlock(NumBlocksFilled), NextRecordInBlock * sizeof(FXimmerseCaptureRecord));
+	delete File;
+	File = nullptr;
+
+	if (NumDroppedRecords.GetValue() > 0)
+	{
+		UE_LOG(LogXimmerseInput, Warning, TEXT("Dropped %d samples while capturing, the capture writer could not keep up"), NumDroppedRecords.GetValue());
+	}
+
+	Records.Empty();
+}
+
+void FXimmerseCaptureWriter::Append(int32 DeviceIndex, int32 TrackingResult, const ControllerState& State, double SampleTime)
+{
+	NumAppending.Increment();
+
+	if (bRecording)
+	{
+		// the block being filled is still queued for writing when the writer thread fell a whole ring behind
+		if (NumBlocksFilled - NumBlocksWritten >= NumBlocks)
+		{
+			NumDroppedRecords.Increment();
+		}
+		else
+		{
+			FXimmerseCaptureRecord& Record = GetBlock(NumBlocksFilled)[NextRecordInBlock];
+			Record.Time = SampleTime - StartTime;
+			Record.DeviceIndex = DeviceIndex;
+			Record.TrackingResult = TrackingResult;
+			Record.State = State;
+
+			if (++NextRecordInBlock == RecordsPerBlock)
+			{
+				NextRecordInBlock = 0;
+				FPlatformAtomics::InterlockedIncrement(&NumBlocksFilled);
+				BlockFilledEvent->Trigger();
+			}
+		}
+	}
+
+	NumAppending.Decrement();
+}
+
+uint32 FXimmerseCaptureWriter::Run()
+{
+	while (!bStopRequested)
+	{
+		BlockFilledEvent->Wait(WRITER_WAIT_TIME);
+		WriteFilledBlocks();
+	}
+
+	WriteFilledBlocks();
+	return 0;
+}
+
+void FXimmerseCaptureWriter::Stop()
+{
+	bStopRequested = true;
+	BlockFilledEvent->Trigger();
+}
+
+void FXimmerseCaptureWriter::WriteFilledBlocks()
+{
+	while (NumBlocksWritten < NumBlocksFilled)
+	{
+		// the block is complete once the counter moved past it
+		FPlatformMisc::MemoryBarrier();
+		File->Write((const uint8*)GetBlock(NumBlocksWritten), RecordsPerBlock * sizeof(FXimmerseCaptureRecord));
+
+		// hand the block back to the producer only after it is on its way to disk
+		FPlatformAtomics::InterlockedIncrement(&NumBlocksWritten);
+	}
+}
+
+bool FXimmerseCaptureReader::Load(const FString& Filename, float InSpeed, double InStartTime)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename) || Data.Num() < (int32)sizeof(FXimmerseCaptureFileHeader))
+	{
+		return false;
+	}
+
+	const FXimmerseCaptureFileHeader& Header = *(const FXimmerseCaptureFileHeader*)Data.GetData();
+	if (Header.Magic != XIMMERSE_CAPTURE_MAGIC || Header.Version != XIMMERSE_CAPTURE_VERSION || Header.RecordSize != sizeof(FXimmerseCaptureRecord))
+	{
+		return false;
+	}
+
+	const int32 NumRecords = (int32)((Data.Num() - sizeof(FXimmerseCaptureFileHeader)) / sizeof(FXimmerseCaptureRecord));
+	Records.SetNumUninitialized(NumRecords);
+	FMemory::Memcpy(Records.GetData(), Data.GetData() + sizeof(FXimmerseCaptureFileHeader), NumRecords * sizeof(FXimmerseCaptureRecord));
+
+	// the slot of every record becomes a controller slot, a corrupt file must not reach the registry
+	for (int32 RecordIndex = 0; RecordIndex < NumRecords; ++RecordIndex)
+	{
+		const int32 DeviceIndex = Records[RecordIndex].DeviceIndex;
+		if (DeviceIndex < 0 || DeviceIndex >= XIMMERSE_MAX_CONTROLLERS)
+		{
+			UE_LOG(LogXimmerseInput, Warning, TEXT("Ximmerse capture %s is corrupt: record %d is of controller %d"), *Filename, RecordIndex, DeviceIndex);
+			Records.Reset();
+			return false;
+		}
+	}
+
+	NextRecord = 0;
+	StartTime = InStartTime;
+	Speed = FMath::Max(InSpeed, KINDA_SMALL_NUMBER);
+	return true;
+}
+
+const FXimmerseCaptureRecord* FXimmerseCaptureReader::GetDueRecord(double CurrentTime) const
+{
+	if (IsFinished() || Records[NextRecord].Time > (CurrentTime - StartTime) * Speed)
+	{
+		return nullptr;
+	}
+
+	return &Records[NextRecord];
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
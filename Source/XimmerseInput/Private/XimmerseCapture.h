@@ -0,0 +1,143 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** 'XCAP' */
+#define XIMMERSE_CAPTURE_MAGIC		0x50414358
+#define XIMMERSE_CAPTURE_VERSION	1
+
+/** One raw sample as stored in a capture file */
+struct FXimmerseCaptureRecord
+{
+	/** Seconds since the capture started */
+	double Time;
+
+	/** Controller slot the sample was taken from */
+	int32 DeviceIndex;
+
+	/** TrackingResult reported along with the sample */
+	int32 TrackingResult;
+
+	ControllerState State;
+};
+
+struct FXimmerseCaptureFileHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 RecordSize;
+	uint32 Reserved;
+};
+
+/**
+* Appends raw samples to a capture file. Appending never allocates or blocks: records go into preallocated blocks
+* and a writer thread streams the full blocks to disk. Records are dropped if the writer falls behind.
+* Open and Close are called from the game thread, Append from whichever thread samples the devices.
+*/
+class FXimmerseCaptureWriter : public FRunnable
+{
+public:
+	FXimmerseCaptureWriter();
+	virtual ~FXimmerseCaptureWriter();
+
+	/** Starts a new capture, returns false if the file cannot be created */
+	bool Open(const FString& Filename);
+
+	/** Writes whatever is still buffered and closes the capture */
+	void Close();
+
+	bool IsRecording() const
+	{
+		return bRecording;
+	}
+
+	/** Adds one sample to the capture, does nothing unless recording */
+	void Append(int32 DeviceIndex, int32 TrackingResult, const ControllerState& State, double SampleTime);
+
+	/** Records lost because the writer thread fell behind, since the capture started */
+	int32 GetNumDroppedRecords() const
+	{
+		return NumDroppedRecords.GetValue();
+	}
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	/** Writes every block filled by the producer so far */
+	void WriteFilledBlocks();
+
+	FXimmerseCaptureRecord* GetBlock(int32 BlockIndex)
+	{
+		return &Records[(BlockIndex % NumBlocks) * RecordsPerBlock];
+	}
+
+	static const int32 NumBlocks = 4;
+	static const int32 RecordsPerBlock = 4096;
+
+	TArray<FXimmerseCaptureRecord> Records;
+
+	/** Producer side: blocks filled so far and the next record in the current block */
+	volatile int32 NumBlocksFilled;
+	int32 NextRecordInBlock;
+
+	/** Writer side: blocks written to disk so far */
+	volatile int32 NumBlocksWritten;
+
+	/** Appends currently running, Stop waits for them before closing the file */
+	FThreadSafeCounter NumAppending;
+
+	FThreadSafeCounter NumDroppedRecords;
+	FThreadSafeBool bRecording;
+	double StartTime;
+
+	IFileHandle* File;
+	FEvent* BlockFilledEvent;
+	FThreadSafeBool bStopRequested;
+	FRunnableThread* Thread;
+};
+
+/** Plays a capture file back, at its original speed or faster */
+class FXimmerseCaptureReader
+{
+public:
+	FXimmerseCaptureReader()
+		: NextRecord(0)
+		, StartTime(0.0)
+		, Speed(1.0f)
+	{
+	}
+
+	/** Loads the whole capture, returns false if the file is missing, not a capture or has a record of no valid controller slot */
+	bool Load(const FString& Filename, float InSpeed, double InStartTime);
+
+	/** Returns the next record if it is due at CurrentTime, or nullptr if it lies in the future */
+	const FXimmerseCaptureRecord* GetDueRecord(double CurrentTime) const;
+
+	/** Moves on to the record after the one GetDueRecord returned */
+	void Advance()
+	{
+		++NextRecord;
+	}
+
+	/** Time in FPlatformTime::Seconds() at which a record is played back */
+	double GetPlaybackTime(const FXimmerseCaptureRecord& Record) const
+	{
+		return StartTime + Record.Time / Speed;
+	}
+
+	bool IsFinished() const
+	{
+		return NextRecord >= Records.Num();
+	}
+
+private:
+	TArray<FXimmerseCaptureRecord> Records;
+	int32 NextRecord;
+	double StartTime;
+	float Speed;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,150 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "CircularQueue.h"
+#include "XimmersePose.h"
+#include "XimmerseSdkStats.h"
+
+/** Values of kField_ConnectionState */
+namespace EXimmerseConnectionState
+{
+	enum Type
+	{
+		Disconnected,
+		Scanning,
+		Connecting,
+		Connected,
+		Error,
+	};
+}
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Device status fields, queried from the SDK once per poll cycle instead of once per use */
+struct FXimmerseDeviceStatus
+{
+	/** TrackingResult flags */
+	int32 TrackingResult;
+
+	/** EXimmerseConnectionState */
+	int32 ConnectionState;
+
+	/** Battery charge in percent */
+	int32 BatteryLevel;
+
+	FXimmerseDeviceStatus()
+		: TrackingResult(0)
+		, ConnectionState(EXimmerseConnectionState::Disconnected)
+		, BatteryLevel(0)
+	{
+	}
+
+	bool IsRotationTracked() const
+	{
+		return (TrackingResult & kTrackingResult_RotationTracked) != 0;
+	}
+
+	bool IsPositionTracked() const
+	{
+		return (TrackingResult & kTrackingResult_PositionTracked) != 0;
+	}
+
+	bool IsConnected() const
+	{
+		return ConnectionState == EXimmerseConnectionState::Connected;
+	}
+};
+
+/** Longest time in seconds between two status refreshes of a device that is not polled every frame */
+#define STATUS_REFRESH_INTERVAL	0.1
+
+/** Device type passed to XDeviceGetInputDevices to list every device */
+#define XIMMERSE_DEVICE_TYPE_ANY	-1
+
+/**
+* SDK entry points the device registry, the poll thread and the status refresh go through. The SDK's own unless the
+* benchmark stands in for it, the way FXimmerseHaptics takes its send function.
+*/
+struct FXimmerseSdkFunctions
+{
+	int (*GetInputDeviceCount)();
+	int (*GetInputDevices)(int Type, int* Handles, int NumHandles);
+	char* (*GetInputDeviceName)(int Which);
+	int (*GetInputDeviceHandle)(char* Name);
+	int (*GetInt)(int Which, int FieldId, int DefaultValue);
+	int (*GetInputState)(int Which, void* State);
+
+	/** The functions of the SDK */
+	static const FXimmerseSdkFunctions& GetDefault()
+	{
+		static const FXimmerseSdkFunctions Functions = { &XDeviceGetInputDeviceCount, &XDeviceGetInputDevices, &XDeviceGetInputDeviceName, &XDeviceGetInputDeviceHandle, &XDeviceGetInt, &XDeviceGetInputState };
+		return Functions;
+	}
+};
+
+/**
+* Per-device state shared between the sampling thread and the readers of the input device.
+* Only the thread sampling the device writes it, any thread may read it. The padding puts what
+* is written at different rates on different cache lines: the render thread's pose reads never
+* miss because the sampler queued a sample or refreshed the status, and the other way around.
+*/
+struct FXimmerseDevice
+{
+	/** Number of samples buffered before the sampling thread starts dropping them */
+	static const uint32 SamplesPerDevice = 256;
+
+	/** SDK name of the device, stays the same across reconnections */
+	const FString Name;
+
+	/** SDK handle of the device, re-resolved when the device reconnects */
+	volatile int32 Handle;
+
+	uint8 HandlePadding[PLATFORM_CACHE_LINE_SIZE];
+
+	/** Written with every fresh sample, read by the render thread */
+	FXimmersePoseStream Pose;
+
+	uint8 PosePadding[PLATFORM_CACHE_LINE_SIZE];
+
+	/** Written a few times per second, read by the game thread */
+	TXimmerseSeqLock<FXimmerseDeviceStatus> Status;
+
+	uint8 StatusPadding[PLATFORM_CACHE_LINE_SIZE];
+
+	/** Samples taken by the poll thread, waiting for the game thread */
+	TCircularQueue<ControllerState> Samples;
+
+	/** Timestamp of the last sample taken, queued or dropped, and time of the last status refresh, only used by the poll thread */
+	int32 LastQueuedTimestamp;
+	double LastStatusTime;
+
+	/** Keeps the next allocation's hot data off the sampler's lines */
+	uint8 TrailingPadding[PLATFORM_CACHE_LINE_SIZE];
+
+	FXimmerseDevice(const FString& InName, int32 InHandle)
+		: Name(InName)
+		, Handle(InHandle)
+		, Samples(SamplesPerDevice)
+		, LastQueuedTimestamp(0)
+		, LastStatusTime(0.0)
+	{
+	}
+
+	void SetHandle(int32 InHandle)
+	{
+		FPlatformAtomics::InterlockedExchange(&Handle, InHandle);
+	}
+
+	/** Queries the status fields of the device and publishes them */
+	void RefreshStatus(const FXimmerseSdkFunctions& Sdk = FXimmerseSdkFunctions::GetDefault())
+	{
+		const int32 CurrentHandle = Handle;
+		FXimmerseDeviceStatus NewStatus;
+		NewStatus.TrackingResult = XIMMERSE_SDK_CALL(GetInt, CurrentHandle, Sdk.GetInt(CurrentHandle, kField_TrackingResult, 0));
+		NewStatus.ConnectionState = XIMMERSE_SDK_CALL(GetInt, CurrentHandle, Sdk.GetInt(CurrentHandle, kField_ConnectionState, EXimmerseConnectionState::Disconnected));
+		NewStatus.BatteryLevel = XIMMERSE_SDK_CALL(GetInt, CurrentHandle, Sdk.GetInt(CurrentHandle, kField_BatteryLevel, 0));
+		Status.Write(NewStatus);
+	}
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
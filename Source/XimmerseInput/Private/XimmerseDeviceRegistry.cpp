@@ -0,0 +1,227 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseDeviceRegistry.h"
+#include "XimmerseSdkStats.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+FXimmerseDeviceRegistry::FXimmerseDeviceRegistry(const FXimmerseSdkFunctions& InSdk)
+	: Sdk(InSdk)
+	, CurrentSet(new FXimmerseDeviceSet)
+	, TrackerHandle(INDEX_NONE)
+{
+}
+
+FXimmerseDeviceRegistry::~FXimmerseDeviceRegistry()
+{
+	for (const FRetiredSet& Retired : RetiredSets)
+	{
+		delete Retired.Set;
+	}
+	delete CurrentSet;
+}
+
+bool FXimmerseDeviceRegistry::Refresh()
+{
+	FScopeLock Lock(&RefreshCritical);
+
+	const FXimmerseDeviceSet& Set = *CurrentSet;
+	bool bChanged = false;
+
+	// a controller that dropped out may come back under a new handle
+	for (FXimmerseDevice* Device : Set.Controllers)
+	{
+		if (Device == nullptr || Device->Status.Read().IsConnected())
+		{
+			continue;
+		}
+
+		const int32 Handle = XIMMERSE_SDK_CALL(GetInputDeviceHandle, -1, Sdk.GetInputDeviceHandle(TCHAR_TO_ANSI(*Device->Name)));
+		if (Handle >= 0 && Handle != Device->Handle)
+		{
+			UE_LOG(LogXimmerseInput, Log, TEXT("Controller %s reconnected (handle %d)"), *Device->Name, Handle);
+			Device->SetHandle(Handle);
+			bChanged = true;
+		}
+	}
+
+	TArray<int32> Handles;
+	Handles.SetNumZeroed(FMath::Max(XIMMERSE_SDK_CALL(GetInputDeviceCount, -1, Sdk.GetInputDeviceCount()), 0));
+	const int32 NumHandles = XIMMERSE_SDK_CALL(GetInputDevices, -1, Sdk.GetInputDevices(XIMMERSE_DEVICE_TYPE_ANY, Handles.GetData(), Handles.Num()));
+	Handles.SetNum(FMath::Clamp(NumHandles, 0, Handles.Num()));
+
+	TMap<FString, int32> NewControllers;
+	for (const int32 Handle : Handles)
+	{
+		const char* DeviceName = XIMMERSE_SDK_CALL(GetInputDeviceName, Handle, Sdk.GetInputDeviceName(Handle));
+		const FString Name = (DeviceName != nullptr) ? ANSI_TO_TCHAR(DeviceName) : FString();
+
+		if (Name.StartsWith(TEXT("XHawk")))
+		{
+			if (TrackerHandle != Handle)
+			{
+				FPlatformAtomics::InterlockedExchange(&TrackerHandle, Handle);
+				bChanged = true;
+			}
+		}
+		else if (Name.StartsWith(TEXT("XCobra")) || Name.StartsWith(TEXT("XSim")))
+		{
+			FXimmerseDevice* const* Existing = Set.Controllers.FindByPredicate([&](const FXimmerseDevice* Device) { return Device != nullptr && Device->Name == Name; });
+			if (Existing == nullptr)
+			{
+				NewControllers.Add(Name, Handle);
+			}
+			else if ((*Existing)->Handle != Handle)
+			{
+				(*Existing)->SetHandle(Handle);
+				bChanged = true;
+			}
+		}
+	}
+
+	if (NewControllers.Num() > 0)
+	{
+		FXimmerseDeviceSet* NewSet = new FXimmerseDeviceSet(Set);
+		bool bAdded = false;
+
+		NewControllers.KeySort(TLess<FString>());
+		for (const TPair<FString, int32>& Controller : NewControllers)
+		{
+			const int32 Slot = FindFreeSlot(*NewSet, Controller.Key);
+			if (Slot == INDEX_NONE)
+			{
+				UE_LOG(LogXimmerseInput, Warning, TEXT("Ignoring controller %s (handle %d), all %d controller slots are taken"), *Controller.Key, Controller.Value, XIMMERSE_MAX_CONTROLLERS);
+				continue;
+			}
+
+			AddDevice(*NewSet, Slot, Controller.Key, Controller.Value);
+			bAdded = true;
+
+			UE_LOG(LogXimmerseInput, Log, TEXT("Found controller %s (handle %d), controller index %d"), *Controller.Key, Controller.Value, Slot);
+		}
+
+		if (bAdded)
+		{
+			Publish(NewSet);
+			bChanged = true;
+		}
+		else
+		{
+			delete NewSet;
+		}
+	}
+
+	// sets replaced by the last publish are freed by a later refresh, even if nothing changes anymore
+	CollectRetiredSets();
+
+	return bChanged;
+}
+
+FXimmerseDevice& FXimmerseDeviceRegistry::FindOrAddController(int32 Slot, const FString& Name)
+{
+	check(Slot >= 0 && Slot < XIMMERSE_MAX_CONTROLLERS);
+	FScopeLock Lock(&RefreshCritical);
+
+	const FXimmerseDeviceSet& Set = *CurrentSet;
+	if (Set.Controllers.IsValidIndex(Slot) && Set.Controllers[Slot] != nullptr)
+	{
+		return *Set.Controllers[Slot];
+	}
+
+	FXimmerseDeviceSet* NewSet = new FXimmerseDeviceSet(Set);
+	FXimmerseDevice& Device = AddDevice(*NewSet, Slot, Name, INDEX_NONE);
+	Publish(NewSet);
+	return Device;
+}
+
+void FXimmerseDeviceRegistry::RemoveController(int32 Slot)
+{
+	FScopeLock Lock(&RefreshCritical);
+
+	const FXimmerseDeviceSet& Set = *CurrentSet;
+	if (!Set.Controllers.IsValidIndex(Slot) || Set.Controllers[Slot] == nullptr)
+	{
+		return;
+	}
+
+	FXimmerseDeviceSet* NewSet = new FXimmerseDeviceSet(Set);
+	NewSet->Controllers[Slot] = nullptr;
+	Publish(NewSet, Set.Controllers[Slot]);
+}
+
+FXimmerseDevice& FXimmerseDeviceRegistry::AddDevice(FXimmerseDeviceSet& Set, int32 Slot, const FString& Name, int32 Handle)
+{
+	if (Slot >= Set.Controllers.Num())
+	{
+		Set.Controllers.AddZeroed(Slot + 1 - Set.Controllers.Num());
+	}
+
+	FXimmerseDevice* Device = new FXimmerseDevice(Name, Handle);
+	OwnedDevices.Add(Device);
+	Set.Controllers[Slot] = Device;
+	return *Device;
+}
+
+void FXimmerseDeviceRegistry::Publish(FXimmerseDeviceSet* NewSet, FXimmerseDevice* RemovedDevice)
+{
+	// the new set is complete before it becomes visible; the old one stays valid for readers still holding it
+	FRetiredSet Retired;
+	Retired.Set = CurrentSet;
+	Retired.RemovedDevice = RemovedDevice;
+	Retired.RetireTime = FPlatformTime::Seconds();
+	RetiredSets.Add(Retired);
+	FPlatformAtomics::InterlockedExchangePtr((void**)&CurrentSet, NewSet);
+
+	CollectRetiredSets();
+}
+
+void FXimmerseDeviceRegistry::CollectRetiredSets()
+{
+	// sets are retired in order, so the ones past their grace period are at the front
+	const double CurrentTime = FPlatformTime::Seconds();
+	int32 NumExpired = 0;
+	while (NumExpired < RetiredSets.Num() && CurrentTime - RetiredSets[NumExpired].RetireTime >= XIMMERSE_RETIRED_SET_GRACE_TIME)
+	{
+		const FRetiredSet& Retired = RetiredSets[NumExpired];
+		delete Retired.Set;
+
+		// the sets that held a removed device were all replaced before the one that dropped it
+		if (Retired.RemovedDevice != nullptr)
+		{
+			for (int32 DeviceIndex = 0; DeviceIndex < OwnedDevices.Num(); ++DeviceIndex)
+			{
+				if (&OwnedDevices[DeviceIndex] == Retired.RemovedDevice)
+				{
+					OwnedDevices.RemoveAt(DeviceIndex);
+					break;
+				}
+			}
+		}
+		++NumExpired;
+	}
+	RetiredSets.RemoveAt(0, NumExpired, false);
+}
+
+int32 FXimmerseDeviceRegistry::FindFreeSlot(const FXimmerseDeviceSet& Set, const FString& Name) const
+{
+	FString Prefix;
+	FString Number;
+	if (Name.Split(TEXT("-"), &Prefix, &Number, ESearchCase::CaseSensitive, ESearchDir::FromEnd) && Number.IsNumeric())
+	{
+		const int32 Slot = FCString::Atoi(*Number);
+		if (Slot >= 0 && Slot < XIMMERSE_MAX_CONTROLLERS && (!Set.Controllers.IsValidIndex(Slot) || Set.Controllers[Slot] == nullptr))
+		{
+			return Slot;
+		}
+	}
+
+	const int32 FreeSlot = Set.Controllers.Find(nullptr);
+	if (FreeSlot != INDEX_NONE)
+	{
+		return FreeSlot;
+	}
+	return (Set.Controllers.Num() < XIMMERSE_MAX_CONTROLLERS) ? Set.Controllers.Num() : INDEX_NONE;
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
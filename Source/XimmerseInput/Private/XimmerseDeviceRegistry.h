@@ -0,0 +1,113 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+#include "XimmerseDevice.h"
+
+/** Most controller slots there can be, a bound on slot numbers taken from device names and capture files */
+#define XIMMERSE_MAX_CONTROLLERS	64
+
+/** Seconds a replaced set stays alive, far longer than a reader holds one: a poll cycle, or a frame of the game or render thread */
+#define XIMMERSE_RETIRED_SET_GRACE_TIME	1.0
+
+/** Immutable list of controller slots, indexed by controller index. Unused slots are nullptr. */
+struct FXimmerseDeviceSet
+{
+	TArray<FXimmerseDevice*> Controllers;
+};
+
+/**
+* Owns every device the SDK ever reported and publishes them as an immutable FXimmerseDeviceSet.
+* A controller keeps its slot, and so its player and hand, across disconnects; a reconnected controller
+* only gets its handle re-resolved. Refreshing may happen on any thread, reading never blocks.
+*/
+class FXimmerseDeviceRegistry
+{
+public:
+	explicit FXimmerseDeviceRegistry(const FXimmerseSdkFunctions& InSdk = FXimmerseSdkFunctions::GetDefault());
+	~FXimmerseDeviceRegistry();
+
+	/**
+	* Enumerates the SDK devices, re-resolves the handles of disconnected controllers and publishes
+	* a new set when controllers were added. Returns true if anything changed.
+	*/
+	bool Refresh();
+
+	/**
+	* Returns the controller in a slot, adding a device without an SDK handle if the slot is free.
+	* Used to play back captured samples without the hardware they were taken from.
+	*/
+	FXimmerseDevice& FindOrAddController(int32 Slot, const FString& Name);
+
+	/**
+	* Frees a slot, e.g. of a stand-in FindOrAddController added, so a controller found later can take it.
+	* The device itself lives on as long as the set that last held it, for readers still holding that.
+	*/
+	void RemoveController(int32 Slot);
+
+	/** The newest published set, valid for XIMMERSE_RETIRED_SET_GRACE_TIME after a newer one replaced it */
+	const FXimmerseDeviceSet& GetDevices() const
+	{
+		const FXimmerseDeviceSet* Set = CurrentSet;
+		FPlatformMisc::MemoryBarrier();
+		return *Set;
+	}
+
+	/** Replaced sets not freed yet */
+	int32 GetNumRetiredSets() const
+	{
+		return RetiredSets.Num();
+	}
+
+	/** Handle of the XHawk tracker, INDEX_NONE if there is none */
+	int32 GetTrackerHandle() const
+	{
+		return TrackerHandle;
+	}
+
+private:
+	/** A set replaced by a newer one, kept for the readers that may still hold it */
+	struct FRetiredSet
+	{
+		FXimmerseDeviceSet* Set;
+
+		/** Device the newer set dropped, freed with the last set that held it */
+		FXimmerseDevice* RemovedDevice;
+
+		/** FPlatformTime::Seconds() at which the set was replaced */
+		double RetireTime;
+	};
+
+	/**
+	* Slot for a new controller: the number in its name if that slot is free, the first free slot otherwise,
+	* INDEX_NONE if all XIMMERSE_MAX_CONTROLLERS slots are taken
+	*/
+	int32 FindFreeSlot(const FXimmerseDeviceSet& Set, const FString& Name) const;
+
+	/** Creates a device in a slot of a set that is not published yet */
+	FXimmerseDevice& AddDevice(FXimmerseDeviceSet& Set, int32 Slot, const FString& Name, int32 Handle);
+
+	/** Makes a complete set visible to the readers, RemovedDevice is the device it no longer holds if any */
+	void Publish(FXimmerseDeviceSet* NewSet, FXimmerseDevice* RemovedDevice = nullptr);
+
+	/** Frees the sets replaced more than XIMMERSE_RETIRED_SET_GRACE_TIME ago, and the devices removed with them */
+	void CollectRetiredSets();
+
+	/** Enumerates the devices */
+	const FXimmerseSdkFunctions Sdk;
+
+	/** Serializes changes to the registry, readers never take it */
+	FCriticalSection RefreshCritical;
+
+	FXimmerseDeviceSet* volatile CurrentSet;
+
+	/** Replaced sets, oldest first, alive until their grace period is over */
+	TArray<FRetiredSet> RetiredSets;
+
+	TIndirectArray<FXimmerseDevice> OwnedDevices;
+
+	volatile int32 TrackerHandle;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
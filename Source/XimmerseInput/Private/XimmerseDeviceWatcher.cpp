@@ -0,0 +1,66 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseDeviceWatcher.h"
+#include "XimmerseDeviceRegistry.h"
+#include "XimmerseSdkInit.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+static TAutoConsoleVariable<float> CVarHotPlugInterval(
+    TEXT("ximmerse.HotPlugInterval"),
+    1.0f,
+    TEXT("Seconds between two checks for Ximmerse controllers that were added, disconnected or reconnected."),
+    ECVF_Default);
+
+/** Milliseconds between two checks whether the SDK finished initializing */
+#define SDK_READY_CHECK_INTERVAL	50
+
+FXimmerseDeviceWatcher::FXimmerseDeviceWatcher(FXimmerseDeviceRegistry& InRegistry)
+	: Registry(InRegistry)
+	, WakeEvent(FPlatformProcess::GetSynchEventFromPool())
+	, Thread(nullptr)
+{
+	Thread = FRunnableThread::Create(this, TEXT("XimmerseDeviceWatcher"), 0, TPri_BelowNormal);
+}
+
+FXimmerseDeviceWatcher::~FXimmerseDeviceWatcher()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+}
+
+uint32 FXimmerseDeviceWatcher::Run()
+{
+	while (!bStopRequested)
+	{
+		// the first pass runs as soon as the SDK is up, so controllers show up without waiting a whole interval
+		if (!FXimmerseSdkInit::IsReady())
+		{
+			WakeEvent->Wait(SDK_READY_CHECK_INTERVAL);
+			continue;
+		}
+
+		Registry.Refresh();
+
+		const float Interval = FMath::Max(CVarHotPlugInterval.GetValueOnAnyThread(), 0.1f);
+		WakeEvent->Wait(FTimespan::FromSeconds(Interval));
+	}
+
+	return 0;
+}
+
+void FXimmerseDeviceWatcher::Stop()
+{
+	bStopRequested = true;
+	WakeEvent->Trigger();
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,34 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+class FXimmerseDeviceRegistry;
+
+/**
+* Refreshes the device registry periodically on its own thread, so controllers that are plugged in,
+* drop out or reconnect are picked up without restarting and without stalling the game thread.
+* The first refresh happens as soon as the SDK finished initializing.
+*/
+class FXimmerseDeviceWatcher : public FRunnable
+{
+public:
+	FXimmerseDeviceWatcher(FXimmerseDeviceRegistry& InRegistry);
+	virtual ~FXimmerseDeviceWatcher();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	/** Registry to refresh, owned by the input device which outlives the watcher */
+	FXimmerseDeviceRegistry& Registry;
+
+	/** Wakes the thread early when stopping */
+	FEvent* WakeEvent;
+
+	FThreadSafeBool bStopRequested;
+	FRunnableThread* Thread;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,106 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseFilter.h"
+
+static TAutoConsoleVariable<int32> CVarFilter(
+    TEXT("ximmerse.Filter"),
+    0,
+    TEXT("Smooths the controller poses before they are published.\n")
+    TEXT(" 0: raw poses (default)\n")
+    TEXT(" 1: One-Euro filter"),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFilterMinCutoff(
+    TEXT("ximmerse.FilterMinCutoff"),
+    1.0f,
+    TEXT("Cutoff frequency in Hz of the position filter at rest. Lower removes more jitter."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFilterBeta(
+    TEXT("ximmerse.FilterBeta"),
+    0.05f,
+    TEXT("Cutoff increase in Hz per cm/s of controller speed. Higher removes more lag while moving."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFilterDerivativeCutoff(
+    TEXT("ximmerse.FilterDerivativeCutoff"),
+    1.0f,
+    TEXT("Cutoff frequency in Hz of the speed estimate that drives the filters."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFilterRotationMinCutoff(
+    TEXT("ximmerse.FilterRotationMinCutoff"),
+    1.0f,
+    TEXT("Cutoff frequency in Hz of the orientation filter at rest."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFilterRotationBeta(
+    TEXT("ximmerse.FilterRotationBeta"),
+    1.0f,
+    TEXT("Cutoff increase in Hz per quaternion unit per second of rotation speed."),
+    ECVF_Default);
+
+FXimmerseFilterSettings FXimmerseFilterSettings::Get()
+{
+	FXimmerseFilterSettings Settings;
+	Settings.bEnabled = CVarFilter.GetValueOnAnyThread() != 0;
+	Settings.MinCutoff = FMath::Max(CVarFilterMinCutoff.GetValueOnAnyThread(), KINDA_SMALL_NUMBER);
+	Settings.Beta = FMath::Max(CVarFilterBeta.GetValueOnAnyThread(), 0.0f);
+	Settings.DerivativeCutoff = FMath::Max(CVarFilterDerivativeCutoff.GetValueOnAnyThread(), KINDA_SMALL_NUMBER);
+	Settings.RotationMinCutoff = FMath::Max(CVarFilterRotationMinCutoff.GetValueOnAnyThread(), KINDA_SMALL_NUMBER);
+	Settings.RotationBeta = FMath::Max(CVarFilterRotationBeta.GetValueOnAnyThread(), 0.0f);
+	return Settings;
+}
+
+/** Smoothing factor of a first order low-pass filter with the given cutoff, as a vector */
+static FORCEINLINE VectorRegister GetSmoothingFactor(float Cutoff, float DeltaTime)
+{
+	const float TimeConstant = 1.0f / (2.0f * PI * Cutoff);
+	return VectorSetFloat1(1.0f / (1.0f + TimeConstant / DeltaTime));
+}
+
+/** Previous + (Current - Previous) * Alpha */
+static FORCEINLINE VectorRegister Smooth(const VectorRegister& Previous, const VectorRegister& Current, const VectorRegister& Alpha)
+{
+	return VectorMultiplyAdd(VectorSubtract(Current, Previous), Alpha, Previous);
+}
+
+void FXimmerseOneEuroFilter::Filter(FVector& Position, FQuat& Orientation, float DeltaTime, const FXimmerseFilterSettings& Settings)
+{
+	const VectorRegister RawPosition = VectorLoadFloat3_W0(&Position);
+	VectorRegister RawOrientation = VectorLoadAligned(&Orientation);
+
+	if (!bHasPreviousSample || DeltaTime <= SMALL_NUMBER)
+	{
+		FilteredPosition = RawPosition;
+		PositionVelocity = VectorZero();
+		FilteredOrientation = RawOrientation;
+		OrientationVelocity = VectorZero();
+		bHasPreviousSample = true;
+		return;
+	}
+
+	const VectorRegister InvDeltaTime = VectorSetFloat1(1.0f / DeltaTime);
+	const VectorRegister DerivativeAlpha = GetSmoothingFactor(Settings.DerivativeCutoff, DeltaTime);
+
+	// position: the smoothed speed raises the cutoff
+	PositionVelocity = Smooth(PositionVelocity, VectorMultiply(VectorSubtract(RawPosition, FilteredPosition), InvDeltaTime), DerivativeAlpha);
+	const VectorRegister SpeedSquared = VectorDot3(PositionVelocity, PositionVelocity);
+	const float Speed = FMath::Sqrt(VectorGetComponent(SpeedSquared, 0));
+	FilteredPosition = Smooth(FilteredPosition, RawPosition, GetSmoothingFactor(Settings.MinCutoff + Settings.Beta * Speed, DeltaTime));
+
+	// orientation: q and -q are the same rotation, blend towards the one on the filtered side
+	const VectorRegister Alignment = VectorDot4(RawOrientation, FilteredOrientation);
+	if (VectorGetComponent(Alignment, 0) < 0.0f)
+	{
+		RawOrientation = VectorNegate(RawOrientation);
+	}
+	OrientationVelocity = Smooth(OrientationVelocity, VectorMultiply(VectorSubtract(RawOrientation, FilteredOrientation), InvDeltaTime), DerivativeAlpha);
+	const VectorRegister AngularSpeedSquared = VectorDot4(OrientationVelocity, OrientationVelocity);
+	const float AngularSpeed = FMath::Sqrt(VectorGetComponent(AngularSpeedSquared, 0));
+	FilteredOrientation = VectorNormalizeQuaternion(Smooth(FilteredOrientation, RawOrientation, GetSmoothingFactor(Settings.RotationMinCutoff + Settings.RotationBeta * AngularSpeed, DeltaTime)));
+
+	VectorStoreFloat3(FilteredPosition, &Position);
+	VectorStoreAligned(FilteredOrientation, &Orientation);
+}
@@ -0,0 +1,54 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/** Parameters of the pose filter, see the ximmerse.Filter console variables */
+struct FXimmerseFilterSettings
+{
+	bool bEnabled;
+
+	/** Cutoff in Hz at rest, lower removes more jitter */
+	float MinCutoff;
+
+	/** Cutoff increase in Hz per cm/s of speed, higher removes more lag while moving */
+	float Beta;
+
+	/** Cutoff in Hz of the speed estimate that drives the adaptive cutoff */
+	float DerivativeCutoff;
+
+	/** Same as MinCutoff and Beta for the orientation, speed measured in quaternion units per second */
+	float RotationMinCutoff;
+	float RotationBeta;
+
+	/** Current values of the console variables, readable from any thread */
+	static FXimmerseFilterSettings Get();
+};
+
+/**
+* One-Euro filter (Casiez et al.) over the position and the orientation of one controller: a low-pass filter
+* whose cutoff rises with speed, so resting controllers stop jittering and moving ones do not lag.
+* Position and orientation each live in one vector register and are filtered with SIMD operations.
+*/
+class FXimmerseOneEuroFilter
+{
+public:
+	FXimmerseOneEuroFilter()
+		: bHasPreviousSample(false)
+	{
+	}
+
+	/** Forgets the filtered state, the next sample passes through unchanged */
+	void Reset()
+	{
+		bHasPreviousSample = false;
+	}
+
+	/** Replaces Position and Orientation by their filtered values, DeltaTime seconds after the previous sample */
+	void Filter(FVector& Position, FQuat& Orientation, float DeltaTime, const FXimmerseFilterSettings& Settings);
+
+private:
+	VectorRegister FilteredPosition;
+	VectorRegister PositionVelocity;
+	VectorRegister FilteredOrientation;
+	VectorRegister OrientationVelocity;
+	bool bHasPreviousSample;
+};
@@ -0,0 +1,226 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseHaptics.h"
+#include "XimmerseSdkStats.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+static TAutoConsoleVariable<float> CVarHapticsMinInterval(
+    TEXT("ximmerse.HapticsMinInterval"),
+    0.02f,
+    TEXT("Shortest time in seconds between two vibration messages to the same controller.\n")
+    TEXT("Amplitude changes in between are merged, only the newest one is sent."),
+    ECVF_Default);
+
+/** Number of commands the game thread may push before the worker picks them up */
+#define HAPTICS_QUEUE_SIZE		256
+
+/** Time in milliseconds a motor keeps running after a message, so it stops by itself if messages stop coming */
+#define HAPTICS_HOLD_TIME_MS	200
+
+/** Time in seconds after which a running motor is sent its strength again, well before the hold time runs out */
+#define HAPTICS_REFRESH_TIME	0.1
+
+FXimmerseHaptics::FXimmerseHaptics(send_message_delegate InSendMessage)
+	: SendMessage(InSendMessage)
+	, Commands(HAPTICS_QUEUE_SIZE)
+	, CommandEvent(nullptr)
+	, Thread(nullptr)
+{
+	CommandEvent = FPlatformProcess::GetSynchEventFromPool();
+	Thread = FRunnableThread::Create(this, TEXT("XimmerseHaptics"));
+}
+
+FXimmerseHaptics::~FXimmerseHaptics()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(CommandEvent);
+	CommandEvent = nullptr;
+}
+
+void FXimmerseHaptics::SetAmplitude(int32 ControllerIndex, int32 Handle, float Amplitude)
+{
+	FCommand Command;
+	Command.ControllerIndex = ControllerIndex;
+	Command.Handle = Handle;
+	Command.bSetsPattern = false;
+	Command.Amplitude = Amplitude;
+	Enqueue(Command);
+}
+
+void FXimmerseHaptics::PlayPattern(int32 ControllerIndex, int32 Handle, const FXimmerseHapticPatternPtr& Pattern)
+{
+	FCommand Command;
+	Command.ControllerIndex = ControllerIndex;
+	Command.Handle = Handle;
+	Command.bSetsPattern = true;
+	Command.Amplitude = 0.0f;
+	Command.Pattern = Pattern;
+	Enqueue(Command);
+}
+
+void FXimmerseHaptics::StopPattern(int32 ControllerIndex, int32 Handle)
+{
+	PlayPattern(ControllerIndex, Handle, FXimmerseHapticPatternPtr());
+}
+
+void FXimmerseHaptics::Enqueue(const FCommand& Command)
+{
+	NumCommands.Increment();
+
+	if (Command.ControllerIndex < 0 || !Commands.Enqueue(Command))
+	{
+		NumDroppedCommands.Increment();
+		return;
+	}
+
+	CommandEvent->Trigger();
+}
+
+uint32 FXimmerseHaptics::Run()
+{
+	while (!bStopRequested)
+	{
+		const double CurrentTime = FPlatformTime::Seconds();
+		const double NextUpdateTime = Update(CurrentTime);
+
+		// sleep until a command arrives or the next message is due
+		if (NextUpdateTime == MAX_dbl)
+		{
+			CommandEvent->Wait();
+		}
+		else
+		{
+			CommandEvent->Wait((uint32)FMath::Clamp(FMath::CeilToInt((float)((NextUpdateTime - CurrentTime) * 1000.0)), 1, HAPTICS_HOLD_TIME_MS));
+		}
+	}
+
+	// leave no motor running
+	const double CurrentTime = FPlatformTime::Seconds();
+	for (FChannel& Channel : Channels)
+	{
+		if (Channel.Handle >= 0 && Channel.SentStrength > 0)
+		{
+			Send(Channel, 0, CurrentTime);
+		}
+	}
+
+	return 0;
+}
+
+void FXimmerseHaptics::Stop()
+{
+	bStopRequested = true;
+	CommandEvent->Trigger();
+}
+
+double FXimmerseHaptics::Update(double CurrentTime)
+{
+	// a newer command replaces an older one before the older one was sent, this is where updates get merged
+	FCommand Command;
+	while (Commands.Dequeue(Command))
+	{
+		if (Command.ControllerIndex >= Channels.Num())
+		{
+			Channels.SetNum(Command.ControllerIndex + 1);
+		}
+
+		FChannel& Channel = Channels[Command.ControllerIndex];
+		if (Channel.Handle != Command.Handle)
+		{
+			// a reconnected controller comes back with its motor off
+			Channel.Handle = Command.Handle;
+			Channel.SentStrength = 0;
+		}
+
+		// the engine sets the amplitude every frame, which must not cut a pattern short
+		if (Command.bSetsPattern)
+		{
+			Channel.Pattern = Command.Pattern;
+			Channel.PatternStartTime = CurrentTime;
+		}
+		else
+		{
+			Channel.Amplitude = Command.Amplitude;
+		}
+	}
+
+	const double MinInterval = FMath::Max(CVarHapticsMinInterval.GetValueOnAnyThread(), 0.0f);
+	double NextUpdateTime = MAX_dbl;
+
+	for (FChannel& Channel : Channels)
+	{
+		if (Channel.Handle < 0)
+		{
+			continue;
+		}
+
+		const int32 Strength = GetStrength(Channel, CurrentTime);
+
+		double DueTime = MAX_dbl;
+		if (Strength != Channel.SentStrength)
+		{
+			DueTime = FMath::Max(CurrentTime, Channel.LastSendTime + MinInterval);
+		}
+		else if (Strength > 0)
+		{
+			DueTime = Channel.LastSendTime + HAPTICS_REFRESH_TIME;
+		}
+
+		if (DueTime <= CurrentTime)
+		{
+			Send(Channel, Strength, CurrentTime);
+			DueTime = (Strength > 0) ? CurrentTime + HAPTICS_REFRESH_TIME : MAX_dbl;
+		}
+
+		// the pattern's next sample may change the strength
+		if (Channel.Pattern.IsValid())
+		{
+			const double SampleRate = Channel.Pattern->SampleRate;
+			const double NextSampleTime = Channel.PatternStartTime + (FMath::FloorToDouble((CurrentTime - Channel.PatternStartTime) * SampleRate) + 1.0) / SampleRate;
+			DueTime = FMath::Min(DueTime, NextSampleTime);
+		}
+
+		NextUpdateTime = FMath::Min(NextUpdateTime, DueTime);
+	}
+
+	return NextUpdateTime;
+}
+
+int32 FXimmerseHaptics::GetStrength(FChannel& Channel, double CurrentTime)
+{
+	float Amplitude = Channel.Amplitude;
+
+	if (Channel.Pattern.IsValid())
+	{
+		const FXimmerseHapticPattern& Pattern = *Channel.Pattern;
+		const int64 SampleIndex = (int64)((CurrentTime - Channel.PatternStartTime) * Pattern.SampleRate);
+		if (Pattern.SampleRate > 0 && SampleIndex < Pattern.Samples.Num())
+		{
+			Amplitude = Pattern.Samples[SampleIndex] / 255.0f;
+		}
+		else
+		{
+			Channel.Pattern.Reset();
+		}
+	}
+
+	return FMath::Clamp(FMath::RoundToInt(Amplitude * 100.0f), 0, 100);
+}
+
+void FXimmerseHaptics::Send(FChannel& Channel, int32 Strength, double CurrentTime)
+{
+	XIMMERSE_SDK_CALL(SendMessage, Channel.Handle, SendMessage(Channel.Handle, XIMMERSE_MESSAGE_TRIGGER_VIBRATION, Strength, (Strength > 0) ? HAPTICS_HOLD_TIME_MS : 0));
+	Channel.SentStrength = Strength;
+	Channel.LastSendTime = CurrentTime;
+	NumMessagesSent.Increment();
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
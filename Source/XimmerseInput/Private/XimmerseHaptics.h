@@ -0,0 +1,143 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+#include "CircularQueue.h"
+
+/**
+* Message sent through XDeviceSendMessage to make a controller vibrate, numbered as in the SDK's other bindings.
+* wParam is the strength in percent, lParam the time in milliseconds the motor keeps running, 0 stops it.
+* UNVERIFIED: xdevice.h does not define it, which is why ximmerse.Vibration is off by default.
+*/
+#define XIMMERSE_MESSAGE_TRIGGER_VIBRATION	1
+
+/** Amplitudes streamed to a controller at a fixed rate, the counterpart of the engine's haptic buffers */
+struct FXimmerseHapticPattern
+{
+	/** Amplitude of each sample, 0 to 255 */
+	TArray<uint8> Samples;
+
+	/** Samples per second */
+	int32 SampleRate;
+
+	FXimmerseHapticPattern()
+		: SampleRate(0)
+	{
+	}
+};
+
+typedef TSharedPtr<const FXimmerseHapticPattern, ESPMode::ThreadSafe> FXimmerseHapticPatternPtr;
+
+/**
+* Sends vibration to the controllers on a dedicated thread, so Bluetooth and USB writes never block the game thread.
+* The game thread pushes commands into a single-producer/single-consumer ring and returns. The worker keeps only the
+* newest amplitude of each controller, skips messages that would not change the motor and sends at most one message
+* per controller every ximmerse.HapticsMinInterval seconds.
+*/
+class FXimmerseHaptics : public FRunnable
+{
+public:
+	/** SendMessage is XDeviceSendMessage unless the benchmark counts the messages instead */
+	FXimmerseHaptics(send_message_delegate InSendMessage = &XDeviceSendMessage);
+	virtual ~FXimmerseHaptics();
+
+	/**
+	* Keeps a controller vibrating at Amplitude (0 to 1) until told otherwise, 0 stops it. A pattern playing on the
+	* controller is left alone, the amplitude takes over once it ended. Game thread only.
+	*/
+	void SetAmplitude(int32 ControllerIndex, int32 Handle, float Amplitude);
+
+	/** Plays a pattern once on a controller, over its amplitude until the pattern ends or is replaced. Game thread only. */
+	void PlayPattern(int32 ControllerIndex, int32 Handle, const FXimmerseHapticPatternPtr& Pattern);
+
+	/** Ends the pattern playing on a controller, if any, and goes back to its amplitude. Game thread only. */
+	void StopPattern(int32 ControllerIndex, int32 Handle);
+
+	/** Commands pushed by the game thread, including those the ring had no room for */
+	int32 GetNumCommands() const
+	{
+		return NumCommands.GetValue();
+	}
+
+	/** Commands dropped because the worker fell a whole ring behind */
+	int32 GetNumDroppedCommands() const
+	{
+		return NumDroppedCommands.GetValue();
+	}
+
+	/** Messages handed to the SDK */
+	int32 GetNumMessagesSent() const
+	{
+		return NumMessagesSent.GetValue();
+	}
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FCommand
+	{
+		int32 ControllerIndex;
+		int32 Handle;
+
+		/** Amplitude commands change the amplitude, pattern commands replace the pattern, a null one stops it */
+		bool bSetsPattern;
+		float Amplitude;
+		FXimmerseHapticPatternPtr Pattern;
+	};
+
+	/** What the worker knows about one controller's motor */
+	struct FChannel
+	{
+		int32 Handle;
+
+		/** Amplitude asked for while no pattern plays */
+		float Amplitude;
+
+		FXimmerseHapticPatternPtr Pattern;
+		double PatternStartTime;
+
+		/** Strength in percent of the last message and when it went out */
+		int32 SentStrength;
+		double LastSendTime;
+
+		FChannel()
+			: Handle(INDEX_NONE)
+			, Amplitude(0.0f)
+			, PatternStartTime(0.0)
+			, SentStrength(0)
+			, LastSendTime(-MAX_dbl)
+		{
+		}
+	};
+
+	void Enqueue(const FCommand& Command);
+
+	/** Applies the queued commands and sends what is due, returns when the next message is due or MAX_dbl if none is */
+	double Update(double CurrentTime);
+
+	/** Strength in percent a channel should run at now, ends the channel's pattern once it has played */
+	static int32 GetStrength(FChannel& Channel, double CurrentTime);
+
+	void Send(FChannel& Channel, int32 Strength, double CurrentTime);
+
+	send_message_delegate SendMessage;
+
+	/** Game thread to worker */
+	TCircularQueue<FCommand> Commands;
+
+	/** Worker only, indexed like the registry's controller slots */
+	TArray<FChannel> Channels;
+
+	FThreadSafeCounter NumCommands;
+	FThreadSafeCounter NumDroppedCommands;
+	FThreadSafeCounter NumMessagesSent;
+
+	FEvent* CommandEvent;
+	FThreadSafeBool bStopRequested;
+	FRunnableThread* Thread;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
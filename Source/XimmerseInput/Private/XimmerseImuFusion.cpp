@@ -0,0 +1,122 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseImuFusion.h"
+
+static TAutoConsoleVariable<int32> CVarImuFusion(
+    TEXT("ximmerse.ImuFusion"),
+    0,
+    TEXT("Fuses the controllers' gyroscope and accelerometer into their orientation at every sample.\n")
+    TEXT(" 0: the SDK's orientation as is (default)\n")
+    TEXT(" 1: gyroscope integration corrected towards gravity and the SDK's tracked orientation"),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarImuFusionAccelerometerGain(
+    TEXT("ximmerse.ImuFusionAccelerometerGain"),
+    1.0f,
+    TEXT("Rate in 1/s at which the fused tilt follows gravity as measured by the accelerometer. 0 ignores the accelerometer."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarImuFusionReferenceGain(
+    TEXT("ximmerse.ImuFusionReferenceGain"),
+    5.0f,
+    TEXT("Rate in 1/s at which the fused orientation follows the SDK's tracked orientation. Higher drifts less, lower is smoother."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarImuFusionBiasGain(
+    TEXT("ximmerse.ImuFusionBiasGain"),
+    0.1f,
+    TEXT("Rate in 1/s at which the fusion learns the gyroscope bias. 0 trusts the gyroscope as is."),
+    ECVF_Default);
+
+/** The accelerometer only measures gravity while the controller is not accelerating, in g from 1 g */
+#define FUSION_ACCELERATION_TOLERANCE	0.1f
+
+/** A reference farther than this, in radians, is jumped to rather than approached, e.g. when tracking comes back */
+#define FUSION_SNAP_ANGLE				(PI / 6.0f)
+
+/** A gap between two samples longer than this, in seconds, is not integrated across */
+#define FUSION_MAX_DELTA_TIME			0.1f
+
+/** Longest time in seconds one reference stands for, the error after a tracking dropout is not a rate */
+#define FUSION_MAX_REFERENCE_AGE		0.05f
+
+/** Largest gyroscope bias the fusion believes in, in rad/s */
+#define FUSION_MAX_GYROSCOPE_BIAS		0.1f
+
+FXimmerseImuFusionSettings FXimmerseImuFusionSettings::Get()
+{
+	FXimmerseImuFusionSettings Settings;
+	Settings.bEnabled = CVarImuFusion.GetValueOnAnyThread() != 0;
+	Settings.AccelerometerGain = FMath::Max(CVarImuFusionAccelerometerGain.GetValueOnAnyThread(), 0.0f);
+	Settings.ReferenceGain = FMath::Max(CVarImuFusionReferenceGain.GetValueOnAnyThread(), 0.0f);
+	Settings.BiasGain = FMath::Max(CVarImuFusionBiasGain.GetValueOnAnyThread(), 0.0f);
+	return Settings;
+}
+
+FQuat FXimmerseImuFusion::Update(const FVector& Gyroscope, const FVector& SpecificForce, const FQuat& InReference, bool bReferenceTracked, float DeltaTime, const FXimmerseImuFusionSettings& Settings)
+{
+	const bool bFreshReference = bReferenceTracked && !(InReference == Reference);
+	Reference = InReference;
+
+	if (!bHasOrientation || DeltaTime <= 0.0f || DeltaTime > FUSION_MAX_DELTA_TIME)
+	{
+		Orientation = InReference;
+		ReferenceAge = 0.0f;
+		bHasOrientation = true;
+		return Orientation;
+	}
+	ReferenceAge += DeltaTime;
+
+	// both errors are rotation vectors in the controller's frame, turning the estimate towards the measurement
+	FVector Correction = FVector::ZeroVector;
+	FVector BiasError = FVector::ZeroVector;
+
+	const float ForceSize = SpecificForce.Size();
+	if (FMath::Abs(ForceSize - 1.0f) < FUSION_ACCELERATION_TOLERANCE)
+	{
+		const FVector MeasuredUp = SpecificForce / ForceSize;
+		const FVector EstimatedUp = Orientation.UnrotateVector(FVector::UpVector);
+		const FVector TiltError = FVector::CrossProduct(MeasuredUp, EstimatedUp);
+		Correction += TiltError * Settings.AccelerometerGain;
+		BiasError += TiltError;
+	}
+
+	if (bFreshReference)
+	{
+		FQuat Delta = Orientation.Inverse() * InReference;
+		if (Delta.W < 0.0f)
+		{
+			Delta = Delta * -1.0f;
+		}
+
+		const FVector ReferenceError = FVector(Delta.X, Delta.Y, Delta.Z) * 2.0f;
+		if (ReferenceError.SizeSquared() > FMath::Square(2.0f * FMath::Sin(FUSION_SNAP_ANGLE * 0.5f)))
+		{
+			Orientation = InReference;
+			ReferenceAge = 0.0f;
+			return Orientation;
+		}
+
+		// tracking may update slower than the IMU samples, one reference stands for every sample since the last
+		const float Age = FMath::Min(ReferenceAge, FUSION_MAX_REFERENCE_AGE);
+		Correction += ReferenceError * (FMath::Min(Settings.ReferenceGain * Age, 1.0f) / DeltaTime);
+		BiasError += ReferenceError * (Age / DeltaTime);
+		ReferenceAge = 0.0f;
+	}
+
+	// the integral of the error is the part of the gyroscope's reading that is not rotation
+	GyroscopeBias -= BiasError * (Settings.BiasGain * DeltaTime);
+	GyroscopeBias = GyroscopeBias.GetClampedToMaxSize(FUSION_MAX_GYROSCOPE_BIAS);
+
+	// the gyroscope measures in the controller's frame, so the rotation delta is applied on the right
+	const FVector AngularVelocity = Gyroscope - GyroscopeBias + Correction;
+	const float AngularSpeed = AngularVelocity.Size();
+	if (AngularSpeed > KINDA_SMALL_NUMBER)
+	{
+		Orientation = Orientation * FQuat(AngularVelocity / AngularSpeed, AngularSpeed * DeltaTime);
+		Orientation.Normalize();
+	}
+
+	return Orientation;
+}
@@ -0,0 +1,78 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/** Parameters of the IMU fusion, see the ximmerse.ImuFusion console variables */
+struct FXimmerseImuFusionSettings
+{
+	bool bEnabled;
+
+	/** Rate in 1/s at which the tilt is pulled towards the accelerometer's gravity */
+	float AccelerometerGain;
+
+	/** Rate in 1/s at which the orientation is pulled towards a fresh tracked orientation from the SDK */
+	float ReferenceGain;
+
+	/** Rate in 1/s at which the remaining error is blamed on gyroscope bias */
+	float BiasGain;
+
+	/** Current values of the console variables, readable from any thread */
+	static FXimmerseImuFusionSettings Get();
+};
+
+/**
+* Mahony-style complementary filter of one controller. Every IMU sample integrates the gyroscope on the
+* orientation, and a proportional-integral correction pulls it towards gravity as measured by the accelerometer
+* and towards the SDK's tracked orientation whenever a fresh one arrives, weighted by the time since the last one
+* so a slow tracker corrects as much as a fast one. The integral term is the gyroscope bias estimate. Between two
+* tracked orientations the orientation follows the gyroscope at the sample rate.
+*/
+class FXimmerseImuFusion
+{
+public:
+	FXimmerseImuFusion()
+		: Orientation(FQuat::Identity)
+		, Reference(FQuat::Identity)
+		, GyroscopeBias(FVector::ZeroVector)
+		, ReferenceAge(0.0f)
+		, bHasOrientation(false)
+	{
+	}
+
+	/** Forgets the orientation, the next sample starts from its reference. The bias estimate is kept. */
+	void Reset()
+	{
+		bHasOrientation = false;
+	}
+
+	/**
+	* Integrates one IMU sample taken DeltaTime seconds after the previous one and returns the fused orientation.
+	* Gyroscope is in rad/s and SpecificForce in g, both in the controller's frame in Unreal space. Reference is the
+	* SDK's orientation of the sample, only trusted while bReferenceTracked and only when it changed since the last.
+	*/
+	FQuat Update(const FVector& Gyroscope, const FVector& SpecificForce, const FQuat& InReference, bool bReferenceTracked, float DeltaTime, const FXimmerseImuFusionSettings& Settings);
+
+	/** Angular velocity of the last sample with the estimated bias removed, in rad/s in the controller's frame */
+	FVector GetAngularVelocity(const FVector& Gyroscope) const
+	{
+		return Gyroscope - GyroscopeBias;
+	}
+
+	/** Estimated gyroscope bias in rad/s */
+	const FVector& GetGyroscopeBias() const
+	{
+		return GyroscopeBias;
+	}
+
+private:
+	FQuat Orientation;
+
+	/** Last reference the fusion was corrected towards, a reference that did not change carries no news */
+	FQuat Reference;
+
+	FVector GyroscopeBias;
+
+	/** Seconds since the last fresh reference */
+	float ReferenceAge;
+
+	bool bHasOrientation;
+};
@@ -2,16 +2,19 @@
 
 #include "XimmerseInputPrivatePCH.h"
 #include "XimmerseInput.h"
+#include "XimmerseInputPoller.h"
+#include "XimmerseInputListener.h"
+#include "XimmerseDeviceWatcher.h"
+#include "XimmerseCapture.h"
+#include "XimmerseSharedMemory.h"
+#include "XimmerseHaptics.h"
+#include "XimmerseSimulator.h"
+#include "XimmerseSdkInit.h"
+#include "XimmerseTrace.h"
+#include "XimmerseSdkStats.h"
 #include <ControllerState.h>
 
-DEFINE_LOG_CATEGORY_STATIC(LogXimmerseInput, Log, All);
-
-#define DOT_45DEG		0.7071f
-
-//
-// Gamepad thresholds
-//
-#define TOUCHPAD_DEADZONE  0.0f
+DEFINE_LOG_CATEGORY(LogXimmerseInput);
 
 #define LOCTEXT_NAMESPACE "XimmerseInput"
 
@@ -24,58 +27,102 @@ static TAutoConsoleVariable<int32> CVarSwapHands(
     TEXT(" 1: swap left and right buttons"),
     ECVF_Cheat);
 
-namespace XimmerseControllerKeyNames
-{
-const FGamepadKeyNames::Type Touch0("Ximmerse_Touch_0");
-const FGamepadKeyNames::Type Touch1("Ximmerse_Touch_1");
-}
-
+static TAutoConsoleVariable<int32> CVarInputMode(
+    TEXT("ximmerse.InputMode"),
+    0,
+    TEXT("How the Ximmerse devices' input reaches the game thread.\n")
+    TEXT(" 0: poll on the game thread once per frame (default)\n")
+    TEXT(" 1: poll on a dedicated thread, every sample is processed\n")
+    TEXT(" 2: SDK event callbacks fired on the SDK's own threads, the game thread only drains their queue; polls as 0 if the SDK stays silent"),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarListenerTimeout(
+    TEXT("ximmerse.ListenerTimeout"),
+    2.0f,
+    TEXT("Seconds ximmerse.InputMode 2 waits for a first SDK callback from a connected controller before it falls back to polling.\n")
+    TEXT(" 0: never fall back"),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarVibration(
+    TEXT("ximmerse.Vibration"),
+    0,
+    TEXT("Whether force feedback and haptic patterns make the Ximmerse controllers vibrate.\n")
+    TEXT("Off by default until the SDK's vibration message, XIMMERSE_MESSAGE_TRIGGER_VIBRATION, is confirmed on hardware.\n")
+    TEXT(" 0: nothing is sent, motors still running are stopped (default)\n")
+    TEXT(" 1: vibrate"),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMaxPredictionTime(
+    TEXT("ximmerse.MaxPredictionTime"),
+    0.05f,
+    TEXT("Longest time in seconds a controller pose may be extrapolated ahead of its newest sample."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarInitialButtonRepeatDelay(
+    TEXT("ximmerse.InitialButtonRepeatDelay"),
+    0.2f,
+    TEXT("Seconds a controller button is held before its first repeat, counted from the sample that pressed it."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarButtonRepeatDelay(
+    TEXT("ximmerse.ButtonRepeatDelay"),
+    0.1f,
+    TEXT("Seconds between two repeats of a held controller button."),
+    ECVF_Default);
+
+/** Shortest repeat interval accepted from ximmerse.ButtonRepeatDelay */
+#define MIN_BUTTON_REPEAT_DELAY	0.01f
+
+/** Name prefix of the devices standing in for controllers a replay plays back without their hardware */
+#define REPLAY_DEVICE_PREFIX	TEXT("XReplay-")
 
 FXimmerseInput::FXimmerseInput(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler)
 	: MessageHandler(InMessageHandler)
 {
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
-	FMemory::Memzero(ControllerStates, sizeof(ControllerStates));
-
-	for (int32 i = 0; i < MaxControllers; ++i)
-	{
-		DeviceToControllerMap[i] = INDEX_NONE;
-	}
+	bListenerSilent = false;
+	Capture.Reset(new FXimmerseCaptureWriter);
+	SharedMemory.Reset(new FXimmerseSharedMemoryPublisher);
 
-	for (int32 i = 0; i < MaxControllers; ++i)
+	// -XimmerseSharedMemory[=<name>] publishes from the first frame on, for tools started along with the game
+	FString SharedMemoryName;
+	if (FParse::Value(FCommandLine::Get(), TEXT("XimmerseSharedMemory="), SharedMemoryName) || FParse::Param(FCommandLine::Get(), TEXT("XimmerseSharedMemory")))
 	{
-		ControllerToDeviceMap[i] = INDEX_NONE;
+		SharedMemoryName = !SharedMemoryName.IsEmpty() ? SharedMemoryName : XIMMERSE_SHARED_MEMORY_NAME;
+		if (!SharedMemory->Open(SharedMemoryName))
+		{
+			UE_LOG(LogXimmerseInput, Warning, TEXT("Failed to map the Ximmerse shared memory %s"), *SharedMemoryName);
+		}
 	}
-
-	NumControllersMapped = 0;
-
-	InitialButtonRepeatDelay = 0.2f;
-	ButtonRepeatDelay = 0.1f;
+	Haptics.Reset(new FXimmerseHaptics);
 
 	EKeys::AddKey(FKeyDetails(FKey(XimmerseControllerKeyNames::Touch0), LOCTEXT("Ximmerse_Touch_0", "MotionController (L) Touchpad"), FKeyDetails::GamepadKey | FKeyDetails::FloatAxis));
 	EKeys::AddKey(FKeyDetails(FKey(XimmerseControllerKeyNames::Touch1), LOCTEXT("Ximmerse_Touch_1", "MotionController (R) Touchpad"), FKeyDetails::GamepadKey | FKeyDetails::FloatAxis));
 
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::System] = FGamepadKeyNames::SpecialLeft;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::ApplicationMenu] = FGamepadKeyNames::MotionController_Left_Shoulder;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadPress] = FGamepadKeyNames::MotionController_Left_Thumbstick;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadTouch] = XimmerseControllerKeyNames::Touch0;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TriggerPress] = FGamepadKeyNames::MotionController_Left_Trigger;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::Grip] = FGamepadKeyNames::MotionController_Left_Grip1;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadUp] = FGamepadKeyNames::MotionController_Left_FaceButton1;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadDown] = FGamepadKeyNames::MotionController_Left_FaceButton3;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadLeft] = FGamepadKeyNames::MotionController_Left_FaceButton4;
-	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadRight] = FGamepadKeyNames::MotionController_Left_FaceButton2;
-
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::System] = FGamepadKeyNames::SpecialRight;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::ApplicationMenu] = FGamepadKeyNames::MotionController_Right_Shoulder;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadPress] = FGamepadKeyNames::MotionController_Right_Thumbstick;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadTouch] = XimmerseControllerKeyNames::Touch1;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TriggerPress] = FGamepadKeyNames::MotionController_Right_Trigger;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::Grip] = FGamepadKeyNames::MotionController_Right_Grip1;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadUp] = FGamepadKeyNames::MotionController_Right_FaceButton1;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadDown] = FGamepadKeyNames::MotionController_Right_FaceButton3;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadLeft] = FGamepadKeyNames::MotionController_Right_FaceButton4;
-	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadRight] = FGamepadKeyNames::MotionController_Right_FaceButton2;
+	const FText HandNames[CONTROLLERS_PER_PLAYER] = { LOCTEXT("Ximmerse_Hand_Left", "L"), LOCTEXT("Ximmerse_Hand_Right", "R") };
+	const FText GestureNames[EXimmerseTouchGesture::Count] =
+	{
+		LOCTEXT("Ximmerse_Gesture_Tap", "Tap"),
+		LOCTEXT("Ximmerse_Gesture_Hold", "Hold"),
+		LOCTEXT("Ximmerse_Gesture_SwipeUp", "Swipe Up"),
+		LOCTEXT("Ximmerse_Gesture_SwipeDown", "Swipe Down"),
+		LOCTEXT("Ximmerse_Gesture_SwipeLeft", "Swipe Left"),
+		LOCTEXT("Ximmerse_Gesture_SwipeRight", "Swipe Right"),
+		LOCTEXT("Ximmerse_Gesture_FlickUp", "Flick Up"),
+		LOCTEXT("Ximmerse_Gesture_FlickDown", "Flick Down"),
+		LOCTEXT("Ximmerse_Gesture_FlickLeft", "Flick Left"),
+		LOCTEXT("Ximmerse_Gesture_FlickRight", "Flick Right"),
+		LOCTEXT("Ximmerse_Gesture_ScrollClockwise", "Scroll Clockwise"),
+		LOCTEXT("Ximmerse_Gesture_ScrollCounterClockwise", "Scroll Counter-Clockwise"),
+	};
+	for (int32 Hand = 0; Hand < CONTROLLERS_PER_PLAYER; ++Hand)
+	{
+		for (int32 Gesture = 0; Gesture < EXimmerseTouchGesture::Count; ++Gesture)
+		{
+			const FText DisplayName = FText::Format(LOCTEXT("Ximmerse_Touch_Gesture", "MotionController ({0}) Touchpad {1}"), HandNames[Hand], GestureNames[Gesture]);
+			EKeys::AddKey(FKeyDetails(FKey(XimmerseControllerKeyNames::TouchGestures[Hand][Gesture]), DisplayName, FKeyDetails::GamepadKey));
+		}
+	}
 
 	IModularFeatures::Get().RegisterModularFeature(GetModularFeatureName(), this);
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -84,6 +131,14 @@ FXimmerseInput::FXimmerseInput(const TSharedRef< FGenericApplicationMessageHandl
 FXimmerseInput::~FXimmerseInput()
 {
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	Poller.Reset();
+	Listener.Reset();
+	Simulator.Reset();
+	Watcher.Reset();
+	Capture.Reset();
+	SharedMemory.Reset();
+	Haptics.Reset();
+
 	IModularFeatures::Get().UnregisterModularFeature(GetModularFeatureName(), this);
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 }
@@ -91,226 +146,569 @@ FXimmerseInput::~FXimmerseInput()
 void FXimmerseInput::SendControllerEvents()
 {
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	// nothing to sample before the SDK finished initializing in the background
+	if (!FXimmerseSdkInit::IsReady())
+	{
+		return;
+	}
+
 	ControllerState XControllerState;
 
+	const uint64 StartCycles = FPlatformTime::Cycles64();
 	const double CurrentTime = FPlatformTime::Seconds();
+	int32 NumSamples = 0;
 
-	for (int32 DeviceIndex = 0; DeviceIndex < MaxControllers; ++DeviceIndex)
+	Translator.InitialButtonRepeatDelay = FMath::Max(CVarInitialButtonRepeatDelay.GetValueOnGameThread(), 0.0f);
+	Translator.ButtonRepeatDelay = FMath::Max(CVarButtonRepeatDelay.GetValueOnGameThread(), MIN_BUTTON_REPEAT_DELAY);
+
+	// a replay ends one frame after its last samples were queued, so they are all processed
+	if (Replay.IsValid() && Replay->IsFinished())
 	{
-		// update the mappings if this is a new device
-		if (DeviceToControllerMap[DeviceIndex] == INDEX_NONE)
+		StopReplay();
+	}
+
+	// start or stop the poll thread and the listener whenever the console variable changes, a replay takes their place
+	const int32 InputMode = CVarInputMode.GetValueOnGameThread();
+	const bool bUsePollThread = InputMode == 1 && !Replay.IsValid();
+	if (bUsePollThread != Poller.IsValid())
+	{
+		Poller.Reset(bUsePollThread ? new FXimmerseInputPoller(Registry, *Capture, *SharedMemory) : nullptr);
+	}
+	const float ListenerTimeout = CVarListenerTimeout.GetValueOnGameThread();
+	if (Listener.IsValid() && ListenerTimeout > 0.0f && Listener->IsSilent(CurrentTime, ListenerTimeout))
+	{
+		UE_LOG(LogXimmerseInput, Warning, TEXT("No Ximmerse SDK callback in %.1f s, polling the devices instead"), ListenerTimeout);
+		bListenerSilent = true;
+	}
+	bListenerSilent &= InputMode == 2;
+	const bool bUseListener = InputMode == 2 && !bListenerSilent && !Replay.IsValid();
+	if (bUseListener != Listener.IsValid())
+	{
+		Listener.Reset(bUseListener ? new FXimmerseInputListener(Registry) : nullptr);
+	}
+
+	if (Replay.IsValid())
+	{
+		ReplayCapture(CurrentTime);
+	}
+	else if (!Poller.IsValid())
+	{
+		FXimmerseSdkClock::Sync();
+	}
+
+	// the tracker's newest frame, if it has one since the last poll; a replay has no blobs
+	if (!Replay.IsValid())
+	{
+		MarkerTracker.Poll(Registry.GetTrackerHandle());
+	}
+
+	// controllers that appeared since the last frame get a fresh state, their slot decides player and hand
+	const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+	while (ControllerStates.Num() < Devices.Num())
+	{
+		const int32 DeviceIndex = ControllerStates.AddZeroed();
+		ControllerSlots.AddZeroed();
+		ControllerSlots[DeviceIndex].Hand = (EControllerHand)(DeviceIndex % CONTROLLERS_PER_PLAYER);
+	}
+
+	if (Listener.IsValid())
+	{
+		// every button edge the callbacks reported arrives as a sample of its own
+		Listener->Drain([&](int32 DeviceIndex, ControllerState& PushedState, double EventTime)
 		{
-			// don't map too many controllers
-			if (NumControllersMapped >= MaxControllers)
+			if (!ControllerStates.IsValidIndex(DeviceIndex) || !Devices.IsValidIndex(DeviceIndex) || Devices[DeviceIndex] == nullptr)
 			{
-				continue;
+				return;
 			}
 
-			DeviceToControllerMap[DeviceIndex] = FMath::FloorToInt(NumControllersMapped / CONTROLLERS_PER_PLAYER);
-			ControllerToDeviceMap[NumControllersMapped] = DeviceIndex;
-			ControllerStates[DeviceIndex].Hand = (EControllerHand)(NumControllersMapped % CONTROLLERS_PER_PLAYER);
-			++NumControllersMapped;
-		}
+			FXimmerseDevice& Device = *Devices[DeviceIndex];
+			XIMMERSE_TRACE(Sample(DeviceIndex, PushedState));
 
-		// get the controller index for this device
-		int32 ControllerIndex = DeviceToControllerMap[DeviceIndex];
-		FControllerState& ControllerState = ControllerStates[DeviceIndex];
-		EControllerHand HandToUse = ControllerState.Hand;
+			if (Capture->IsRecording())
+			{
+				Capture->Append(DeviceIndex, Device.Status.Read().TrackingResult, PushedState, CurrentTime);
+			}
+
+			ProcessControllerState(Device, DeviceIndex, GetHandToUse(DeviceIndex), PushedState, CurrentTime);
+			++NumSamples;
+		});
+	}
 
-		// check to see if we need to swap input hands for debugging
-		static const auto CVar = IConsoleManager::Get().FindTConsoleVariableDataInt(TEXT("vr.SwapMotionControllerInput"));
-		bool bSwapHandInput = (CVar->GetValueOnGameThread() != 0) ? true : false;
-		if (bSwapHandInput)
+	for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+	{
+		if (Devices[DeviceIndex] == nullptr)
 		{
-			HandToUse = (HandToUse == EControllerHand::Left) ? EControllerHand::Right : EControllerHand::Left;
+			continue;
 		}
 
-		if (XDeviceGetInputState(DeviceHandle[DeviceIndex], &XControllerState) >= 0)
+		FXimmerseDevice& Device = *Devices[DeviceIndex];
+		FXimmerseControllerInputState& ControllerState = ControllerStates[DeviceIndex];
+		FControllerSlot& ControllerSlot = ControllerSlots[DeviceIndex];
+		const EControllerHand HandToUse = GetHandToUse(DeviceIndex);
+
+		if (Poller.IsValid() || Replay.IsValid())
+		{
+			// drain everything the poll thread or the replay queued since last frame, so no button edge is missed
+			while (Device.Samples.Dequeue(XControllerState))
+			{
+				ProcessControllerState(Device, DeviceIndex, HandToUse, XControllerState, CurrentTime);
+				++NumSamples;
+			}
+		}
+		else if (Listener.IsValid())
 		{
-			if (XControllerState.timestamp != ControllerState.Timestamp)
+			// input arrives without asking, only the status still needs a query now and then
+			if (CurrentTime - Device.LastStatusTime >= STATUS_REFRESH_INTERVAL)
 			{
-				bool CurrentStates[EXimmerseInputButton::TotalButtonCount] = { 0 };
+				Device.RefreshStatus();
+				Device.LastStatusTime = CurrentTime;
+			}
+		}
+		else
+		{
+			// one status query per frame serves every tracking status request until the next one
+			Device.RefreshStatus();
 
-				// Get the current state of all buttons
-				CurrentStates[EXimmerseInputButton::System] = !!(XControllerState.buttons & CONTROLLER_BUTTON_HOME);
-				CurrentStates[EXimmerseInputButton::ApplicationMenu] = !!(XControllerState.buttons & CONTROLLER_BUTTON_APP);
-				CurrentStates[EXimmerseInputButton::TouchPadPress] = !!(XControllerState.buttons & CONTROLLER_BUTTON_CLICK);
-				CurrentStates[EXimmerseInputButton::TouchPadTouch] = !!(XControllerState.buttons & CONTROLLER_BUTTON_TOUCH);
-				CurrentStates[EXimmerseInputButton::Grip] = !!(XControllerState.buttons & (CONTROLLER_BUTTON_LEFT_GRIP | CONTROLLER_BUTTON_RIGHT_GRIP));
+			if (XIMMERSE_SDK_CALL(GetInputState, Device.Handle, XDeviceGetInputState(Device.Handle, &XControllerState)) >= 0)
+			{
+				XIMMERSE_TRACE(Sample(DeviceIndex, XControllerState));
 
-				// If the touchpad isn't currently pressed or touched, zero put both of the axes
-				if (!CurrentStates[EXimmerseInputButton::TouchPadTouch])
+				if (Capture->IsRecording() && XControllerState.timestamp != ControllerState.Timestamp)
 				{
-					XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X] = 0.0f;
-					XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y] = 0.0f;
+					Capture->Append(DeviceIndex, Device.Status.Read().TrackingResult, XControllerState, CurrentTime);
 				}
 
-				// D-pad emulation
-				const FVector2D TouchDir = FVector2D(XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X], XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y]).GetSafeNormal();
-				const FVector2D UpDir(0.f, 1.f);
-				const FVector2D RightDir(1.f, 0.f);
+				ProcessControllerState(Device, DeviceIndex, HandToUse, XControllerState, CurrentTime);
+				++NumSamples;
+			}
+		}
 
-				const float VerticalDot = TouchDir | UpDir;
-				const float RightDot = TouchDir | RightDir;
+		// a controller that dropped out must not leave buttons held down until it comes back
+		const bool bConnected = Device.Status.Read().IsConnected();
+		if (ControllerSlot.bConnected && !bConnected)
+		{
+			ReleaseControllerState(DeviceIndex, HandToUse);
+		}
+		ControllerSlot.bConnected = bConnected;
+	}
 
-				const bool bPressed = !TouchDir.IsNearlyZero() && CurrentStates[EXimmerseInputButton::TouchPadPress];
+	// only held buttons have timers, and only the due ones are looked at
+	Translator.SendButtonRepeats(EventQueue, CurrentTime);
 
-				CurrentStates[EXimmerseInputButton::TouchPadUp] = bPressed && (VerticalDot >= DOT_45DEG);
-				CurrentStates[EXimmerseInputButton::TouchPadDown] = bPressed && (VerticalDot <= -DOT_45DEG);
-				CurrentStates[EXimmerseInputButton::TouchPadLeft] = bPressed && (RightDot <= -DOT_45DEG);
-				CurrentStates[EXimmerseInputButton::TouchPadRight] = bPressed && (RightDot >= DOT_45DEG);
+	// the events of every controller reach the handler in the order the samples were taken, and their latency is
+	// recorded as they do; replayed events are timed to the frame
+	EventQueue.Dispatch(*MessageHandler, !Replay.IsValid() ? &Latency : nullptr);
 
-				if (ControllerState.TouchPadXAnalog != XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X])
-				{
-					const FGamepadKeyNames::Type AxisButton = (HandToUse == EControllerHand::Left) ? FGamepadKeyNames::MotionController_Left_Thumbstick_X : FGamepadKeyNames::MotionController_Right_Thumbstick_X;
-					MessageHandler->OnControllerAnalog(AxisButton, ControllerIndex, XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X]);
-					ControllerState.TouchPadXAnalog = XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X];
-				}
+	XIMMERSE_TRACE(Timing(FPlatformTime::Cycles64() - StartCycles, NumSamples));
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+}
 
-				if (ControllerState.TouchPadYAnalog != XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y])
-				{
-					const FGamepadKeyNames::Type AxisButton = (HandToUse == EControllerHand::Left) ? FGamepadKeyNames::MotionController_Left_Thumbstick_Y : FGamepadKeyNames::MotionController_Right_Thumbstick_Y;
-					// Invert the y to match UE4 convention
-					const float Value = -XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y];
-					MessageHandler->OnControllerAnalog(AxisButton, ControllerIndex, Value);
-					ControllerState.TouchPadYAnalog = Value;
-				}
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+void FXimmerseInput::ProcessControllerState(FXimmerseDevice& Device, const int32 DeviceIndex, const EControllerHand HandToUse, ControllerState& XControllerState, const double CurrentTime)
+{
+	const int32 ControllerIndex = DeviceIndex / CONTROLLERS_PER_PLAYER;
 
-				if (ControllerState.TriggerAnalog != XControllerState.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER])
-				{
-					const FGamepadKeyNames::Type AxisButton = (HandToUse == EControllerHand::Left) ? FGamepadKeyNames::MotionController_Left_TriggerAxis : FGamepadKeyNames::MotionController_Right_TriggerAxis;
-					MessageHandler->OnControllerAnalog(AxisButton, ControllerIndex, XControllerState.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER]);
-					ControllerState.TriggerAnalog = XControllerState.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER];
+	// captured timestamps come from another session, their latency means nothing and their events are timed to the frame
+	const double DeviceTime = !Replay.IsValid() ? FXimmerseSdkClock::ToSeconds(XControllerState.timestamp) : 0.0;
+	const double SampleTime = (DeviceTime > 0.0) ? DeviceTime : CurrentTime;
 
-					// emulate trigger button state
-					CurrentStates[EXimmerseInputButton::TriggerPress] = ControllerState.TriggerAnalog > 0.5f;
-				}
+	const FXimmerseTranslatedEvents Events = Translator.ProcessControllerState(ControllerStates[DeviceIndex], EventQueue, DeviceIndex, ControllerIndex, HandToUse, XControllerState, SampleTime);
+	if (!Events.bNewSample)
+	{
+		return;
+	}
 
-				// For each button check against the previous state and send the correct message if any
-				for (int32 ButtonIndex = 0; ButtonIndex < EXimmerseInputButton::TotalButtonCount; ++ButtonIndex)
-				{
-					if (CurrentStates[ButtonIndex] != ControllerState.ButtonStates[ButtonIndex])
-					{
-						if (CurrentStates[ButtonIndex])
-						{
-							MessageHandler->OnControllerButtonPressed(Buttons[(int32)HandToUse][ButtonIndex], ControllerIndex, false);
-						}
-						else
-						{
-							MessageHandler->OnControllerButtonReleased(Buttons[(int32)HandToUse][ButtonIndex], ControllerIndex, false);
-						}
-
-						if (CurrentStates[ButtonIndex] != 0)
-						{
-							// this button was pressed - set the button's NextRepeatTime to the InitialButtonRepeatDelay
-							ControllerState.NextRepeatTime[ButtonIndex] = CurrentTime + InitialButtonRepeatDelay;
-						}
-					}
-
-					// Update the state for next time
-					ControllerState.ButtonStates[ButtonIndex] = CurrentStates[ButtonIndex];
-				}
+	// the poll thread or the replay already published this pose when it queued the sample
+	if (!Poller.IsValid() && !Replay.IsValid())
+	{
+		Device.Pose.Publish(XControllerState, Device.Status.Read().TrackingResult, CurrentTime, DeviceTime);
 
-				// get position and rotation here for thread safe
-				ControllerState.Position.X = -XControllerState.position[2] * 100;
-				ControllerState.Position.Y = XControllerState.position[0] * 100;
-				ControllerState.Position.Z = XControllerState.position[1] * 100;
-				FQuat Rotation;
-				Rotation.X = XControllerState.rotation[2];
-				Rotation.Y = -XControllerState.rotation[0];
-				Rotation.Z = -XControllerState.rotation[1];
-				Rotation.W = XControllerState.rotation[3];
-				ControllerState.Orientation = Rotation.Rotator();
-				TrackingResult Result = (TrackingResult)XDeviceGetInt(DeviceHandle[DeviceIndex], FieldID::kField_TrackingResult, 0);
-				if (Result != TrackingResult::kTrackingResult_NotTracked)
-				{
-					UE_LOG(LogXimmerseInput, Log, TEXT("Position(%.1f, %.1f, %.1f), Rotation(%.1f, %.1f, %.1f)"),
-					       ControllerState.Position.X, ControllerState.Position.Y, ControllerState.Position.Z,
-					       ControllerState.Orientation.Roll, ControllerState.Orientation.Pitch, ControllerState.Orientation.Yaw);
-				}
+		if (SharedMemory->IsPublishing())
+		{
+			SharedMemory->Publish(DeviceIndex, Device.Status.Read().TrackingResult, XControllerState, Device.Pose.Read());
+		}
+	}
 
+	PacketEncoder.SetSample(DeviceIndex, Device.Status.Read().TrackingResult, XControllerState);
 
-				ControllerState.Timestamp = XControllerState.timestamp;
-			}
+#if XIMMERSE_INPUT_TRACE_ENABLED
+	const FXimmerseDeviceStatus Status = Device.Status.Read();
+	const FXimmersePose Pose = XimmerseToUnrealPose(XControllerState);
+	XIMMERSE_TRACE(Tracking(DeviceIndex, Status.TrackingResult, Pose.Position, Pose.Orientation.Rotator()));
+	XIMMERSE_TRACE(Events(DeviceIndex, XControllerState.timestamp, Events.NumPressed, Events.NumReleased, Events.NumAnalog));
+#endif // XIMMERSE_INPUT_TRACE_ENABLED
+}
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+void FXimmerseInput::ReleaseControllerState(const int32 DeviceIndex, const EControllerHand HandToUse)
+{
+	// stamped now, after every sample of the controller this frame, so the releases follow their presses
+	Translator.ReleaseControllerState(ControllerStates[DeviceIndex], EventQueue, DeviceIndex, DeviceIndex / CONTROLLERS_PER_PLAYER, HandToUse, FPlatformTime::Seconds());
+	PacketEncoder.ClearSample(DeviceIndex);
+}
+
+EControllerHand FXimmerseInput::GetHandToUse(const int32 DeviceIndex) const
+{
+	EControllerHand HandToUse = ControllerSlots[DeviceIndex].Hand;
+
+	// check to see if we need to swap input hands for debugging
+	static const auto CVar = IConsoleManager::Get().FindTConsoleVariableDataInt(TEXT("vr.SwapMotionControllerInput"));
+	bool bSwapHandInput = (CVar->GetValueOnGameThread() != 0) ? true : false;
+	if (bSwapHandInput)
+	{
+		HandToUse = (HandToUse == EControllerHand::Left) ? EControllerHand::Right : EControllerHand::Left;
+	}
+
+	return HandToUse;
+}
+
+void FXimmerseInput::ReplayCapture(const double CurrentTime)
+{
+	while (const FXimmerseCaptureRecord* Record = Replay->GetDueRecord(CurrentTime))
+	{
+		// a controller that is not plugged in gets a stand-in, so the capture plays back without the hardware
+		FXimmerseDevice& Device = Registry.FindOrAddController(Record->DeviceIndex, FString::Printf(TEXT("%s%d"), REPLAY_DEVICE_PREFIX, Record->DeviceIndex));
+
+		// a full ring is drained next frame, dropping the sample would change the replayed events
+		if (!Device.Samples.Enqueue(Record->State))
+		{
+			break;
+		}
+
+		Device.Pose.Publish(Record->State, Record->TrackingResult, Replay->GetPlaybackTime(*Record));
+
+		if (SharedMemory->IsPublishing())
+		{
+			SharedMemory->Publish(Record->DeviceIndex, Record->TrackingResult, Record->State, Device.Pose.Read());
+		}
+
+		FXimmerseDeviceStatus Status = Device.Status.Read();
+		Status.TrackingResult = Record->TrackingResult;
+		Status.ConnectionState = EXimmerseConnectionState::Connected;
+		Device.Status.Write(Status);
+
+		Replay->Advance();
+	}
+}
+
+bool FXimmerseInput::StartReplay(const FString& Filename, const float Speed)
+{
+	TUniquePtr<FXimmerseCaptureReader> NewReplay(new FXimmerseCaptureReader);
+	if (!NewReplay->Load(Filename, Speed, FPlatformTime::Seconds()))
+	{
+		return false;
+	}
+
+	// the poll thread and the callbacks must not touch the devices while the replay writes them
+	Poller.Reset();
+	Listener.Reset();
+	ResetControllers();
+	Replay = MoveTemp(NewReplay);
+	return true;
+}
+
+void FXimmerseInput::StopReplay()
+{
+	Replay.Reset();
+	ResetControllers();
+
+	// stand-ins give their slots back for a controller plugged in later, plugged in controllers get their status back with the next sample
+	const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+	for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+	{
+		FXimmerseDevice* Device = Devices[DeviceIndex];
+		if (Device == nullptr)
+		{
+			continue;
 		}
 
-		for (int32 ButtonIndex = 0; ButtonIndex < EXimmerseInputButton::TotalButtonCount; ++ButtonIndex)
+		Device->Status.Write(FXimmerseDeviceStatus());
+		if (Device->Handle == INDEX_NONE && Device->Name.StartsWith(REPLAY_DEVICE_PREFIX))
 		{
-			if (ControllerState.ButtonStates[ButtonIndex] != 0 && ControllerState.NextRepeatTime[ButtonIndex] <= CurrentTime)
+			Registry.RemoveController(DeviceIndex);
+			if (ControllerSlots.IsValidIndex(DeviceIndex))
 			{
-				MessageHandler->OnControllerButtonPressed(Buttons[(int32)HandToUse][ButtonIndex], ControllerIndex, true);
+				ControllerSlots[DeviceIndex].bConnected = false;
+			}
+		}
+	}
+}
 
-				// set the button's NextRepeatTime to the ButtonRepeatDelay
-				ControllerState.NextRepeatTime[ButtonIndex] = CurrentTime + ButtonRepeatDelay;
+void FXimmerseInput::ResetControllers()
+{
+	ControllerState XControllerState;
+
+	const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+	for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num() && DeviceIndex < ControllerStates.Num(); ++DeviceIndex)
+	{
+		if (Devices[DeviceIndex] != nullptr)
+		{
+			while (Devices[DeviceIndex]->Samples.Dequeue(XControllerState))
+			{
 			}
+
+			ReleaseControllerState(DeviceIndex, GetHandToUse(DeviceIndex));
 		}
 	}
+
+	EventQueue.Dispatch(*MessageHandler);
+}
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+void FXimmerseInput::SetMessageHandler(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler)
+{
+	MessageHandler = InMessageHandler;
 }
-void FXimmerseInput::SetChannelValue(int32 UnrealControllerId, FForceFeedbackChannelType ChannelType, float Value)
+
+bool FXimmerseInput::Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar)
 {
-#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS && XIMMERSE_INPUT_VIBRATION_ENABLED
-	// Skip unless this is the left or right large channel, which we consider to be the only XimmerseInput feedback channel
-	if (ChannelType != FForceFeedbackChannelType::LEFT_LARGE && ChannelType != FForceFeedbackChannelType::RIGHT_LARGE)
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	if (FParse::Command(&Cmd, TEXT("ximmerse.record")))
 	{
-		return;
+		const FString Argument = FParse::Token(Cmd, false);
+		if (Argument == TEXT("stop"))
+		{
+			Capture->Close();
+			Ar.Logf(TEXT("Ximmerse capture stopped"));
+		}
+		else
+		{
+			const FString Filename = !Argument.IsEmpty() ? Argument : FPaths::Combine(*FPaths::GameLogDir(), TEXT("XimmerseCapture.xcap"));
+			if (Capture->Open(Filename))
+			{
+				Ar.Logf(TEXT("Recording Ximmerse samples to %s"), *Filename);
+			}
+			else
+			{
+				Ar.Logf(TEXT("Failed to create the Ximmerse capture %s"), *Filename);
+			}
+		}
+		return true;
 	}
 
-	const EControllerHand Hand = (ChannelType == FForceFeedbackChannelType::LEFT_LARGE) ? EControllerHand::Left : EControllerHand::Right;
-	const int32 ControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, Hand);
-
-	if ((ControllerIndex >= 0) && (ControllerIndex < MaxControllers))
+	if (FParse::Command(&Cmd, TEXT("ximmerse.latency")))
 	{
-		FControllerState& ControllerState = ControllerStates[ControllerIndex];
+		if (FParse::Command(&Cmd, TEXT("reset")))
+		{
+			Latency.Reset();
+			Ar.Logf(TEXT("Ximmerse input latency reset"));
+		}
+		else
+		{
+			Latency.Dump(Ar);
+		}
+		return true;
+	}
 
-		ControllerState.ForceFeedbackValue = Value;
+	if (FParse::Command(&Cmd, TEXT("ximmerse.shm")))
+	{
+		const FString Argument = FParse::Token(Cmd, false);
+		if (Argument == TEXT("stop"))
+		{
+			Ar.Logf(TEXT("Ximmerse shared memory %s stopped after %lld samples"), *SharedMemory->GetName(), SharedMemory->GetNumPublished());
+			SharedMemory->Close();
+		}
+		else
+		{
+			const FString Name = !Argument.IsEmpty() ? Argument : XIMMERSE_SHARED_MEMORY_NAME;
+			if (SharedMemory->Open(Name))
+			{
+				Ar.Logf(TEXT("Publishing Ximmerse samples to shared memory %s, %d slots"), *Name, XIMMERSE_SHARED_MEMORY_SLOTS);
+			}
+			else
+			{
+				Ar.Logf(TEXT("Failed to map the Ximmerse shared memory %s"), *Name);
+			}
+		}
+		return true;
+	}
 
-		UpdateVibration(ControllerIndex);
+	if (FParse::Command(&Cmd, TEXT("ximmerse.sdkstats")))
+	{
+		if (FParse::Command(&Cmd, TEXT("reset")))
+		{
+			FXimmerseSdkStats::Reset();
+			Ar.Logf(TEXT("Ximmerse SDK call stats reset"));
+		}
+		else
+		{
+			FXimmerseSdkStats::Dump(Ar);
+		}
+		return true;
 	}
-#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
-}
 
+	if (FParse::Command(&Cmd, TEXT("ximmerse.markers")))
+	{
+		const TArray<FXimmerseTrackedMarker>& Markers = MarkerTracker.GetMarkers();
+		Ar.Logf(TEXT("%d Ximmerse tracker markers, %d tracker frames dropped"), Markers.Num(), MarkerTracker.GetNumDroppedFrames());
+		for (const FXimmerseTrackedMarker& Marker : Markers)
+		{
+			Ar.Logf(TEXT("  marker %d (blob %d) at %s, %.1f cm/s, seen %d frames, missed %d"),
+				Marker.TrackId, Marker.BlobId, *Marker.Position.ToString(), Marker.Velocity.Size(), Marker.NumFramesSeen, Marker.NumFramesMissed);
+		}
+		return true;
+	}
 
-void FXimmerseInput::SetChannelValues(int32 UnrealControllerId, const FForceFeedbackValues& Values)
-{
-#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS && XIMMERSE_INPUT_VIBRATION_ENABLED
-	const int32 LeftControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, EControllerHand::Left);
-	if ((LeftControllerIndex >= 0) && (LeftControllerIndex < MaxControllers))
+	if (FParse::Command(&Cmd, TEXT("ximmerse.replay")))
 	{
-		FControllerState& ControllerState = ControllerStates[LeftControllerIndex];
-		ControllerState.ForceFeedbackValue = Values.LeftLarge;
+		const FString Argument = FParse::Token(Cmd, false);
+		if (Argument.IsEmpty() || Argument == TEXT("stop"))
+		{
+			StopReplay();
+			Ar.Logf(TEXT("Ximmerse replay stopped"));
+		}
+		else
+		{
+			const FString SpeedArgument = FParse::Token(Cmd, false);
+			const float Speed = !SpeedArgument.IsEmpty() ? FCString::Atof(*SpeedArgument) : 1.0f;
+			if (StartReplay(Argument, Speed))
+			{
+				Ar.Logf(TEXT("Replaying Ximmerse capture %s at %.2fx"), *Argument, Speed);
+			}
+			else
+			{
+				Ar.Logf(TEXT("Failed to load the Ximmerse capture %s"), *Argument);
+			}
+		}
+		return true;
+	}
 
-		UpdateVibration(LeftControllerIndex);
+	if (FParse::Command(&Cmd, TEXT("ximmerse.sim")))
+	{
+		const FString Argument = FParse::Token(Cmd, false);
+		if (Argument.IsEmpty())
+		{
+			if (Simulator.IsValid())
+			{
+				Simulator->DumpStats(Ar);
+			}
+			else
+			{
+				Ar.Logf(TEXT("No Ximmerse controllers are simulated"));
+			}
+		}
+		else if (Argument == TEXT("stop"))
+		{
+			// the poll thread must not ask for the states of controllers that are going away
+			Poller.Reset();
+			Simulator.Reset();
+			Ar.Logf(TEXT("Ximmerse simulator stopped"));
+		}
+		else if (!FXimmerseSdkInit::IsReady())
+		{
+			Ar.Logf(TEXT("The Ximmerse SDK is still initializing"));
+		}
+		else
+		{
+			const FString RateArgument = FParse::Token(Cmd, false);
+			const FString PatternArgument = FParse::Token(Cmd, false);
+
+			Poller.Reset();
+			Simulator.Reset();
+			Simulator.Reset(new FXimmerseSimulator(
+				FCString::Atoi(*Argument),
+				!RateArgument.IsEmpty() ? FCString::Atof(*RateArgument) : 90.0f,
+				FXimmerseSimulator::ParsePattern(PatternArgument)));
+
+			// the controllers are used from the next frame on instead of the next watcher pass
+			Registry.Refresh();
+			Simulator->DumpStats(Ar);
+		}
+		return true;
 	}
 
-	const int32 RightControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, EControllerHand::Right);
-	if ((RightControllerIndex >= 0) && (RightControllerIndex < MaxControllers))
+	if (FParse::Command(&Cmd, TEXT("ximmerse.haptics")))
 	{
-		FControllerState& ControllerState = ControllerStates[RightControllerIndex];
-		ControllerState.ForceFeedbackValue = Values.RightLarge;
+		if (FParse::Command(&Cmd, TEXT("pulse")))
+		{
+			const FString IndexArgument = FParse::Token(Cmd, false);
+			const FString SecondsArgument = FParse::Token(Cmd, false);
+			const int32 ControllerIndex = !IndexArgument.IsEmpty() ? FCString::Atoi(*IndexArgument) : 0;
+			const float Seconds = !SecondsArgument.IsEmpty() ? FMath::Max(FCString::Atof(*SecondsArgument), 0.01f) : 1.0f;
+
+			// a triangle from off to full strength and back
+			TSharedRef<FXimmerseHapticPattern, ESPMode::ThreadSafe> Pattern = MakeShareable(new FXimmerseHapticPattern);
+			Pattern->SampleRate = 100;
+			const int32 NumSamples = FMath::Max(FMath::RoundToInt(Seconds * Pattern->SampleRate), 1);
+			Pattern->Samples.SetNumUninitialized(NumSamples);
+			for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+			{
+				const float Phase = (float)SampleIndex / NumSamples;
+				Pattern->Samples[SampleIndex] = (uint8)FMath::RoundToInt(255.0f * (1.0f - FMath::Abs(2.0f * Phase - 1.0f)));
+			}
+
+			PlayHapticPattern(ControllerIndex / CONTROLLERS_PER_PLAYER, (EControllerHand)(ControllerIndex % CONTROLLERS_PER_PLAYER), Pattern);
+			Ar.Logf(TEXT("Pulsing Ximmerse controller %d for %.2f s%s"), ControllerIndex, Seconds, (CVarVibration.GetValueOnGameThread() != 0) ? TEXT("") : TEXT(", but ximmerse.Vibration is off"));
+		}
+		else if (FParse::Command(&Cmd, TEXT("stop")))
+		{
+			const FString IndexArgument = FParse::Token(Cmd, false);
+			const int32 ControllerIndex = !IndexArgument.IsEmpty() ? FCString::Atoi(*IndexArgument) : 0;
+			TSharedRef<FXimmerseHapticPattern, ESPMode::ThreadSafe> EmptyPattern = MakeShareable(new FXimmerseHapticPattern);
+			PlayHapticPattern(ControllerIndex / CONTROLLERS_PER_PLAYER, (EControllerHand)(ControllerIndex % CONTROLLERS_PER_PLAYER), EmptyPattern);
+			Ar.Logf(TEXT("Stopped the pattern of Ximmerse controller %d"), ControllerIndex);
+		}
+		else
+		{
+			Ar.Logf(TEXT("Ximmerse haptics: %d commands, %d dropped, %d messages sent"),
+				Haptics->GetNumCommands(), Haptics->GetNumDroppedCommands(), Haptics->GetNumMessagesSent());
+		}
+		return true;
+	}
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 
-		UpdateVibration(RightControllerIndex);
+	return false;
+}
+
+void FXimmerseInput::SetChannelValue(int32 UnrealControllerId, FForceFeedbackChannelType ChannelType, float Value)
+{
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	// Skip unless this is the left or right large channel, which we consider to be the only XimmerseInput feedback channel
+	if (ChannelType != FForceFeedbackChannelType::LEFT_LARGE && ChannelType != FForceFeedbackChannelType::RIGHT_LARGE)
+	{
+		return;
 	}
+
+	const EControllerHand Hand = (ChannelType == FForceFeedbackChannelType::LEFT_LARGE) ? EControllerHand::Left : EControllerHand::Right;
+	SetVibration(UnrealControllerIdToControllerIndex(UnrealControllerId, Hand), Value);
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+}
+
+
+void FXimmerseInput::SetChannelValues(int32 UnrealControllerId, const FForceFeedbackValues& Values)
+{
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	SetVibration(UnrealControllerIdToControllerIndex(UnrealControllerId, EControllerHand::Left), Values.LeftLarge);
+	SetVibration(UnrealControllerIdToControllerIndex(UnrealControllerId, EControllerHand::Right), Values.RightLarge);
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 }
 
 void FXimmerseInput::SetHapticFeedbackValues(int32 UnrealControllerId, int32 Hand, const FHapticFeedbackValues& Values)
 {
-#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS && XIMMERSE_INPUT_VIBRATION_ENABLED
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 	if (Hand != (int32)EControllerHand::Left && Hand != (int32)EControllerHand::Right)
 	{
 		return;
 	}
 
-	const int32 ControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, (EControllerHand)Hand);
-	if (ControllerIndex >= 0 && ControllerIndex < MaxControllers)
-	{
-		FControllerState& ControllerState = ControllerStates[ControllerIndex];
-		ControllerState.ForceFeedbackValue = (Values.Frequency > 0.0f) ? Values.Amplitude : 0.0f;
+	// the motor has a single frequency, any non-zero one runs it
+	SetVibration(UnrealControllerIdToControllerIndex(UnrealControllerId, (EControllerHand)Hand), (Values.Frequency > 0.0f) ? Values.Amplitude : 0.0f);
+#endif
+}
 
-		UpdateVibration(ControllerIndex);
+void FXimmerseInput::PlayHapticPattern(const int32 UnrealControllerId, const EControllerHand Hand, const TSharedRef<const FXimmerseHapticPattern, ESPMode::ThreadSafe>& Pattern)
+{
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	const int32 ControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, Hand);
+	const int32 Handle = GetControllerHandle(ControllerIndex);
+	if (Handle >= 0)
+	{
+		// an empty pattern is how a pattern is stopped before it ends, and all that goes out while vibration is off
+		const bool bPlay = Pattern->Samples.Num() > 0 && CVarVibration.GetValueOnGameThread() != 0;
+		Haptics->PlayPattern(ControllerIndex, Handle, bPlay ? FXimmerseHapticPatternPtr(Pattern) : FXimmerseHapticPatternPtr());
 	}
-#endif
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 }
 
 bool FXimmerseInput::GetControllerOrientationAndPosition(const int32 UnrealControllerId, const EControllerHand DeviceHand, FRotator& OutOrientation, FVector& OutPosition) const
@@ -318,30 +716,56 @@ bool FXimmerseInput::GetControllerOrientationAndPosition(const int32 UnrealContr
 	bool RetVal = false;
 
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
-	const int32 ControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, DeviceHand);
-	int32 DeviceIndex = ControllerToDeviceMap[ControllerIndex];
-
-	OutPosition = ControllerStates[DeviceIndex].Position;
-	OutOrientation = ControllerStates[DeviceIndex].Orientation;
-	RetVal = true;
-
-	// NOT THREAD SAFE
-	//ControllerState XControllerState;
-	//if (XDeviceGetInputState(DeviceHandle[DeviceIndex], &XControllerState) >= 0)
-	//{
-	//	RetVal = true;
-
-	//	OutPosition.X = -XControllerState.position[2] * 100;
-	//	OutPosition.Y = XControllerState.position[0] * 100;
-	//	OutPosition.Z = XControllerState.position[1] * 100;
-
-	//	FQuat Rotation;
-	//	Rotation.X = -XControllerState.rotation[2];
-	//	Rotation.Y = XControllerState.rotation[0];
-	//	Rotation.Z = XControllerState.rotation[1];
-	//	Rotation.W = -XControllerState.rotation[3];
-	//	OutOrientation = Rotation.Rotator();
-	//}
+	const FXimmerseDevice* Device = GetControllerDevice(UnrealControllerId, DeviceHand);
+	if (Device != nullptr)
+	{
+		// lock-free read of the newest published sample, so the render thread can late-latch it
+		const FXimmersePose Pose = Device->Pose.Read();
+		RecordPoseLatency(Pose);
+		OutPosition = Pose.Position;
+		OutOrientation = Pose.Orientation.Rotator();
+		RetVal = true;
+	}
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+	return RetVal;
+}
+
+bool FXimmerseInput::GetControllerPredictedOrientationAndPosition(const int32 UnrealControllerId, const EControllerHand DeviceHand, const double TargetTime, FRotator& OutOrientation, FVector& OutPosition) const
+{
+	bool RetVal = false;
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	const FXimmerseDevice* Device = GetControllerDevice(UnrealControllerId, DeviceHand);
+	if (Device != nullptr)
+	{
+		// the latency is that of the sample, before extrapolation moves its time forward
+		const FXimmersePose NewestPose = Device->Pose.Read();
+		RecordPoseLatency(NewestPose);
+		const FXimmersePose Pose = NewestPose.Predict(TargetTime, CVarMaxPredictionTime.GetValueOnAnyThread());
+		OutPosition = Pose.Position;
+		OutOrientation = Pose.Orientation.Rotator();
+		RetVal = true;
+	}
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+	return RetVal;
+}
+
+bool FXimmerseInput::GetControllerPoseAtTime(const int32 UnrealControllerId, const EControllerHand DeviceHand, const double Time, FRotator& OutOrientation, FVector& OutPosition) const
+{
+	bool RetVal = false;
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+	const FXimmerseDevice* Device = GetControllerDevice(UnrealControllerId, DeviceHand);
+	FXimmersePose Pose;
+	if (Device != nullptr && Device->Pose.ReadAtTime(Time, CVarMaxPredictionTime.GetValueOnAnyThread(), Pose))
+	{
+		// past poses are looked up on purpose, they say nothing about the latency of the newest one
+		OutPosition = Pose.Position;
+		OutOrientation = Pose.Orientation.Rotator();
+		RetVal = true;
+	}
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 
 	return RetVal;
@@ -352,13 +776,15 @@ ETrackingStatus FXimmerseInput::GetControllerTrackingStatus(const int32 UnrealCo
 	ETrackingStatus TrackingStatus = ETrackingStatus::NotTracked;
 
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
-	const int32 ControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, DeviceHand);
-	int32 DeviceIndex = ControllerToDeviceMap[ControllerIndex];
-	TrackingResult Result = (TrackingResult)XDeviceGetInt(DeviceHandle[DeviceIndex], FieldID::kField_TrackingResult, 0);
-	if (Result != TrackingResult::kTrackingResult_NotTracked)
+	const FXimmerseDeviceStatus Status = GetControllerStatus(UnrealControllerId, DeviceHand);
+	if (Status.IsPositionTracked())
 	{
 		TrackingStatus = ETrackingStatus::Tracked;
 	}
+	else if (Status.IsRotationTracked())
+	{
+		TrackingStatus = ETrackingStatus::InertialOnly;
+	}
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 
 	return TrackingStatus;
@@ -367,45 +793,74 @@ ETrackingStatus FXimmerseInput::GetControllerTrackingStatus(const int32 UnrealCo
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 int32 FXimmerseInput::UnrealControllerIdToControllerIndex(const int32 UnrealControllerId, const EControllerHand Hand) const
 {
+	if (UnrealControllerId < 0 || (Hand != EControllerHand::Left && Hand != EControllerHand::Right))
+	{
+		return INDEX_NONE;
+	}
+
 	return UnrealControllerId * CONTROLLERS_PER_PLAYER + (int32)Hand;
 }
 
-void FXimmerseInput::UpdateVibration(const int32 ControllerIndex)
+void FXimmerseInput::SetVibration(const int32 ControllerIndex, const float Amplitude)
 {
-#if XIMMERSE_INPUT_VIBRATION_ENABLED
-	// make sure there is a valid device for this controller
-	int32 DeviceIndex = ControllerToDeviceMap[ControllerIndex];
-	if (DeviceIndex < 0)
+	const int32 Handle = GetControllerHandle(ControllerIndex);
+	if (Handle >= 0)
 	{
-		return;
+		// with vibration off a motor is only ever stopped, the worker sends nothing to one that is not running
+		Haptics->SetAmplitude(ControllerIndex, Handle, (CVarVibration.GetValueOnGameThread() != 0) ? Amplitude : 0.0f);
 	}
+}
 
-	const FControllerState& ControllerState = ControllerStates[ControllerIndex];
-	vr::IVRSystem* VRSystem = GetVRSystem();
+int32 FXimmerseInput::GetControllerHandle(const int32 ControllerIndex) const
+{
+	const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+	return (Devices.IsValidIndex(ControllerIndex) && Devices[ControllerIndex] != nullptr) ? Devices[ControllerIndex]->Handle : INDEX_NONE;
+}
 
-	if (VRSystem == nullptr)
+FXimmerseDeviceStatus FXimmerseInput::GetControllerStatus(const int32 UnrealControllerId, const EControllerHand DeviceHand) const
+{
+	const FXimmerseDevice* Device = GetControllerDevice(UnrealControllerId, DeviceHand);
+	return (Device != nullptr) ? Device->Status.Read() : FXimmerseDeviceStatus();
+}
+
+void FXimmerseInput::RecordPoseLatency(const FXimmersePose& Pose) const
+{
+	if (IsInRenderingThread() && Pose.DeviceTime > 0.0)
 	{
-		return;
+		Latency.RenderThreadPose.Record(FPlatformTime::Seconds() - Pose.DeviceTime);
 	}
+}
 
-	// Map the float values from [0,1] to be more reasonable values for the SteamController.  The docs say that [100,2000] are reasonable values
-	const float LeftIntensity = FMath::Clamp(ControllerState.ForceFeedbackValue * 2000.f, 0.f, 2000.f);
-	if (LeftIntensity > 0.f)
+const FXimmerseDevice* FXimmerseInput::GetControllerDevice(const int32 UnrealControllerId, const EControllerHand DeviceHand) const
+{
+	const int32 ControllerIndex = UnrealControllerIdToControllerIndex(UnrealControllerId, DeviceHand);
+	const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+	return Devices.IsValidIndex(ControllerIndex) ? Devices[ControllerIndex] : nullptr;
+}
+
+void FXimmerseInput::DiscoverDevices()
+{
+	// controllers are resolved on the watcher thread once the SDK is up, never on the game thread
+	if (!Watcher.IsValid())
 	{
-		VRSystem->TriggerHapticPulse(DeviceIndex, TOUCHPAD_AXIS, LeftIntensity);
+		Watcher.Reset(new FXimmerseDeviceWatcher(Registry));
 	}
-#endif
 }
 
 bool FXimmerseInput::IsGamepadAttached() const
 {
+	if (!FXimmerseSdkInit::IsReady())
+	{
+		return false;
+	}
+
 	// Check if at least one motion controller is tracked
 	// Only need to check for at least one player (player index 0)
 	int32 PlayerIndex = 0;
 	ETrackingStatus LeftHandTrackingStatus = GetControllerTrackingStatus(PlayerIndex, EControllerHand::Left);
 	ETrackingStatus RightHandTrackingStatus = GetControllerTrackingStatus(PlayerIndex, EControllerHand::Right);
 
-	return LeftHandTrackingStatus == ETrackingStatus::Tracked || RightHandTrackingStatus == ETrackingStatus::Tracked;
+	return LeftHandTrackingStatus != ETrackingStatus::NotTracked || RightHandTrackingStatus != ETrackingStatus::NotTracked;
 }
 
 #undef LOCTEXT_NAMESPACE
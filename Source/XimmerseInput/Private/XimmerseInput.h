@@ -3,39 +3,25 @@
 
 #include "IXimmerseInputPlugin.h"
 #include "IMotionController.h"
-
-/** Total number of controllers in a set */
-#define CONTROLLERS_PER_PLAYER	2
+#include "XimmerseDeviceRegistry.h"
+#include "XimmerseInputTranslator.h"
+#include "XimmerseLatency.h"
+#include "XimmersePacketCodec.h"
+#include "XimmerseMarkerTracker.h"
+
+class FXimmerseInputPoller;
+class FXimmerseInputListener;
+class FXimmerseDeviceWatcher;
+class FXimmerseCaptureWriter;
+class FXimmerseCaptureReader;
+class FXimmerseSharedMemoryPublisher;
+class FXimmerseHaptics;
+class FXimmerseSimulator;
+struct FXimmerseHapticPattern;
 
 class FXimmerseInput : public IInputDevice, public IMotionController, public IHapticDevice
 {
 public:
-	/** Total number of motion controllers we'll support */
-	static const int32 MaxControllers = 2;
-
-	/**
-	* Buttons on the SteamVR controller
-	*/
-	struct EXimmerseInputButton
-	{
-		enum Type
-		{
-			System,
-			ApplicationMenu,
-			TouchPadPress,
-			TouchPadTouch,
-			TriggerPress,
-			Grip,
-			TouchPadUp,
-			TouchPadDown,
-			TouchPadLeft,
-			TouchPadRight,
-
-			/** Max number of controller buttons.  Must be < 256 */
-			TotalButtonCount
-		};
-	};
-
 	FXimmerseInput(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler);
 	virtual ~FXimmerseInput();
 
@@ -65,76 +51,170 @@ public:
 		return 1.0f;
 	}
 
-	virtual void SetMessageHandler(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler) override
-	{
-		MessageHandler = InMessageHandler;
-	}
+	virtual void SetMessageHandler(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler) override;
 
-	virtual bool Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar) override
-	{
-		return false;
-	}
+	/**
+	* ximmerse.record [file|stop]: records every raw controller sample to a capture file
+	* ximmerse.replay <file> [speed]|stop: plays a capture back instead of sampling the devices
+	* ximmerse.latency [reset]: prints the input latency percentiles since the last reset
+	* ximmerse.shm [name|stop]: publishes every processed sample into a named shared-memory ring for external tools
+	* ximmerse.sdkstats [reset]: prints the calls, time and latency percentiles of every SDK entry point, and the slow calls captured
+	* ximmerse.haptics [pulse <controller index> [seconds]|stop <controller index>]: prints the vibration message counts, ramps a motor up and down, or stops its pattern
+	* ximmerse.sim [<controllers> [rate] [still|motion|buttons|all]|stop]: adds simulated controllers, or prints their statistics
+	*/
+	virtual bool Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar) override;
 
 	virtual bool GetControllerOrientationAndPosition(const int32 UnrealControllerId, const EControllerHand DeviceHand, FRotator& OutOrientation, FVector& OutPosition) const;
 
+	/**
+	* Same as GetControllerOrientationAndPosition, but extrapolated to TargetTime (in FPlatformTime::Seconds())
+	* from the controller's velocity, acceleration and angular velocity. Safe to call from the render thread.
+	*/
+	bool GetControllerPredictedOrientationAndPosition(const int32 UnrealControllerId, const EControllerHand DeviceHand, const double TargetTime, FRotator& OutOrientation, FVector& OutPosition) const;
+
+	/**
+	* Pose of a controller at Time (in FPlatformTime::Seconds()), interpolated between the two published samples
+	* the device stamped around it, or extrapolated past the newest one like GetControllerPredictedOrientationAndPosition. Returns false
+	* if Time is older than the pose history reaches back. Safe to call from any thread.
+	*/
+	bool GetControllerPoseAtTime(const int32 UnrealControllerId, const EControllerHand DeviceHand, const double Time, FRotator& OutOrientation, FVector& OutPosition) const;
+
+	/**
+	* Streams a pattern of amplitudes to a controller's motor, then goes back to the force feedback amplitude, which
+	* does not interrupt it meanwhile. An empty pattern stops the one playing. Returns immediately, the messages go
+	* out on the haptics thread.
+	*/
+	void PlayHapticPattern(const int32 UnrealControllerId, const EControllerHand Hand, const TSharedRef<const FXimmerseHapticPattern, ESPMode::ThreadSafe>& Pattern);
+
 	virtual ETrackingStatus GetControllerTrackingStatus(const int32 UnrealControllerId, const EControllerHand DeviceHand) const;
 
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 
+	/**
+	* Adds every XCobra controller and the XHawk tracker known to the SDK once it finished initializing, then keeps
+	* watching for hot-plugged devices. Returns right away, the devices are resolved on the watcher thread.
+	* XCobra-N becomes controller index N, that is player N / 2, left hand for even N. Simulated XSim-N controllers
+	* are treated the same.
+	*/
+	void DiscoverDevices();
+
 	int32 UnrealControllerIdToControllerIndex(const int32 UnrealControllerId, const EControllerHand Hand) const;
-	void UpdateVibration(const int32 ControllerIndex);
 	virtual bool IsGamepadAttached() const override;
 
+	/**
+	* Compact packets of the controllers' newest samples for replication and spectators, fed with every sample
+	* SendControllerEvents processes. Write and acknowledge them on the game thread.
+	*/
+	FXimmersePacketEncoder& GetPacketEncoder()
+	{
+		return PacketEncoder;
+	}
+
+	/**
+	* Markers the XHawk tracker sees besides the controllers, followed from frame to frame, updated by
+	* SendControllerEvents. Game thread only.
+	*/
+	const TArray<FXimmerseTrackedMarker>& GetTrackedMarkers() const
+	{
+		return MarkerTracker.GetMarkers();
+	}
+
+	/** Cached tracking, connection and battery status of a controller, all zero for unmapped controllers */
+	FXimmerseDeviceStatus GetControllerStatus(const int32 UnrealControllerId, const EControllerHand DeviceHand) const;
+
 private:
 
-	struct FControllerState
+	/** Translates one SDK sample of a device into queued button/analog events and the cached pose */
+	void ProcessControllerState(FXimmerseDevice& Device, const int32 DeviceIndex, const EControllerHand HandToUse, ControllerState& XControllerState, const double CurrentTime);
+
+	/** Queues releases for every held button and zeroes the axes of a controller that disconnected */
+	void ReleaseControllerState(const int32 DeviceIndex, const EControllerHand HandToUse);
+
+	/** Hand whose keys a controller slot sends, honoring vr.SwapMotionControllerInput */
+	EControllerHand GetHandToUse(const int32 DeviceIndex) const;
+
+	/** Queues the captured samples that are due, as if the poll thread had just taken them */
+	void ReplayCapture(const double CurrentTime);
+
+	/** Starts or ends a replay, every controller starts over from a released state */
+	bool StartReplay(const FString& Filename, const float Speed);
+	void StopReplay();
+
+	/** Releases the controllers and drops their queued samples */
+	void ResetControllers();
+
+	/** Queues a new vibration amplitude for a controller slot, see FXimmerseHaptics */
+	void SetVibration(const int32 ControllerIndex, const float Amplitude);
+
+	/** SDK handle of a controller slot, INDEX_NONE if no device is mapped to it */
+	int32 GetControllerHandle(const int32 ControllerIndex) const;
+
+	/** What a controller needs besides its input state, read once per frame rather than once per sample */
+	struct FControllerSlot
 	{
 		/** Which hand this controller is representing */
 		EControllerHand Hand;
 
-		/** If timestamp matches that on your prior call, then the controller state hasn't been changed since
-		* your last call and there is no need to process it. */
-		int Timestamp;
+		/** Whether the device reported a connection last frame */
+		bool bConnected;
+	};
 
-		/** touchpad analog values */
-		float TouchPadXAnalog;
-		float TouchPadYAnalog;
+	/** Records how old a pose is when the render thread reads it */
+	void RecordPoseLatency(const FXimmersePose& Pose) const;
 
-		/** trigger analog value */
-		float TriggerAnalog;
+	/** Returns the device mapped to a controller, or nullptr */
+	const FXimmerseDevice* GetControllerDevice(const int32 UnrealControllerId, const EControllerHand DeviceHand) const;
 
-		/** Last frame's button states, so we only send events on edges */
-		bool ButtonStates[EXimmerseInputButton::TotalButtonCount];
+	/** Controller input states, indexed like the registry's controller slots, each on cache lines of its own */
+	TArray<FXimmerseControllerInputState, TAlignedHeapAllocator<PLATFORM_CACHE_LINE_SIZE>> ControllerStates;
 
-		/** Next time a repeat event should be generated for each button */
-		double NextRepeatTime[EXimmerseInputButton::TotalButtonCount];
+	/** The colder rest of each controller, indexed like ControllerStates */
+	TArray<FControllerSlot> ControllerSlots;
 
-		/** Value for force feedback on this controller hand */
-		float ForceFeedbackValue;
+	/** Every device seen so far, with the latest pose and status of each, safe to read from the render thread */
+	FXimmerseDeviceRegistry Registry;
 
-		FVector Position;
-		FRotator Orientation;
-	};
+	/** Picks up controllers that are plugged in or reconnect */
+	TUniquePtr<FXimmerseDeviceWatcher> Watcher;
+
+	/** Turns samples into button and analog events, along with the button mapping and repeat delays */
+	FXimmerseInputTranslator Translator;
+
+	/** Events of the current frame in sample order, and the timers of the held buttons' repeats */
+	FXimmerseInputEventQueue EventQueue;
+
+	/** Records raw samples while ximmerse.record is running, outlives the poller */
+	TUniquePtr<FXimmerseCaptureWriter> Capture;
+
+	/** Capture being played back, samples are not taken from the SDK meanwhile */
+	TUniquePtr<FXimmerseCaptureReader> Replay;
+
+	/** Publishes the processed samples to other processes while ximmerse.shm is running, outlives the poller */
+	TUniquePtr<FXimmerseSharedMemoryPublisher> SharedMemory;
+
+	/** Time from the device taking a sample to its messages and its pose being consumed, recorded from any thread */
+	mutable FXimmerseLatencyStats Latency;
+
+	/** Optional thread sampling the devices at their native rate, see ximmerse.InputMode */
+	TUniquePtr<FXimmerseInputPoller> Poller;
 
-	/** Mappings between tracked devices and 0 indexed controllers */
-	int32 NumControllersMapped;
-	int32 ControllerToDeviceMap[MaxControllers];
-	int32 DeviceToControllerMap[MaxControllers];
+	/** Optional queue of the SDK's input callbacks, replaces polling, see ximmerse.InputMode */
+	TUniquePtr<FXimmerseInputListener> Listener;
 
-	/** Controller states */
-	FControllerState ControllerStates[MaxControllers];
+	/** The listener heard nothing from the SDK, the devices are polled instead until ximmerse.InputMode changes */
+	bool bListenerSilent;
 
-	/** Delay before sending a repeat message after a button was first pressed */
-	float InitialButtonRepeatDelay;
+	/** Sends the vibration messages off the game thread */
+	TUniquePtr<FXimmerseHaptics> Haptics;
 
-	/** Delay before sending a repeat message after a button has been pressed for a while */
-	float ButtonRepeatDelay;
+	/** Virtual controllers added by ximmerse.sim */
+	TUniquePtr<FXimmerseSimulator> Simulator;
 
-	/** Mapping of controller buttons */
-	FGamepadKeyNames::Type Buttons[CONTROLLERS_PER_PLAYER][EXimmerseInputButton::TotalButtonCount];
+	/** Quantizes every processed sample, see GetPacketEncoder */
+	FXimmersePacketEncoder PacketEncoder;
 
-	friend class FXimmerseInputModule;
-	int32 DeviceHandle[MaxControllers + 1];
+	/** Follows the XHawk's blobs, see GetTrackedMarkers */
+	FXimmerseMarkerTracker MarkerTracker;
 
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 
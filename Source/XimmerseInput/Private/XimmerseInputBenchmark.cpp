@@ -0,0 +1,2519 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseInputTranslator.h"
+#include "XimmersePose.h"
+#include "XimmerseHaptics.h"
+#include "XimmerseInputListener.h"
+#include "XimmerseDevice.h"
+#include "XimmerseDeviceRegistry.h"
+#include "XimmerseInputPoller.h"
+#include "XimmerseCapture.h"
+#include "XimmerseSharedMemory.h"
+#include "XimmerseLatency.h"
+#include "XimmersePacketCodec.h"
+#include "XimmerseMarkerTracker.h"
+#include <ControllerState.h>
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS && !UE_BUILD_SHIPPING
+
+/** Frames simulated per scenario unless the command says otherwise */
+#define BENCHMARK_DEFAULT_FRAMES	100000
+
+/** Controllers driven every frame, one player's pair */
+#define BENCHMARK_CONTROLLERS		CONTROLLERS_PER_PLAYER
+
+/** Simulated frame rate, only matters for button repeats */
+#define BENCHMARK_FRAME_RATE		90.0
+
+/** Real time each input mode is driven by the stub device, in seconds, its sample rate in Hz and the first handle it uses */
+#define INPUT_MODE_SECONDS			2.0
+#define STUB_SAMPLE_RATE			1000.0
+#define STUB_FIRST_HANDLE			1000
+
+/** Key code the stub fires that is no CONTROLLER_BUTTON_* flag, two buttons at once */
+#define STUB_UNKNOWN_KEY			(CONTROLLER_BUTTON_HOME | CONTROLLER_BUTTON_TRIGGER)
+
+/** Real time a pose reader and a status writer share each device layout, in seconds */
+#define CONTENTION_SECONDS			1.0
+
+/** Real time the pose snapshot is hammered for torn reads, in seconds, and the threads reading it meanwhile */
+#define SEQLOCK_SECONDS				1.0
+#define SEQLOCK_READERS				3
+
+/** Synthetic touchpad gestures: trials per sample rate, and the two rates, the device's and a frame poll's */
+#define GESTURE_TRIALS				1200
+#define GESTURE_SAMPLE_RATE			1000.0f
+#define GESTURE_FRAME_RATE			90.0f
+
+/** Packets per second of the codec benchmark, packets before an acknowledgment arrives, one in this many packets is lost */
+#define CODEC_PACKET_RATE			30.0
+#define CODEC_ACK_DELAY				3
+#define CODEC_LOSS_INTERVAL			10
+
+/** Packets of the codec round trip, largest rotation error it accepts in degrees, and the float rounding allowed on top of half a quantization step */
+#define CODEC_ROUND_TRIP_PACKETS	20000
+#define CODEC_MAX_ROTATION_ERROR	0.25f
+#define CODEC_ERROR_SLACK			1.01f
+
+/** Controllers of the button repeat benchmark, all idle but the first, which holds a button throughout */
+#define REPEAT_CONTROLLERS			16
+
+/** Haptic pattern played under per-frame force feedback: samples per second and samples, a quarter second at full strength */
+#define HAPTIC_PATTERN_RATE			100
+#define HAPTIC_PATTERN_SAMPLES		25
+
+/** Status queries the engine makes per frame: the tracking status of every controller on the game and the render thread, and whether a gamepad is attached */
+#define SDKCALL_TRACKING_QUERIES	2
+#define SDKCALL_ATTACHED_QUERIES	1
+
+/** Watcher passes the scaling run times once every controller was found */
+#define SCALING_REFRESHES			1000
+
+/** Connect/disconnect storm: real time in seconds, controllers, reconnections per second and threads reading the registry meanwhile */
+#define STORM_SECONDS				1.0
+#define STORM_CONTROLLERS			8
+#define STORM_TOGGLE_RATE			1000.0
+#define STORM_READERS				2
+
+/** Replays started and stopped after the storm, each publishing a set with a stand-in controller and one without */
+#define STORM_REPLAYS				1000
+
+/** Poll thread run: samples per controller, twice what a ring holds, times each sample is handed out, longest wait in seconds and the time a last poll cycle gets to finish */
+#define POLL_SAMPLES				(2 * FXimmerseDevice::SamplesPerDevice)
+#define POLL_REPEATS				2
+#define POLL_TIMEOUT_SECONDS		10.0
+#define POLL_SETTLE_SECONDS			0.05f
+
+/** Synthetic XHawk frames: frame time in ms, size of the tracked volume and top marker speed in meters, one in this many blobs occluded */
+#define MARKER_FRAME_TIME			16
+#define MARKER_VOLUME_SIZE			2.0f
+#define MARKER_MAX_SPEED			0.5f
+#define MARKER_OCCLUSION_INTERVAL	50
+
+/**
+* Synthetic IMU of the fusion benchmark: sample rate and rate of the tracked orientation in Hz, gyroscope noise in rad/s,
+* accelerometer noise and wrist acceleration in g, tracked orientation noise in rad, and the seconds of every period
+* of FUSION_DROPOUT_PERIOD during which tracking is lost
+*/
+#define FUSION_SAMPLE_RATE			1000.0f
+#define FUSION_REFERENCE_RATE		60.0f
+#define FUSION_GYROSCOPE_NOISE		0.01f
+#define FUSION_ACCELEROMETER_NOISE	0.01f
+#define FUSION_WRIST_ACCELERATION	0.3f
+#define FUSION_REFERENCE_NOISE		0.005f
+#define FUSION_DROPOUT_PERIOD		10.0
+#define FUSION_DROPOUT_TIME			2.0
+
+/** Synthetic motion of the pose history: radius of the circle the controller moves on in cm and turns per second, random lookups per sample rate */
+#define HISTORY_RADIUS				30.0f
+#define HISTORY_FREQUENCY			1.0
+#define HISTORY_LOOKUPS				100000
+
+/** Pose prediction on the pose history's motion: sample rate in Hz, seconds of motion, ximmerse.MaxPredictionTime's default in seconds */
+#define PREDICTION_SAMPLE_RATE		1000.0
+#define PREDICTION_SECONDS			2.0
+#define PREDICTION_MAX_TIME			0.05f
+
+/** Synthetic tracking data for the filter: sample rate in Hz, noise in cm and speed of the moving controller in cm/s */
+#define FILTER_SAMPLE_RATE			100.0f
+#define FILTER_NOISE				0.1f
+#define FILTER_SPEED				50.0f
+
+namespace XimmerseInputBenchmark
+{
+	/** Counts the messages the translator sends and drops them */
+	class FCountingMessageHandler : public FGenericApplicationMessageHandler
+	{
+	public:
+		FCountingMessageHandler()
+			: NumMessages(0)
+			, NumRepeats(0)
+		{
+		}
+
+		virtual bool OnControllerAnalog(FGamepadKeyNames::Type KeyName, int32 ControllerId, float AnalogValue) override
+		{
+			++NumMessages;
+			return true;
+		}
+
+		virtual bool OnControllerButtonPressed(FGamepadKeyNames::Type KeyName, int32 ControllerId, bool IsRepeat) override
+		{
+			++NumMessages;
+			NumRepeats += IsRepeat ? 1 : 0;
+			return true;
+		}
+
+		virtual bool OnControllerButtonReleased(FGamepadKeyNames::Type KeyName, int32 ControllerId, bool IsRepeat) override
+		{
+			++NumMessages;
+			return true;
+		}
+
+		int64 NumMessages;
+		int64 NumRepeats;
+	};
+
+	/**
+	* Forwards to the allocator it replaces and counts the allocations made by one thread.
+	* Never destroyed, memory allocated through it may be freed long after the benchmark.
+	*/
+	class FCountingMalloc : public FMalloc
+	{
+	public:
+		FCountingMalloc(FMalloc* InInner, uint32 InThreadId)
+			: Inner(InInner)
+			, ThreadId(InThreadId)
+			, NumAllocations(0)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override
+		{
+			Inner->Free(Original);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+		{
+			return Inner->QuantizeSize(Count, Alignment);
+		}
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+		{
+			return Inner->GetAllocationSize(Original, SizeOut);
+		}
+
+		virtual void Trim() override
+		{
+			Inner->Trim();
+		}
+
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return Inner->IsInternallyThreadSafe();
+		}
+
+		virtual bool ValidateHeap() override
+		{
+			return Inner->ValidateHeap();
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return Inner->GetDescriptiveName();
+		}
+
+		FMalloc* const Inner;
+		const uint32 ThreadId;
+		volatile int32 NumAllocations;
+
+	private:
+		void CountAllocation()
+		{
+			if (FPlatformTLS::GetCurrentThreadId() == ThreadId)
+			{
+				++NumAllocations;
+			}
+		}
+	};
+
+	namespace EScenario
+	{
+		enum Type
+		{
+			/** Samples keep coming but nothing changes */
+			Idle,
+
+			/** Nothing moves, but the thumb rests on the touchpad and the trigger and pad axes carry sensor noise */
+			NoisyIdle,
+
+			/** Controllers move and a thumb circles on the touchpad, no button changes */
+			ConstantMotion,
+
+			/** Every button and the trigger flip every frame */
+			ButtonMashing,
+
+			Count
+		};
+	}
+
+	static const TCHAR* ScenarioNames[EScenario::Count] = { TEXT("Idle"), TEXT("NoisyIdle"), TEXT("ConstantMotion"), TEXT("ButtonMashing") };
+
+	/** Builds the SDK sample a controller would report in a frame of a scenario */
+	static void MakeSample(EScenario::Type Scenario, int32 Frame, int32 ControllerIndex, ControllerState& OutState)
+	{
+		FMemory::Memzero(OutState);
+		OutState.handle = ControllerIndex;
+		OutState.timestamp = Frame + 1;
+		OutState.rotation[3] = 1.0f;
+		OutState.accelerometer[1] = 1.0f;
+
+		const float Angle = (float)Frame * 0.05f + (float)ControllerIndex;
+
+		switch (Scenario)
+		{
+		case EScenario::NoisyIdle:
+			{
+				// a fixed hash of the frame stands in for noise, so every run sees the same samples
+				const float Noise = (float)((Frame * 7919 + ControllerIndex * 104729) % 1000) / 1000.0f - 0.5f;
+				OutState.buttons = CONTROLLER_BUTTON_TOUCH;
+				OutState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X] = 0.3f + 0.008f * Noise;
+				OutState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y] = -0.2f - 0.008f * Noise;
+				OutState.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER] = 0.015f + 0.01f * Noise;
+			}
+			break;
+
+		case EScenario::ConstantMotion:
+			OutState.buttons = CONTROLLER_BUTTON_TOUCH;
+			OutState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X] = FMath::Cos(Angle);
+			OutState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y] = FMath::Sin(Angle);
+			OutState.position[0] = 0.3f * FMath::Cos(Angle);
+			OutState.position[1] = 1.2f;
+			OutState.position[2] = 0.3f * FMath::Sin(Angle);
+			OutState.rotation[1] = FMath::Sin(Angle * 0.5f);
+			OutState.rotation[3] = FMath::Cos(Angle * 0.5f);
+			OutState.gyroscope[1] = 0.05f * BENCHMARK_FRAME_RATE;
+			break;
+
+		case EScenario::ButtonMashing:
+			if (Frame & 1)
+			{
+				OutState.buttons = CONTROLLER_BUTTON_HOME | CONTROLLER_BUTTON_APP | CONTROLLER_BUTTON_CLICK | CONTROLLER_BUTTON_TOUCH | CONTROLLER_BUTTON_LEFT_GRIP;
+				OutState.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER] = 1.0f;
+				OutState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y] = ((Frame >> 1) & 1) ? 1.0f : -1.0f;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	/** Keeps the optimizer from dropping work whose result is not used */
+	static volatile float Sink = 0.0f;
+
+	struct FResult
+	{
+		double NanosecondsPerControllerFrame;
+		double MessagesPerFrame;
+		int32 NumAllocations;
+	};
+
+	/** Runs the translation path of SendControllerEvents for every controller and frame of a scenario */
+	static FResult RunScenario(EScenario::Type Scenario, int32 NumFrames)
+	{
+		TSharedRef<FCountingMessageHandler> MessageHandler = MakeShareable(new FCountingMessageHandler);
+		FXimmerseInputTranslator Translator;
+		FXimmerseInputEventQueue EventQueue;
+
+		FXimmerseControllerInputState States[BENCHMARK_CONTROLLERS];
+		FMemory::Memzero(States);
+		FXimmersePoseStream Poses[BENCHMARK_CONTROLLERS];
+
+		static FCountingMalloc* CountingMalloc = nullptr;
+		if (CountingMalloc == nullptr)
+		{
+			CountingMalloc = new FCountingMalloc(GMalloc, FPlatformTLS::GetCurrentThreadId());
+		}
+		CountingMalloc->NumAllocations = 0;
+
+		// allocations by other threads in the meantime pass through uncounted
+		GMalloc = CountingMalloc;
+		FPlatformMisc::MemoryBarrier();
+
+		ControllerState XControllerState;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const double CurrentTime = (double)Frame / BENCHMARK_FRAME_RATE;
+			for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+			{
+				const EControllerHand Hand = (EControllerHand)(ControllerIndex % CONTROLLERS_PER_PLAYER);
+				MakeSample(Scenario, Frame, ControllerIndex, XControllerState);
+
+				Translator.ProcessControllerState(States[ControllerIndex], EventQueue, ControllerIndex, 0, Hand, XControllerState, CurrentTime);
+				Poses[ControllerIndex].Publish(XControllerState, kTrackingResult_PoseTracked, CurrentTime);
+
+				// what a reader of GetControllerOrientationAndPosition pays
+				Sink = Poses[ControllerIndex].Read().Orientation.Rotator().Yaw;
+			}
+
+			Translator.SendButtonRepeats(EventQueue, CurrentTime);
+			EventQueue.Dispatch(*MessageHandler);
+		}
+
+		const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+		GMalloc = CountingMalloc->Inner;
+		FPlatformMisc::MemoryBarrier();
+
+		FResult Result;
+		Result.NanosecondsPerControllerFrame = FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / ((double)NumFrames * BENCHMARK_CONTROLLERS);
+		Result.MessagesPerFrame = (double)MessageHandler->NumMessages / NumFrames;
+		Result.NumAllocations = CountingMalloc->NumAllocations;
+		return Result;
+	}
+
+	/** Roughly normal noise with the given standard deviation, from a seeded stream so every run sees the same data */
+	static float Noise(FRandomStream& Random, float StandardDeviation)
+	{
+		// sum of three uniforms, variance 3 * (2^2 / 12) = 1
+		return (Random.FRandRange(-1.0f, 1.0f) + Random.FRandRange(-1.0f, 1.0f) + Random.FRandRange(-1.0f, 1.0f)) * StandardDeviation;
+	}
+
+	/** Filters a resting and a moving controller with jittery positions, reports cost, jitter left and lag */
+	static void RunFilter(int32 NumSamples)
+	{
+		FXimmerseFilterSettings Settings = FXimmerseFilterSettings::Get();
+		Settings.bEnabled = true;
+
+		const float DeltaTime = 1.0f / FILTER_SAMPLE_RATE;
+		const int32 NumSettleSamples = NumSamples / 10;
+
+		FRandomStream Random(0x5813);
+		FXimmerseOneEuroFilter RestingFilter;
+		FXimmerseOneEuroFilter MovingFilter;
+
+		double RawSquaredError = 0.0;
+		double FilteredSquaredError = 0.0;
+		double MovingError = 0.0;
+		uint64 Cycles = 0;
+
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			const FVector Jitter(Noise(Random, FILTER_NOISE), Noise(Random, FILTER_NOISE), Noise(Random, FILTER_NOISE));
+			const FVector MovingTruth(FILTER_SPEED * DeltaTime * Sample, 0.0f, 0.0f);
+
+			FVector Resting = Jitter;
+			FQuat RestingOrientation = FQuat::Identity;
+			FVector Moving = MovingTruth + Jitter;
+			FQuat MovingOrientation = FQuat::Identity;
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			RestingFilter.Filter(Resting, RestingOrientation, DeltaTime, Settings);
+			MovingFilter.Filter(Moving, MovingOrientation, DeltaTime, Settings);
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+
+			if (Sample >= NumSettleSamples)
+			{
+				RawSquaredError += Jitter.SizeSquared();
+				FilteredSquaredError += Resting.SizeSquared();
+				MovingError += MovingTruth.X - Moving.X;
+			}
+		}
+
+		const int32 NumMeasured = NumSamples - NumSettleSamples;
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per controller per sample, jitter at rest %.3f cm -> %.3f cm RMS, lag at %.0f cm/s %.1f ms"),
+			TEXT("OneEuroFilter"),
+			FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / (2.0 * NumSamples),
+			FMath::Sqrt(RawSquaredError / NumMeasured),
+			FMath::Sqrt(FilteredSquaredError / NumMeasured),
+			FILTER_SPEED,
+			MovingError / NumMeasured / FILTER_SPEED * 1000.0);
+	}
+
+	/** Rotation by the rotation vector RotationVector, in radians */
+	static FQuat RotationVectorToQuat(const FVector& RotationVector)
+	{
+		const float Angle = RotationVector.Size();
+		return (Angle > KINDA_SMALL_NUMBER) ? FQuat(RotationVector / Angle, Angle) : FQuat::Identity;
+	}
+
+	/** Angular velocity in rad/s of the fusion benchmark's controller, in its own frame: brisk wrist turns around all three axes */
+	static FVector GetFusionAngularVelocity(double Time)
+	{
+		return FVector(
+			3.0f * FMath::Sin((float)(2.0 * PI * 0.7 * Time)),
+			2.0f * FMath::Sin((float)(2.0 * PI * 1.1 * Time) + 1.0f),
+			4.0f * FMath::Sin((float)(2.0 * PI * 0.5 * Time) + 2.0f));
+	}
+
+	/**
+	* Rotates a synthetic controller with known orientation and feeds the fusion its noisy, biased IMU at 1 kHz and a
+	* noisy tracked orientation at 60 Hz, which drops out now and then. Reports the cost per sample and the error of
+	* the fused orientation against that of the tracked orientation held between its updates.
+	*/
+	static void RunImuFusion(int32 NumSamples)
+	{
+		FXimmerseImuFusionSettings Settings = FXimmerseImuFusionSettings::Get();
+		Settings.bEnabled = true;
+
+		const float DeltaTime = 1.0f / FUSION_SAMPLE_RATE;
+		const int32 SamplesPerReference = FMath::RoundToInt(FUSION_SAMPLE_RATE / FUSION_REFERENCE_RATE);
+		const FVector GyroscopeBias(0.02f, -0.015f, 0.01f);
+
+		FRandomStream Random(0x1A05);
+		FXimmerseImuFusion Fusion;
+		FQuat Truth = FQuat::Identity;
+		FQuat Reference = FQuat::Identity;
+
+		double HeldSquaredError = 0.0;
+		double FusedSquaredError = 0.0;
+		double DropoutSquaredError = 0.0;
+		float HeldMaxError = 0.0f;
+		float FusedMaxError = 0.0f;
+		float DropoutMaxError = 0.0f;
+		int32 NumTracked = 0;
+		int32 NumDropout = 0;
+		uint64 Cycles = 0;
+
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			const double Time = Sample * (double)DeltaTime;
+
+			// the truth moves with the angular velocity of the middle of the interval, the gyroscope measures that
+			const FVector AngularVelocity = GetFusionAngularVelocity(Time - 0.5 * DeltaTime);
+			if (Sample > 0)
+			{
+				Truth = Truth * RotationVectorToQuat(AngularVelocity * DeltaTime);
+				Truth.Normalize();
+			}
+
+			const FVector Gyroscope = AngularVelocity + GyroscopeBias + FVector(Noise(Random, FUSION_GYROSCOPE_NOISE), Noise(Random, FUSION_GYROSCOPE_NOISE), Noise(Random, FUSION_GYROSCOPE_NOISE));
+
+			// the wrist pushes the controller back and forth, the accelerometer sees it on top of gravity
+			const FVector WorldForce = FVector::UpVector + FVector(FUSION_WRIST_ACCELERATION * FMath::Sin((float)(2.0 * PI * 2.0 * Time)), 0.0f, 0.0f);
+			const FVector SpecificForce = Truth.UnrotateVector(WorldForce) + FVector(Noise(Random, FUSION_ACCELEROMETER_NOISE), Noise(Random, FUSION_ACCELEROMETER_NOISE), Noise(Random, FUSION_ACCELEROMETER_NOISE));
+
+			const bool bTracked = FMath::Fmod(Time, FUSION_DROPOUT_PERIOD) < FUSION_DROPOUT_PERIOD - FUSION_DROPOUT_TIME;
+			if (bTracked && Sample % SamplesPerReference == 0)
+			{
+				Reference = Truth * RotationVectorToQuat(FVector(Noise(Random, FUSION_REFERENCE_NOISE), Noise(Random, FUSION_REFERENCE_NOISE), Noise(Random, FUSION_REFERENCE_NOISE)));
+			}
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			const FQuat Fused = Fusion.Update(Gyroscope, SpecificForce, Reference, bTracked, (Sample > 0) ? DeltaTime : 0.0f, Settings);
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+
+			const float FusedError = FMath::RadiansToDegrees(Fused.AngularDistance(Truth));
+			if (bTracked)
+			{
+				const float HeldError = FMath::RadiansToDegrees(Reference.AngularDistance(Truth));
+				HeldSquaredError += FMath::Square(HeldError);
+				HeldMaxError = FMath::Max(HeldMaxError, HeldError);
+				FusedSquaredError += FMath::Square(FusedError);
+				FusedMaxError = FMath::Max(FusedMaxError, FusedError);
+				++NumTracked;
+			}
+			else
+			{
+				DropoutSquaredError += FMath::Square(FusedError);
+				DropoutMaxError = FMath::Max(DropoutMaxError, FusedError);
+				++NumDropout;
+			}
+		}
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per sample, tracked error %.2f deg RMS %.2f deg max (held %.0f Hz orientation %.2f deg RMS %.2f deg max), after %.0f s dropouts %.2f deg RMS %.2f deg max, bias error %.4f rad/s"),
+			TEXT("ImuFusion"),
+			FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / NumSamples,
+			FMath::Sqrt(FusedSquaredError / FMath::Max(NumTracked, 1)),
+			FusedMaxError,
+			FUSION_REFERENCE_RATE,
+			FMath::Sqrt(HeldSquaredError / FMath::Max(NumTracked, 1)),
+			HeldMaxError,
+			FUSION_DROPOUT_TIME,
+			FMath::Sqrt(DropoutSquaredError / FMath::Max(NumDropout, 1)),
+			DropoutMaxError,
+			FVector::Dist(Fusion.GetGyroscopeBias(), GyroscopeBias));
+	}
+
+	/** Where the pose history benchmark's controller truly is at a time: on a circle, facing along it and rocking around its axis */
+	static void GetHistoryTruth(double Time, FVector& OutPosition, FQuat& OutOrientation)
+	{
+		const float Angle = (float)(2.0 * PI * HISTORY_FREQUENCY * Time);
+		OutPosition = FVector(HISTORY_RADIUS * FMath::Cos(Angle), HISTORY_RADIUS * FMath::Sin(Angle), 0.5f * HISTORY_RADIUS * FMath::Sin(2.0f * Angle));
+		OutOrientation = FQuat(FVector::UpVector, Angle) * FQuat(FVector::ForwardVector, 0.5f * FMath::Sin(Angle));
+	}
+
+	/**
+	* What the SDK reports for the pose history's motion at a time, in its own axes: the pose, the gyroscope in rad/s in
+	* the controller's space and the accelerometer's specific force in g, derived from the motion in closed form.
+	*/
+	static void MakeHistorySample(double Time, ControllerState& OutState)
+	{
+		FVector Position;
+		FQuat Orientation;
+		GetHistoryTruth(Time, Position, Orientation);
+
+		const float AngularFrequency = (float)(2.0 * PI * HISTORY_FREQUENCY);
+		const float Angle = (float)(2.0 * PI * HISTORY_FREQUENCY * Time);
+		const FVector Acceleration = -FMath::Square(AngularFrequency) * FVector(HISTORY_RADIUS * FMath::Cos(Angle), HISTORY_RADIUS * FMath::Sin(Angle), 2.0f * HISTORY_RADIUS * FMath::Sin(2.0f * Angle));
+
+		// the yaw turns the rocked controller, so it shows up in the controller's space rotated back by the rocking
+		const FQuat Rocking(FVector::ForwardVector, 0.5f * FMath::Sin(Angle));
+		const FVector AngularVelocity = Rocking.UnrotateVector(FVector(0.0f, 0.0f, AngularFrequency)) + FVector(0.5f * AngularFrequency * FMath::Cos(Angle), 0.0f, 0.0f);
+		const FVector SpecificForce = Orientation.UnrotateVector(Acceleration + FVector(0.0f, 0.0f, XIMMERSE_GRAVITY)) / XIMMERSE_GRAVITY;
+
+		// the inverse of XimmerseToUnrealPose and of the sensor conversions of FXimmersePoseStream::Publish
+		FMemory::Memzero(OutState);
+		OutState.position[0] = Position.Y / 100.0f;
+		OutState.position[1] = Position.Z / 100.0f;
+		OutState.position[2] = -Position.X / 100.0f;
+		OutState.rotation[0] = -Orientation.Y;
+		OutState.rotation[1] = -Orientation.Z;
+		OutState.rotation[2] = Orientation.X;
+		OutState.rotation[3] = Orientation.W;
+		OutState.gyroscope[0] = -AngularVelocity.Y;
+		OutState.gyroscope[1] = -AngularVelocity.Z;
+		OutState.gyroscope[2] = AngularVelocity.X;
+		OutState.accelerometer[0] = SpecificForce.Y;
+		OutState.accelerometer[1] = SpecificForce.Z;
+		OutState.accelerometer[2] = -SpecificForce.X;
+	}
+
+	/**
+	* Publishes the pose history's motion through a pose stream at PREDICTION_SAMPLE_RATE, the way the poll thread does,
+	* and predicts every published pose a frame, two frames and four frames ahead. Reports the cost of a prediction and
+	* its error against the true pose at the target time, next to the error of holding the pose instead. A target past
+	* PREDICTION_MAX_TIME must be predicted exactly as far as PREDICTION_MAX_TIME.
+	*/
+	static void RunPrediction()
+	{
+		const float Horizons[] = { (float)(1.0 / BENCHMARK_FRAME_RATE), (float)(2.0 / BENCHMARK_FRAME_RATE), (float)(4.0 / BENCHMARK_FRAME_RATE) };
+		const int32 NumHorizons = ARRAY_COUNT(Horizons);
+		const int32 NumSamples = (int32)(PREDICTION_SECONDS * PREDICTION_SAMPLE_RATE);
+
+		TUniquePtr<FXimmersePoseStream> Stream(new FXimmersePoseStream);
+		TArray<FXimmersePose> Poses;
+		Poses.SetNumUninitialized(NumSamples);
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			ControllerState XControllerState;
+			MakeHistorySample(Sample / PREDICTION_SAMPLE_RATE, XControllerState);
+			Stream->Publish(XControllerState, kTrackingResult_PoseTracked, Sample / PREDICTION_SAMPLE_RATE);
+			Poses[Sample] = Stream->Read();
+		}
+
+		// the first samples only seed the velocity estimate
+		const int32 FirstSample = (int32)(0.1 * PREDICTION_SAMPLE_RATE);
+		const int32 NumPredictions = NumSamples - FirstSample;
+
+		for (int32 HorizonIndex = 0; HorizonIndex < NumHorizons; ++HorizonIndex)
+		{
+			const float Horizon = Horizons[HorizonIndex];
+			TArray<FXimmersePose> Predicted;
+			Predicted.SetNumUninitialized(NumPredictions);
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (int32 Prediction = 0; Prediction < NumPredictions; ++Prediction)
+			{
+				const FXimmersePose& Pose = Poses[FirstSample + Prediction];
+				Predicted[Prediction] = Pose.Predict(Pose.GetTime() + Horizon, PREDICTION_MAX_TIME);
+			}
+			const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+			double SquaredPositionError = 0.0;
+			double SquaredHoldError = 0.0;
+			float MaxAngleError = 0.0f;
+			float MaxHoldAngleError = 0.0f;
+			for (int32 Prediction = 0; Prediction < NumPredictions; ++Prediction)
+			{
+				const FXimmersePose& Pose = Poses[FirstSample + Prediction];
+				const double TargetTime = Pose.GetTime() + FMath::Min(Horizon, PREDICTION_MAX_TIME);
+				FVector Position;
+				FQuat Orientation;
+				GetHistoryTruth(TargetTime, Position, Orientation);
+
+				SquaredPositionError += FVector::DistSquared(Predicted[Prediction].Position, Position);
+				SquaredHoldError += FVector::DistSquared(Pose.Position, Position);
+				MaxAngleError = FMath::Max(MaxAngleError, FMath::RadiansToDegrees(Predicted[Prediction].Orientation.AngularDistance(Orientation)));
+				MaxHoldAngleError = FMath::Max(MaxHoldAngleError, FMath::RadiansToDegrees(Pose.Orientation.AngularDistance(Orientation)));
+			}
+
+			UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per prediction, position error %.3f cm RMS (%.3f cm held), rotation error %.3f deg max (%.3f deg held)"),
+				*FString::Printf(TEXT("Predict%.0fms"), Horizon * 1000.0f),
+				FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / NumPredictions,
+				FMath::Sqrt(SquaredPositionError / NumPredictions),
+				FMath::Sqrt(SquaredHoldError / NumPredictions),
+				MaxAngleError,
+				MaxHoldAngleError);
+			if (SquaredPositionError >= SquaredHoldError || MaxAngleError >= MaxHoldAngleError)
+			{
+				UE_LOG(LogXimmerseInput, Error, TEXT("Predicting %.0f ms ahead is further off the true motion than holding the pose"), Horizon * 1000.0f);
+			}
+		}
+
+		// a target twice the clamp away lands where the clamp does, nothing is extrapolated further
+		int32 NumUnclamped = 0;
+		for (int32 Prediction = 0; Prediction < NumPredictions; ++Prediction)
+		{
+			const FXimmersePose& Pose = Poses[FirstSample + Prediction];
+			const FXimmersePose Clamped = Pose.Predict(Pose.GetTime() + 2.0f * PREDICTION_MAX_TIME, PREDICTION_MAX_TIME);
+			const FXimmersePose AtClamp = Pose.Predict(Pose.GetTime() + PREDICTION_MAX_TIME, PREDICTION_MAX_TIME);
+			NumUnclamped += (Clamped.GetTime() - Pose.GetTime() > PREDICTION_MAX_TIME + 0.000001 || !Clamped.Position.Equals(AtClamp.Position, 0.01f)) ? 1 : 0;
+		}
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %d of %d predictions past %.0f ms went further than that"),
+			TEXT("PredictClamp"),
+			NumUnclamped,
+			NumPredictions,
+			PREDICTION_MAX_TIME * 1000.0f);
+		if (NumUnclamped > 0)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("Poses were extrapolated past the prediction limit"));
+		}
+	}
+
+	/**
+	* Fills a pose history with the synthetic motion sampled at SampleRate, then looks poses up at random times within
+	* it. Reports the cost of a lookup and how far the interpolated poses are from the truth.
+	*/
+	static void RunPoseHistory(double SampleRate)
+	{
+		TUniquePtr<FXimmersePoseHistory> History(new FXimmersePoseHistory);
+
+		// wrap the ring around once so lookups run on a full history that keeps being overwritten
+		const int32 NumSamples = 2 * XIMMERSE_POSE_HISTORY_SIZE;
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			FXimmersePose Pose;
+			FMemory::Memzero(Pose);
+			Pose.SampleTime = Sample / SampleRate;
+			GetHistoryTruth(Pose.SampleTime, Pose.Position, Pose.Orientation);
+			History->Add(Pose);
+		}
+
+		const double OldestTime = (NumSamples - History->Num()) / SampleRate;
+		const double NewestTime = (NumSamples - 1) / SampleRate;
+
+		// the times are drawn up front, the random stream is not part of a lookup's cost
+		FRandomStream Random(0x7135);
+		TArray<double> Times;
+		Times.SetNumUninitialized(HISTORY_LOOKUPS);
+		for (double& Time : Times)
+		{
+			Time = OldestTime + Random.GetFraction() * (NewestTime - OldestTime);
+		}
+
+		TArray<FXimmersePose> Poses;
+		Poses.SetNumUninitialized(HISTORY_LOOKUPS);
+		int32 NumFound = 0;
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Lookup = 0; Lookup < HISTORY_LOOKUPS; ++Lookup)
+		{
+			NumFound += History->Sample(Times[Lookup], 0.0f, Poses[Lookup]) ? 1 : 0;
+		}
+		const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+		double SquaredPositionError = 0.0;
+		float MaxPositionError = 0.0f;
+		float MaxAngleError = 0.0f;
+		for (int32 Lookup = 0; Lookup < HISTORY_LOOKUPS; ++Lookup)
+		{
+			FVector Position;
+			FQuat Orientation;
+			GetHistoryTruth(Times[Lookup], Position, Orientation);
+
+			const float PositionError = FVector::Dist(Poses[Lookup].Position, Position);
+			SquaredPositionError += FMath::Square(PositionError);
+			MaxPositionError = FMath::Max(MaxPositionError, PositionError);
+			MaxAngleError = FMath::Max(MaxAngleError, FMath::RadiansToDegrees(Poses[Lookup].Orientation.AngularDistance(Orientation)));
+		}
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per lookup in %d poses, %d of %d found, position error %.4f cm RMS %.4f cm max, rotation error %.4f deg max"),
+			*FString::Printf(TEXT("PoseHistory%.0fHz"), SampleRate),
+			FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / HISTORY_LOOKUPS,
+			History->Num(),
+			NumFound,
+			HISTORY_LOOKUPS,
+			FMath::Sqrt(SquaredPositionError / HISTORY_LOOKUPS),
+			MaxPositionError,
+			MaxAngleError);
+	}
+
+	/** One touchpad sample of a synthetic gesture */
+	struct FTouchSample
+	{
+		FVector2D Position;
+		int32 Timestamp;
+		bool bTouching;
+	};
+
+	/** Progress along a stroke that eases in and out, 0 to 1 */
+	static float SmoothStep(float Alpha)
+	{
+		return Alpha * Alpha * (3.0f - 2.0f * Alpha);
+	}
+
+	/**
+	* Builds the samples of a thumb performing a gesture with random variations, ending with the sample that
+	* reports the thumb lifted. Taps and holds wander a little, swipes slow down before lifting, flicks speed up.
+	*/
+	static void MakeGestureTrace(EXimmerseTouchGesture::Type Gesture, float SampleRate, FRandomStream& Random, TArray<FTouchSample>& OutSamples)
+	{
+		OutSamples.Reset();
+
+		const FVector2D Directions[4] = { FVector2D(0.0f, 1.0f), FVector2D(0.0f, -1.0f), FVector2D(-1.0f, 0.0f), FVector2D(1.0f, 0.0f) };
+
+		float Duration;
+		FVector2D Start = FVector2D::ZeroVector;
+		FVector2D Stroke = FVector2D::ZeroVector;
+		float Radius = 0.0f;
+		float StartAngle = 0.0f;
+		float SweepAngle = 0.0f;
+
+		switch (Gesture)
+		{
+		case EXimmerseTouchGesture::Tap:
+		case EXimmerseTouchGesture::Hold:
+			Duration = (Gesture == EXimmerseTouchGesture::Tap) ? Random.FRandRange(0.05f, 0.25f) : Random.FRandRange(0.6f, 1.2f);
+			Start = FVector2D(Random.FRandRange(-0.6f, 0.6f), Random.FRandRange(-0.6f, 0.6f));
+			break;
+
+		case EXimmerseTouchGesture::ScrollClockwise:
+		case EXimmerseTouchGesture::ScrollCounterClockwise:
+			Duration = Random.FRandRange(0.4f, 0.8f);
+			Radius = Random.FRandRange(0.6f, 0.85f);
+			StartAngle = Random.FRandRange(0.0f, 2.0f * PI);
+			SweepAngle = FMath::DegreesToRadians(Random.FRandRange(200.0f, 400.0f)) * ((Gesture == EXimmerseTouchGesture::ScrollClockwise) ? -1.0f : 1.0f);
+			break;
+
+		default:
+			{
+				const bool bFlick = Gesture >= EXimmerseTouchGesture::FlickUp;
+				const FVector2D Direction = Directions[Gesture - (bFlick ? EXimmerseTouchGesture::FlickUp : EXimmerseTouchGesture::SwipeUp)];
+				const FVector2D Across(-Direction.Y, Direction.X);
+
+				// strokes are centered off the middle of the pad and up to 20 degrees off their axis
+				const float Length = bFlick ? Random.FRandRange(0.4f, 0.8f) : Random.FRandRange(0.8f, 1.4f);
+				const float Skew = FMath::DegreesToRadians(Random.FRandRange(-20.0f, 20.0f));
+				Duration = bFlick ? Random.FRandRange(0.05f, 0.12f) : Random.FRandRange(0.25f, 0.5f);
+				Stroke = (Direction * FMath::Cos(Skew) + Across * FMath::Sin(Skew)) * Length;
+				Start = Across * Random.FRandRange(-0.3f, 0.3f) - Stroke * 0.5f;
+			}
+			break;
+		}
+
+		const int32 NumSamples = FMath::Max(FMath::CeilToInt(Duration * SampleRate), 1);
+		for (int32 SampleIndex = 0; SampleIndex <= NumSamples; ++SampleIndex)
+		{
+			const float Alpha = (float)SampleIndex / NumSamples;
+
+			FVector2D Position;
+			if (SweepAngle != 0.0f)
+			{
+				const float Angle = StartAngle + SweepAngle * SmoothStep(Alpha);
+				Position = FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * (Radius + Random.FRandRange(-0.03f, 0.03f));
+			}
+			else if (Gesture >= EXimmerseTouchGesture::FlickUp)
+			{
+				Position = Start + Stroke * (Alpha * Alpha);
+			}
+			else
+			{
+				Position = Start + Stroke * SmoothStep(Alpha);
+			}
+
+			FTouchSample Sample;
+			Sample.Position = Position + FVector2D(Random.FRandRange(-0.02f, 0.02f), Random.FRandRange(-0.02f, 0.02f));
+			Sample.Timestamp = FMath::RoundToInt(SampleIndex * 1000.0f / SampleRate);
+			Sample.bTouching = true;
+			OutSamples.Add(Sample);
+		}
+
+		FTouchSample Lifted;
+		Lifted.Position = FVector2D::ZeroVector;
+		Lifted.Timestamp = FMath::RoundToInt((NumSamples + 1) * 1000.0f / SampleRate);
+		Lifted.bTouching = false;
+		OutSamples.Add(Lifted);
+	}
+
+	/** Performs every gesture many times at a sample rate, reports how many were recognized and the cost per sample */
+	static void RunTouchGestures(int32 NumTrials, float SampleRate)
+	{
+		FXimmerseTouchGestureRecognizer Recognizer;
+		FXimmerseTouchGestureState State;
+		FMemory::Memzero(State);
+
+		FRandomStream Random(0x7a9);
+		TArray<FTouchSample> Samples;
+
+		int32 NumCorrect = 0;
+		int32 NumWrong = 0;
+		int32 NumMissed = 0;
+		int32 NumCorrectByGesture[EXimmerseTouchGesture::Count] = { 0 };
+		int64 NumSamples = 0;
+		uint64 Cycles = 0;
+
+		for (int32 Trial = 0; Trial < NumTrials; ++Trial)
+		{
+			const EXimmerseTouchGesture::Type Gesture = (EXimmerseTouchGesture::Type)(Trial % EXimmerseTouchGesture::Count);
+			MakeGestureTrace(Gesture, SampleRate, Random, Samples);
+
+			// a trial is right if its gesture went down and nothing else did
+			uint32 Pressed = 0;
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (const FTouchSample& Sample : Samples)
+			{
+				Pressed |= Recognizer.Update(State, Sample.bTouching, Sample.Position, Sample.Timestamp).Pressed;
+			}
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+			NumSamples += Samples.Num();
+
+			if (Pressed == (1u << Gesture))
+			{
+				++NumCorrect;
+				++NumCorrectByGesture[Gesture];
+			}
+			else if (Pressed == 0)
+			{
+				++NumMissed;
+			}
+			else
+			{
+				++NumWrong;
+			}
+		}
+
+		FString PerGesture;
+		const int32 NumTrialsPerGesture = FMath::Max(NumTrials / EXimmerseTouchGesture::Count, 1);
+		for (int32 Gesture = 0; Gesture < EXimmerseTouchGesture::Count; ++Gesture)
+		{
+			PerGesture += FString::Printf(TEXT(" %.0f"), 100.0 * NumCorrectByGesture[Gesture] / NumTrialsPerGesture);
+		}
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per sample at %.0f Hz, %d of %d gestures recognized (%.1f%%), %d wrong, %d missed, %d bytes of state"),
+			TEXT("TouchGestures"),
+			FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / FMath::Max(NumSamples, (int64)1),
+			SampleRate,
+			NumCorrect,
+			NumTrials,
+			100.0 * NumCorrect / FMath::Max(NumTrials, 1),
+			NumWrong,
+			NumMissed,
+			(int32)sizeof(FXimmerseTouchGestureState));
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s percent recognized per EXimmerseTouchGesture:%s"), TEXT(""), *PerGesture);
+	}
+
+	/**
+	* Carries packets from an encoder to a decoder: every CODEC_LOSS_INTERVAL-th packet is lost, the
+	* acknowledgments of the others reach the encoder CODEC_ACK_DELAY packets later.
+	*/
+	struct FPacketLink
+	{
+		FXimmersePacketEncoder Encoder;
+		FXimmersePacketDecoder Decoder;
+
+		/** Sequence number of each packet in flight back to the encoder, INDEX_NONE for a lost packet */
+		TArray<int32> PendingAcks;
+
+		int32 NumPackets;
+		int64 NumBits;
+		uint64 EncodeCycles;
+		uint64 DecodeCycles;
+
+		FPacketLink()
+			: NumPackets(0)
+			, NumBits(0)
+			, EncodeCycles(0)
+			, DecodeCycles(0)
+		{
+		}
+
+		/** Sends a packet of the encoder's current samples, returns true and fills OutPacket if it was decoded */
+		bool Send(FXimmerseDecodedPacket& OutPacket)
+		{
+			FBitWriter Writer(FXimmersePacketEncoder::GetMaxPacketBits());
+
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			const uint16 Sequence = Encoder.WritePacket(Writer);
+			EncodeCycles += FPlatformTime::Cycles64() - StartCycles;
+
+			++NumPackets;
+			NumBits += Writer.GetNumBits();
+
+			bool bDecoded = false;
+			if ((NumPackets % CODEC_LOSS_INTERVAL) != 0)
+			{
+				FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+
+				StartCycles = FPlatformTime::Cycles64();
+				bDecoded = Decoder.ReadPacket(Reader, OutPacket);
+				DecodeCycles += FPlatformTime::Cycles64() - StartCycles;
+			}
+
+			PendingAcks.Add(bDecoded ? Sequence : INDEX_NONE);
+			if (PendingAcks.Num() > CODEC_ACK_DELAY)
+			{
+				if (PendingAcks[0] != INDEX_NONE)
+				{
+					Encoder.Acknowledge((uint16)PendingAcks[0]);
+				}
+				PendingAcks.RemoveAt(0);
+			}
+			return bDecoded;
+		}
+	};
+
+	/** Sends the controllers of every scenario at CODEC_PACKET_RATE, reports the bandwidth and the cost of encoding and decoding */
+	static void RunPacketCodec(int32 NumFrames)
+	{
+		const int32 FramesPerPacket = FMath::Max(FMath::RoundToInt(BENCHMARK_FRAME_RATE / CODEC_PACKET_RATE), 1);
+
+		// what replicating an FVector, an FRotator and the button bits of every controller costs
+		const int32 UnpackedBytes = BENCHMARK_CONTROLLERS * (sizeof(FVector) + sizeof(FRotator) + sizeof(uint32));
+
+		for (int32 Scenario = 0; Scenario < EScenario::Count; ++Scenario)
+		{
+			FPacketLink Link;
+			FXimmerseDecodedPacket Decoded;
+			ControllerState XControllerState;
+
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+				{
+					MakeSample((EScenario::Type)Scenario, Frame, ControllerIndex, XControllerState);
+					Link.Encoder.SetSample(ControllerIndex, kTrackingResult_PoseTracked, XControllerState);
+				}
+
+				if ((Frame % FramesPerPacket) == 0)
+				{
+					Link.Send(Decoded);
+				}
+			}
+
+			const double BytesPerPacket = Link.NumBits / 8.0 / FMath::Max(Link.NumPackets, 1);
+			UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %6.1f bytes per packet (%d unpacked, %d at most), %.2f kbit/s at %.0f Hz, encode %.1f ns, decode %.1f ns per packet"),
+				*FString::Printf(TEXT("Codec%s"), ScenarioNames[Scenario]),
+				BytesPerPacket,
+				UnpackedBytes,
+				(FXimmersePacketEncoder::GetMaxPacketBits() + 7) / 8,
+				BytesPerPacket * 8.0 * CODEC_PACKET_RATE / 1000.0,
+				CODEC_PACKET_RATE,
+				FPlatformTime::GetSecondsPerCycle64() * Link.EncodeCycles * 1000000000.0 / FMath::Max(Link.NumPackets, 1),
+				FPlatformTime::GetSecondsPerCycle64() * Link.DecodeCycles * 1000000000.0 / FMath::Max(Link.NumPackets, 1));
+		}
+	}
+
+	/** Angle in degrees between two SDK rotations */
+	static float GetRotationError(const float* Expected, const float* Actual)
+	{
+		const FQuat ExpectedQuat(Expected[0], Expected[1], Expected[2], Expected[3]);
+		const FQuat ActualQuat(Actual[0], Actual[1], Actual[2], Actual[3]);
+		const float Dot = FMath::Min(FMath::Abs(ExpectedQuat.GetNormalized() | ActualQuat), 1.0f);
+		return FMath::RadiansToDegrees(2.0f * FMath::Acos(Dot));
+	}
+
+	/**
+	* Loopback round trip over random walks of the whole sample range, through loss and late acknowledgments.
+	* Checks that every decoded sample is within the quantization error of the one sent, with exact timestamps,
+	* buttons and tracking, and that the button edges add up.
+	*/
+	static void RunPacketRoundTrip(int32 NumPackets)
+	{
+		const float MaxPositionError = 0.5f / XIMMERSE_PACKET_POSITION_SCALE * CODEC_ERROR_SLACK;
+		const float MaxAxisError = 0.5f / 127.0f * CODEC_ERROR_SLACK;
+
+		FRandomStream Random(0xc0dec);
+		FPacketLink Link;
+		FXimmerseDecodedPacket Decoded;
+
+		ControllerState Sent[BENCHMARK_CONTROLLERS];
+		FMemory::Memzero(Sent);
+		uint32 LastDecodedButtons[BENCHMARK_CONTROLLERS] = { 0 };
+
+		float WorstPositionError = 0.0f;
+		float WorstRotationError = 0.0f;
+		float WorstAxisError = 0.0f;
+		int32 NumMismatches = 0;
+		int32 NumDecoded = 0;
+
+		for (int32 Packet = 0; Packet < NumPackets; ++Packet)
+		{
+			for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+			{
+				ControllerState& State = Sent[ControllerIndex];
+				State.timestamp += Random.RandRange(1, 100);
+
+				// mostly small steps that are sent as deltas, now and then a jump anywhere within 4 m
+				const bool bJump = Random.FRand() < 0.05f;
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					State.position[Axis] = bJump ? Random.FRandRange(-4.0f, 4.0f) : FMath::Clamp(State.position[Axis] + Random.FRandRange(-0.05f, 0.05f), -4.0f, 4.0f);
+				}
+
+				const FQuat Rotation(Random.GetUnitVector(), Random.FRandRange(-PI, PI));
+				State.rotation[0] = Rotation.X;
+				State.rotation[1] = Rotation.Y;
+				State.rotation[2] = Rotation.Z;
+				State.rotation[3] = Rotation.W;
+
+				if (Random.FRand() < 0.3f)
+				{
+					State.buttons = Random.RandHelper(1 << 30) & (CONTROLLER_BUTTON_HOME | CONTROLLER_BUTTON_APP | CONTROLLER_BUTTON_CLICK | CONTROLLER_BUTTON_LEFT_GRIP | CONTROLLER_BUTTON_RIGHT_GRIP | CONTROLLER_BUTTON_TRIGGER | CONTROLLER_BUTTON_TOUCH);
+				}
+				State.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER] = Random.FRand();
+				State.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X] = Random.FRandRange(-1.0f, 1.0f);
+				State.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y] = Random.FRandRange(-1.0f, 1.0f);
+
+				Link.Encoder.SetSample(ControllerIndex, ControllerIndex + 1, State);
+			}
+
+			if (!Link.Send(Decoded))
+			{
+				continue;
+			}
+			++NumDecoded;
+
+			if (Decoded.NumSamples != BENCHMARK_CONTROLLERS)
+			{
+				++NumMismatches;
+				continue;
+			}
+
+			for (int32 SampleIndex = 0; SampleIndex < Decoded.NumSamples; ++SampleIndex)
+			{
+				const FXimmerseDecodedSample& Sample = Decoded.Samples[SampleIndex];
+				const ControllerState& Expected = Sent[Sample.DeviceIndex];
+
+				float PositionError = 0.0f;
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					PositionError = FMath::Max(PositionError, FMath::Abs(Sample.State.position[Axis] - Expected.position[Axis]));
+				}
+				const float RotationError = GetRotationError(Expected.rotation, Sample.State.rotation);
+
+				float AxisError = 0.0f;
+				for (int32 Axis : { CONTROLLER_AXIS_PRIMARY_TRIGGER, CONTROLLER_AXIS_PRIMARY_THUMB_X, CONTROLLER_AXIS_PRIMARY_THUMB_Y })
+				{
+					AxisError = FMath::Max(AxisError, FMath::Abs(Sample.State.axes[Axis] - Expected.axes[Axis]));
+				}
+
+				WorstPositionError = FMath::Max(WorstPositionError, PositionError);
+				WorstRotationError = FMath::Max(WorstRotationError, RotationError);
+				WorstAxisError = FMath::Max(WorstAxisError, AxisError);
+
+				const uint32 LastButtons = LastDecodedButtons[Sample.DeviceIndex];
+				const bool bEdgesMatch = Sample.PressedButtons == (Expected.buttons & ~LastButtons) && Sample.ReleasedButtons == (LastButtons & ~Expected.buttons);
+				LastDecodedButtons[Sample.DeviceIndex] = Expected.buttons;
+
+				if (Sample.State.timestamp != Expected.timestamp || Sample.State.buttons != Expected.buttons || Sample.TrackingResult != Sample.DeviceIndex + 1 || !bEdgesMatch
+					|| PositionError > MaxPositionError || RotationError > CODEC_MAX_ROTATION_ERROR || AxisError > MaxAxisError)
+				{
+					++NumMismatches;
+				}
+			}
+		}
+
+		const bool bPassed = NumMismatches == 0 && NumDecoded > 0;
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %s: %d of %d packets decoded, worst errors position %.3f mm (bound %.3f), rotation %.3f deg (bound %.3f), axis %.4f (bound %.4f), %d samples out of bounds"),
+			TEXT("CodecRoundTrip"),
+			bPassed ? TEXT("passed") : TEXT("FAILED"),
+			NumDecoded,
+			NumPackets,
+			WorstPositionError * 1000.0f,
+			MaxPositionError * 1000.0f,
+			WorstRotationError,
+			CODEC_MAX_ROTATION_ERROR,
+			WorstAxisError,
+			MaxAxisError,
+			NumMismatches);
+	}
+
+	/** Vibration messages that would have reached the SDK */
+	static volatile int32 NumHapticMessages = 0;
+
+	/** Those of them that ran the motor */
+	static volatile int32 NumHapticMotorMessages = 0;
+
+	static int CountHapticMessage(int Which, int Msg, int WParam, int LParam)
+	{
+		FPlatformAtomics::InterlockedIncrement(&NumHapticMessages);
+		if (WParam > 0)
+		{
+			FPlatformAtomics::InterlockedIncrement(&NumHapticMotorMessages);
+		}
+		return 0;
+	}
+
+	/**
+	* Feeds the marker tracker synthetic XHawk frames of NumMarkers markers moving through the tracked volume, in a
+	* different order every frame and with some occluded. The blob ids carry the true marker, which the tracker does
+	* not look at, so every change of the track following a marker counts as an identity switch.
+	*/
+	static void RunMarkerTracker(int32 NumMarkers, int32 NumFrames)
+	{
+		FRandomStream Random(0xb10b + NumMarkers);
+		FXimmerseMarkerTracker Tracker;
+
+		TArray<FVector> Positions;
+		TArray<FVector> Velocities;
+		TArray<int32> TrackIds;
+		TArray<int32> Order;
+		for (int32 MarkerIndex = 0; MarkerIndex < NumMarkers; ++MarkerIndex)
+		{
+			Positions.Add(FVector(Random.FRand(), Random.FRand(), Random.FRand()) * MARKER_VOLUME_SIZE);
+			Velocities.Add(Random.GetUnitVector() * Random.FRandRange(0.0f, MARKER_MAX_SPEED));
+			TrackIds.Add(INDEX_NONE);
+			Order.Add(MarkerIndex);
+		}
+
+		// what the SDK fills, laid out like its buffers
+		TArray<int32> Ids;
+		TArray<float> Data;
+		Ids.SetNumZeroed(NumMarkers);
+		Data.SetNumZeroed(NumMarkers * XIMMERSE_TRACKER_BLOB_STRIDE);
+
+		TrackerState State;
+		FMemory::Memzero(State);
+		State.capacity = NumMarkers;
+		State.id = Ids.GetData();
+		State.data = Data.GetData();
+
+		uint64 Cycles = 0;
+		int64 NumIdentitySwitches = 0;
+		int64 NumMarkerFrames = 0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const float DeltaTime = MARKER_FRAME_TIME * 0.001f;
+			for (int32 MarkerIndex = 0; MarkerIndex < NumMarkers; ++MarkerIndex)
+			{
+				// markers bounce off the walls of the volume
+				FVector& Position = Positions[MarkerIndex];
+				FVector& Velocity = Velocities[MarkerIndex];
+				Position += Velocity * DeltaTime;
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					if (Position[Axis] < 0.0f || Position[Axis] > MARKER_VOLUME_SIZE)
+					{
+						Velocity[Axis] = -Velocity[Axis];
+						Position[Axis] = FMath::Clamp(Position[Axis], 0.0f, MARKER_VOLUME_SIZE);
+					}
+				}
+			}
+
+			// the SDK's blob order means nothing from one frame to the next
+			for (int32 Index = NumMarkers - 1; Index > 0; --Index)
+			{
+				Order.Swap(Index, Random.RandRange(0, Index));
+			}
+
+			int32 NumBlobs = 0;
+			for (int32 Index = 0; Index < NumMarkers; ++Index)
+			{
+				const int32 MarkerIndex = Order[Index];
+				if (Random.RandRange(0, MARKER_OCCLUSION_INTERVAL - 1) == 0)
+				{
+					continue;
+				}
+
+				Ids[NumBlobs] = MarkerIndex;
+				Data[NumBlobs * XIMMERSE_TRACKER_BLOB_STRIDE + 0] = Positions[MarkerIndex].X;
+				Data[NumBlobs * XIMMERSE_TRACKER_BLOB_STRIDE + 1] = Positions[MarkerIndex].Y;
+				Data[NumBlobs * XIMMERSE_TRACKER_BLOB_STRIDE + 2] = Positions[MarkerIndex].Z;
+				++NumBlobs;
+			}
+
+			State.timestamp = (Frame + 1) * MARKER_FRAME_TIME;
+			State.frameCount = Frame + 1;
+			State.count = NumBlobs;
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Tracker.Update(State);
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+
+			for (const FXimmerseTrackedMarker& Marker : Tracker.GetMarkers())
+			{
+				if (Marker.NumFramesMissed > 0)
+				{
+					continue;
+				}
+
+				int32& TrackId = TrackIds[Marker.BlobId];
+				NumIdentitySwitches += (TrackId != INDEX_NONE && TrackId != Marker.TrackId) ? 1 : 0;
+				TrackId = Marker.TrackId;
+				++NumMarkerFrames;
+			}
+		}
+
+		const double Nanoseconds = FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0;
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per frame, %.1f ns per marker, %lld identity switches in %lld marker frames, %d markers followed at the end"),
+			*FString::Printf(TEXT("Markers%d"), NumMarkers),
+			Nanoseconds / NumFrames,
+			Nanoseconds / ((double)NumFrames * NumMarkers),
+			NumIdentitySwitches,
+			NumMarkerFrames,
+			Tracker.GetMarkers().Num());
+	}
+
+	/**
+	* Drives many controllers of which only the first holds a button, reports what the repeat timers cost per frame and
+	* whether the repeats kept to their schedule. Repeats are timed from the press, so none are lost to frame quantization.
+	*/
+	static void RunButtonRepeats(int32 NumFrames)
+	{
+		TSharedRef<FCountingMessageHandler> MessageHandler = MakeShareable(new FCountingMessageHandler);
+		FXimmerseInputTranslator Translator;
+		FXimmerseInputEventQueue EventQueue;
+
+		FXimmerseControllerInputState States[REPEAT_CONTROLLERS];
+		FMemory::Memzero(States);
+
+		ControllerState XControllerState;
+		FMemory::Memzero(XControllerState);
+		XControllerState.rotation[3] = 1.0f;
+
+		uint64 Cycles = 0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const double CurrentTime = (double)Frame / BENCHMARK_FRAME_RATE;
+			XControllerState.timestamp = Frame + 1;
+			for (int32 ControllerIndex = 0; ControllerIndex < REPEAT_CONTROLLERS; ++ControllerIndex)
+			{
+				XControllerState.buttons = (ControllerIndex == 0) ? CONTROLLER_BUTTON_APP : 0;
+				Translator.ProcessControllerState(States[ControllerIndex], EventQueue, ControllerIndex, 0, EControllerHand::Left, XControllerState, CurrentTime);
+			}
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Translator.SendButtonRepeats(EventQueue, CurrentTime);
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+
+			EventQueue.Dispatch(*MessageHandler);
+		}
+
+		// the button goes down with the first frame and stays down until the last
+		const double HeldTime = (double)(NumFrames - 1) / BENCHMARK_FRAME_RATE;
+		const int64 ExpectedRepeats = (HeldTime >= Translator.InitialButtonRepeatDelay) ? (int64)((HeldTime - Translator.InitialButtonRepeatDelay) / Translator.ButtonRepeatDelay) + 1 : 0;
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per frame for %d controllers, %lld repeats of %lld expected, %d timers pending"),
+			TEXT("ButtonRepeats"),
+			FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / NumFrames,
+			REPEAT_CONTROLLERS,
+			MessageHandler->NumRepeats,
+			ExpectedRepeats,
+			EventQueue.GetNumRepeatTimers());
+	}
+
+	/** Changes the amplitude of every controller every frame as fast as possible, reports the game thread's cost and what the worker sent */
+	static void RunHaptics(int32 NumFrames)
+	{
+		NumHapticMessages = 0;
+		TUniquePtr<FXimmerseHaptics> Haptics(new FXimmerseHaptics(&CountHapticMessage));
+
+		uint64 Cycles = 0;
+		uint64 MaxCycles = 0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+			{
+				const float Amplitude = 0.5f + 0.5f * FMath::Sin((float)Frame * 0.05f + (float)ControllerIndex);
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Haptics->SetAmplitude(ControllerIndex, ControllerIndex, Amplitude);
+				const uint64 CallCycles = FPlatformTime::Cycles64() - StartCycles;
+
+				Cycles += CallCycles;
+				MaxCycles = FMath::Max(MaxCycles, CallCycles);
+			}
+		}
+
+		const int32 NumCommands = Haptics->GetNumCommands();
+		const int32 NumDroppedCommands = Haptics->GetNumDroppedCommands();
+
+		// joins the worker, which stops the motors on its way out
+		Haptics.Reset();
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per command (max %.1f ns), %d commands, %d dropped, %d messages sent"),
+			TEXT("Haptics"),
+			FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / NumCommands,
+			FPlatformTime::GetSecondsPerCycle64() * MaxCycles * 1000000000.0,
+			NumCommands,
+			NumDroppedCommands,
+			NumHapticMessages);
+	}
+
+	/**
+	* Plays a pattern on one controller while force feedback keeps setting its amplitude to 0 every frame, as the
+	* engine does, in real time. The pattern must run to its end: every one of its samples is worth a message.
+	*/
+	static void RunHapticPattern()
+	{
+		NumHapticMessages = 0;
+		NumHapticMotorMessages = 0;
+		TUniquePtr<FXimmerseHaptics> Haptics(new FXimmerseHaptics(&CountHapticMessage));
+
+		TSharedRef<FXimmerseHapticPattern, ESPMode::ThreadSafe> Pattern = MakeShareable(new FXimmerseHapticPattern);
+		Pattern->SampleRate = HAPTIC_PATTERN_RATE;
+		Pattern->Samples.Init(255, HAPTIC_PATTERN_SAMPLES);
+		const double PatternSeconds = (double)HAPTIC_PATTERN_SAMPLES / HAPTIC_PATTERN_RATE;
+
+		const double StartTime = FPlatformTime::Seconds();
+		Haptics->PlayPattern(0, 0, Pattern);
+		while (FPlatformTime::Seconds() - StartTime < PatternSeconds)
+		{
+			Haptics->SetAmplitude(0, 0, 0.0f);
+			FPlatformProcess::Sleep(1.0f / BENCHMARK_FRAME_RATE);
+		}
+		const int32 NumMotorMessages = NumHapticMotorMessages;
+		Haptics.Reset();
+
+		// messages are sent at most every ximmerse.HapticsMinInterval, and refreshed at least every 0.1 s
+		const bool bPlayed = NumMotorMessages >= 2;
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %d messages ran the motor during a %.2f s pattern under per-frame amplitude 0, %s"),
+			TEXT("HapticPattern"),
+			NumMotorMessages,
+			PatternSeconds,
+			bPlayed ? TEXT("played through") : TEXT("CUT SHORT"));
+		if (!bPlayed)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("Force feedback amplitudes cancelled a playing haptic pattern"));
+		}
+	}
+
+	/** XDeviceGetInt and XDeviceGetInputState calls that would have reached the SDK */
+	static volatile int32 NumStubGetInts = 0;
+	static volatile int32 NumStubInputStates = 0;
+
+	/**
+	* Controllers of the stub SDK, XCobra-0 to XCobra-(NumStubControllers - 1). A connected controller is listed and
+	* reports a tracked pose; each reconnection hands it a new handle, STUB_FIRST_HANDLE plus its number plus
+	* XIMMERSE_MAX_CONTROLLERS times its reconnections.
+	*/
+	static int32 NumStubControllers = 0;
+	static volatile int32 StubConnected[XIMMERSE_MAX_CONTROLLERS];
+	static volatile int32 StubHandles[XIMMERSE_MAX_CONTROLLERS];
+	static ANSICHAR StubNames[XIMMERSE_MAX_CONTROLLERS][16];
+
+	/** Connects NumControllers stub controllers under their first handles */
+	static void ResetStubSdk(int32 NumControllers)
+	{
+		NumStubControllers = FMath::Min(NumControllers, XIMMERSE_MAX_CONTROLLERS);
+		for (int32 ControllerIndex = 0; ControllerIndex < NumStubControllers; ++ControllerIndex)
+		{
+			StubConnected[ControllerIndex] = 1;
+			StubHandles[ControllerIndex] = STUB_FIRST_HANDLE + ControllerIndex;
+			FCStringAnsi::Sprintf(StubNames[ControllerIndex], "XCobra-%d", ControllerIndex);
+		}
+	}
+
+	/** Stub controller a handle belongs to, whether it is still the current one or not, INDEX_NONE for none */
+	static int32 GetStubController(int32 Handle)
+	{
+		const int32 ControllerIndex = (Handle - STUB_FIRST_HANDLE) % XIMMERSE_MAX_CONTROLLERS;
+		return (Handle >= STUB_FIRST_HANDLE && ControllerIndex < NumStubControllers) ? ControllerIndex : INDEX_NONE;
+	}
+
+	/** Only the current handle of a connected controller reaches it */
+	static bool IsStubConnected(int32 Handle)
+	{
+		const int32 ControllerIndex = GetStubController(Handle);
+		return ControllerIndex != INDEX_NONE && StubConnected[ControllerIndex] != 0 && StubHandles[ControllerIndex] == Handle;
+	}
+
+	static int StubGetInputDeviceCount()
+	{
+		int Count = 0;
+		for (int32 ControllerIndex = 0; ControllerIndex < NumStubControllers; ++ControllerIndex)
+		{
+			Count += (StubConnected[ControllerIndex] != 0) ? 1 : 0;
+		}
+		return Count;
+	}
+
+	static int StubGetInputDevices(int Type, int* Handles, int NumHandles)
+	{
+		int Count = 0;
+		for (int32 ControllerIndex = 0; ControllerIndex < NumStubControllers && Count < NumHandles; ++ControllerIndex)
+		{
+			if (StubConnected[ControllerIndex] != 0)
+			{
+				Handles[Count++] = StubHandles[ControllerIndex];
+			}
+		}
+		return Count;
+	}
+
+	static char* StubGetInputDeviceName(int Which)
+	{
+		const int32 ControllerIndex = GetStubController(Which);
+		return (ControllerIndex != INDEX_NONE) ? StubNames[ControllerIndex] : nullptr;
+	}
+
+	static int StubGetInputDeviceHandle(char* Name)
+	{
+		const int32 ControllerIndex = FCStringAnsi::Strncmp(Name, "XCobra-", 7) == 0 ? FCStringAnsi::Atoi(Name + 7) : INDEX_NONE;
+		if (ControllerIndex < 0 || ControllerIndex >= NumStubControllers || StubConnected[ControllerIndex] == 0)
+		{
+			return -1;
+		}
+		return StubHandles[ControllerIndex];
+	}
+
+	static int StubGetInt(int Which, int FieldId, int DefaultValue)
+	{
+		FPlatformAtomics::InterlockedIncrement(&NumStubGetInts);
+		const bool bConnected = IsStubConnected(Which);
+		switch (FieldId)
+		{
+		case kField_TrackingResult:		return bConnected ? kTrackingResult_PoseTracked : kTrackingResult_NotTracked;
+		case kField_ConnectionState:	return bConnected ? EXimmerseConnectionState::Connected : EXimmerseConnectionState::Disconnected;
+		case kField_BatteryLevel:		return bConnected ? 100 : 0;
+		default:						return DefaultValue;
+		}
+	}
+
+	/** XDeviceGetInputState calls of the poll thread that reached a stub controller, per controller */
+	static volatile int32 NumStubPolls[XIMMERSE_MAX_CONTROLLERS];
+
+	/** Hands out the samples of a connected controller in order, each POLL_REPEATS times, as a device slower than its poll would */
+	static int StubPollInputState(int Which, void* State)
+	{
+		FPlatformAtomics::InterlockedIncrement(&NumStubInputStates);
+		if (!IsStubConnected(Which))
+		{
+			return -1;
+		}
+
+		const int32 ControllerIndex = GetStubController(Which);
+		const int32 Poll = FPlatformAtomics::InterlockedIncrement(&NumStubPolls[ControllerIndex]) - 1;
+		ControllerState& OutState = *(ControllerState*)State;
+		MakeSample(EScenario::ConstantMotion, Poll / POLL_REPEATS, ControllerIndex, OutState);
+		OutState.handle = Which;
+		return 0;
+	}
+
+	static const FXimmerseSdkFunctions StubSdk = { &StubGetInputDeviceCount, &StubGetInputDevices, &StubGetInputDeviceName, &StubGetInputDeviceHandle, &StubGetInt, &StubPollInputState };
+
+	static void StubGetInputState(int32 Handle, int32 Frame, ControllerState& OutState)
+	{
+		FPlatformAtomics::InterlockedIncrement(&NumStubInputStates);
+		MakeSample(EScenario::ConstantMotion, Frame, GetStubController(Handle), OutState);
+		OutState.handle = Handle;
+	}
+
+	static void LogSdkCalls(const TCHAR* Name, int32 NumFrames)
+	{
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %6.2f SDK calls per frame: %5.2f XDeviceGetInt, %5.2f XDeviceGetInputState"),
+			Name,
+			(double)(NumStubGetInts + NumStubInputStates) / NumFrames,
+			(double)NumStubGetInts / NumFrames,
+			(double)NumStubInputStates / NumFrames);
+	}
+
+	/**
+	* Counts the SDK calls a frame of BENCHMARK_CONTROLLERS controllers costs the game thread, with the engine asking
+	* for the tracking status SDKCALL_TRACKING_QUERIES times per controller and whether a gamepad is attached
+	* SDKCALL_ATTACHED_QUERIES times. Before the status cache every answer was an XDeviceGetInt of its own; now one
+	* refresh per poll serves them all, every frame when polling on the game thread and every STATUS_REFRESH_INTERVAL
+	* when the SDK pushes the input.
+	*/
+	static void RunSdkCalls(int32 NumFrames)
+	{
+		ResetStubSdk(BENCHMARK_CONTROLLERS);
+
+		TIndirectArray<FXimmerseDevice> Devices;
+		for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+		{
+			Devices.Add(new FXimmerseDevice(FString::Printf(TEXT("XBench-%d"), ControllerIndex), STUB_FIRST_HANDLE + ControllerIndex));
+		}
+
+		ControllerState XControllerState;
+
+		// what SendControllerEvents, GetControllerTrackingStatus and IsGamepadAttached asked the SDK before
+		NumStubGetInts = 0;
+		NumStubInputStates = 0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (FXimmerseDevice& Device : Devices)
+			{
+				StubGetInputState(Device.Handle, Frame, XControllerState);
+
+				// the tracking result of every new sample
+				Sink = (float)StubGetInt(Device.Handle, kField_TrackingResult, 0);
+
+				for (int32 Query = 0; Query < SDKCALL_TRACKING_QUERIES; ++Query)
+				{
+					Sink = (float)StubGetInt(Device.Handle, kField_TrackingResult, 0);
+				}
+			}
+
+			for (int32 Query = 0; Query < SDKCALL_ATTACHED_QUERIES; ++Query)
+			{
+				Sink = (float)(StubGetInt(Devices[0].Handle, kField_TrackingResult, 0) | StubGetInt(Devices[1].Handle, kField_TrackingResult, 0));
+			}
+		}
+		LogSdkCalls(TEXT("SdkCallsBefore"), NumFrames);
+
+		for (int32 Mode = 0; Mode < 2; ++Mode)
+		{
+			const bool bPush = (Mode == 1);
+			for (FXimmerseDevice& Device : Devices)
+			{
+				Device.LastStatusTime = -STATUS_REFRESH_INTERVAL;
+			}
+
+			NumStubGetInts = 0;
+			NumStubInputStates = 0;
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				const double CurrentTime = (double)Frame / BENCHMARK_FRAME_RATE;
+				for (FXimmerseDevice& Device : Devices)
+				{
+					if (!bPush)
+					{
+						Device.RefreshStatus(StubSdk);
+						StubGetInputState(Device.Handle, Frame, XControllerState);
+					}
+					else if (CurrentTime - Device.LastStatusTime >= STATUS_REFRESH_INTERVAL)
+					{
+						Device.RefreshStatus(StubSdk);
+						Device.LastStatusTime = CurrentTime;
+					}
+
+					for (int32 Query = 0; Query < SDKCALL_TRACKING_QUERIES; ++Query)
+					{
+						Sink = Device.Status.Read().IsPositionTracked() ? 1.0f : 0.0f;
+					}
+				}
+
+				for (int32 Query = 0; Query < SDKCALL_ATTACHED_QUERIES; ++Query)
+				{
+					Sink = (Devices[0].Status.Read().IsPositionTracked() || Devices[1].Status.Read().IsPositionTracked()) ? 1.0f : 0.0f;
+				}
+			}
+			LogSdkCalls(bPush ? TEXT("SdkCallsPush") : TEXT("SdkCallsPolled"), NumFrames);
+		}
+	}
+
+	/**
+	* Lets a registry find NumControllers controllers on the stub SDK, then polls them every frame the way
+	* SendControllerEvents does without a poll thread: status, input state, translation and pose. Reports the cost of
+	* discovery, of a watcher pass that finds nothing new and of a frame, which should grow linearly with the controllers.
+	*/
+	static void RunScaling(int32 NumControllers, int32 NumFrames)
+	{
+		ResetStubSdk(NumControllers);
+
+		TUniquePtr<FXimmerseDeviceRegistry> Registry(new FXimmerseDeviceRegistry(StubSdk));
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		Registry->Refresh();
+		const uint64 DiscoveryCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		const TArray<FXimmerseDevice*>& Devices = Registry->GetDevices().Controllers;
+		int32 NumInSlot = 0;
+		for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+		{
+			NumInSlot += (Devices[DeviceIndex] != nullptr && Devices[DeviceIndex]->Handle == STUB_FIRST_HANDLE + DeviceIndex) ? 1 : 0;
+		}
+
+		// connected controllers are left alone by the watcher
+		for (FXimmerseDevice* Device : Devices)
+		{
+			if (Device != nullptr)
+			{
+				Device->RefreshStatus(StubSdk);
+			}
+		}
+
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 Pass = 0; Pass < SCALING_REFRESHES; ++Pass)
+		{
+			Registry->Refresh();
+		}
+		const uint64 RefreshCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		TSharedRef<FCountingMessageHandler> MessageHandler = MakeShareable(new FCountingMessageHandler);
+		FXimmerseInputTranslator Translator;
+		FXimmerseInputEventQueue EventQueue;
+		TArray<FXimmerseControllerInputState> States;
+		States.SetNumZeroed(Devices.Num());
+
+		ControllerState XControllerState;
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const double CurrentTime = (double)Frame / BENCHMARK_FRAME_RATE;
+			for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+			{
+				if (Devices[DeviceIndex] == nullptr)
+				{
+					continue;
+				}
+
+				FXimmerseDevice& Device = *Devices[DeviceIndex];
+				Device.RefreshStatus(StubSdk);
+				StubGetInputState(Device.Handle, Frame, XControllerState);
+
+				const EControllerHand Hand = (EControllerHand)(DeviceIndex % CONTROLLERS_PER_PLAYER);
+				Translator.ProcessControllerState(States[DeviceIndex], EventQueue, DeviceIndex, DeviceIndex / CONTROLLERS_PER_PLAYER, Hand, XControllerState, CurrentTime);
+				Device.Pose.Publish(XControllerState, Device.Status.Read().TrackingResult, CurrentTime);
+			}
+
+			Translator.SendButtonRepeats(EventQueue, CurrentTime);
+			EventQueue.Dispatch(*MessageHandler);
+		}
+		const uint64 FrameCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		const double NanosecondsPerFrame = FPlatformTime::GetSecondsPerCycle64() * FrameCycles * 1000000000.0 / NumFrames;
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per frame, %6.1f ns per controller per frame, discovery %.1f us, watcher pass %.1f us, %d of %d controllers in their slots"),
+			*FString::Printf(TEXT("Scaling%d"), NumControllers),
+			NanosecondsPerFrame,
+			NanosecondsPerFrame / NumControllers,
+			FPlatformTime::GetSecondsPerCycle64() * DiscoveryCycles * 1000000.0,
+			FPlatformTime::GetSecondsPerCycle64() * RefreshCycles * 1000000.0 / SCALING_REFRESHES,
+			NumInSlot,
+			NumControllers);
+		if (NumInSlot != NumControllers)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("Only %d of %d controllers were found in the slot their name gives"), NumInSlot, NumControllers);
+		}
+	}
+
+	/** Refreshes a registry over and over like a watcher with no interval, timing every pass */
+	class FStormWatcher : public FRunnable
+	{
+	public:
+		FStormWatcher(FXimmerseDeviceRegistry& InRegistry)
+			: Registry(InRegistry)
+		{
+		}
+
+		virtual uint32 Run() override
+		{
+			while (!bStopRequested)
+			{
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Registry.Refresh();
+				PassTimes.Record(FPlatformTime::GetSecondsPerCycle64() * (FPlatformTime::Cycles64() - StartCycles));
+			}
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopRequested = true;
+		}
+
+		FXimmerseLatencyHistogram PassTimes;
+
+	private:
+		FXimmerseDeviceRegistry& Registry;
+		FThreadSafeBool bStopRequested;
+	};
+
+	/**
+	* Walks the newest device set over and over like the game and render threads do, reading every controller's
+	* status and pose. A controller found in a slot other than the one its name gives has lost its player and hand.
+	*/
+	class FStormReader : public FRunnable
+	{
+	public:
+		FStormReader(const FXimmerseDeviceRegistry& InRegistry)
+			: NumReads(0)
+			, NumWrongSlots(0)
+			, Registry(InRegistry)
+		{
+		}
+
+		virtual uint32 Run() override
+		{
+			double Sum = 0.0;
+			while (!bStopRequested)
+			{
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+				for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+				{
+					const FXimmerseDevice* Device = Devices[DeviceIndex];
+					if (Device == nullptr)
+					{
+						continue;
+					}
+
+					NumWrongSlots += (GetStubController(Device->Handle) != DeviceIndex) ? 1 : 0;
+					Sum += Device->Status.Read().BatteryLevel + Device->Pose.Read().DeviceTime;
+				}
+				PassTimes.Record(FPlatformTime::GetSecondsPerCycle64() * (FPlatformTime::Cycles64() - StartCycles));
+				++NumReads;
+			}
+			Sink = (float)Sum;
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopRequested = true;
+		}
+
+		/** Only valid once the thread finished */
+		int64 NumReads;
+		int64 NumWrongSlots;
+		FXimmerseLatencyHistogram PassTimes;
+
+	private:
+		const FXimmerseDeviceRegistry& Registry;
+		FThreadSafeBool bStopRequested;
+	};
+
+	/**
+	* Disconnects and reconnects random controllers of the stub SDK at STORM_TOGGLE_RATE, each reconnection under a
+	* new handle, while a watcher thread refreshes the registry without pause and STORM_READERS threads read it. This
+	* thread refreshes the statuses, as the poll would. Readers must never block or see a controller change slots,
+	* and once the storm is over every controller must be back under its newest handle. Then STORM_REPLAYS replays add
+	* and remove a stand-in controller; the sets they replace must all be freed once their grace period is over.
+	*/
+	static void RunHotPlugStorm()
+	{
+		ResetStubSdk(STORM_CONTROLLERS);
+
+		TUniquePtr<FXimmerseDeviceRegistry> Registry(new FXimmerseDeviceRegistry(StubSdk));
+		Registry->Refresh();
+
+		TUniquePtr<FStormWatcher> Watcher(new FStormWatcher(*Registry));
+		FRunnableThread* WatcherThread = FRunnableThread::Create(Watcher.Get(), TEXT("XimmerseStormWatcher"), 0, TPri_Normal);
+
+		TIndirectArray<FStormReader> Readers;
+		TArray<FRunnableThread*> ReaderThreads;
+		for (int32 ReaderIndex = 0; ReaderIndex < STORM_READERS; ++ReaderIndex)
+		{
+			FStormReader* Reader = new FStormReader(*Registry);
+			Readers.Add(Reader);
+			ReaderThreads.Add(FRunnableThread::Create(Reader, *FString::Printf(TEXT("XimmerseStormReader%d"), ReaderIndex), 0, TPri_Normal));
+		}
+
+		FRandomStream Random(0x5707);
+		int32 NumToggles = 0;
+		int32 NumReconnections = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		double CurrentTime = StartTime;
+		while (CurrentTime - StartTime < STORM_SECONDS)
+		{
+			if (NumToggles <= (CurrentTime - StartTime) * STORM_TOGGLE_RATE)
+			{
+				const int32 ControllerIndex = Random.RandHelper(STORM_CONTROLLERS);
+				if (StubConnected[ControllerIndex] != 0)
+				{
+					FPlatformAtomics::InterlockedExchange(&StubConnected[ControllerIndex], 0);
+				}
+				else
+				{
+					// the new handle is in place before the controller is listed again
+					FPlatformAtomics::InterlockedAdd(&StubHandles[ControllerIndex], XIMMERSE_MAX_CONTROLLERS);
+					FPlatformAtomics::InterlockedExchange(&StubConnected[ControllerIndex], 1);
+					++NumReconnections;
+				}
+				++NumToggles;
+			}
+			else
+			{
+				FPlatformProcess::Yield();
+			}
+
+			for (FXimmerseDevice* Device : Registry->GetDevices().Controllers)
+			{
+				if (Device != nullptr)
+				{
+					Device->RefreshStatus(StubSdk);
+				}
+			}
+			CurrentTime = FPlatformTime::Seconds();
+		}
+
+		WatcherThread->Kill(true);
+		delete WatcherThread;
+
+		int64 NumReads = 0;
+		int64 NumWrongSlots = 0;
+		double ReadMax = 0.0;
+		double ReadP99 = 0.0;
+		for (int32 ReaderIndex = 0; ReaderIndex < STORM_READERS; ++ReaderIndex)
+		{
+			ReaderThreads[ReaderIndex]->Kill(true);
+			delete ReaderThreads[ReaderIndex];
+			NumReads += Readers[ReaderIndex].NumReads;
+			NumWrongSlots += Readers[ReaderIndex].NumWrongSlots;
+			ReadP99 = FMath::Max(ReadP99, Readers[ReaderIndex].PassTimes.GetPercentile(99.0));
+			ReadMax = FMath::Max(ReadMax, Readers[ReaderIndex].PassTimes.GetMax());
+		}
+
+		// the storm is over: everyone reconnects, the poll notices the stale handles, the watcher re-resolves them
+		for (int32 ControllerIndex = 0; ControllerIndex < STORM_CONTROLLERS; ++ControllerIndex)
+		{
+			if (StubConnected[ControllerIndex] == 0)
+			{
+				StubHandles[ControllerIndex] += XIMMERSE_MAX_CONTROLLERS;
+				StubConnected[ControllerIndex] = 1;
+			}
+		}
+		const TArray<FXimmerseDevice*>& Devices = Registry->GetDevices().Controllers;
+		for (FXimmerseDevice* Device : Devices)
+		{
+			if (Device != nullptr)
+			{
+				Device->RefreshStatus(StubSdk);
+			}
+		}
+		Registry->Refresh();
+
+		int32 NumBack = 0;
+		for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+		{
+			NumBack += (DeviceIndex < STORM_CONTROLLERS && Devices[DeviceIndex] != nullptr && Devices[DeviceIndex]->Handle == StubHandles[DeviceIndex]) ? 1 : 0;
+		}
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %d reconnections, %lld watcher passes p99 %.0f us max %.0f us, %lld reads on %d threads p99 %.0f us max %.0f us, %lld in a wrong slot, %d of %d controllers back"),
+			TEXT("HotPlugStorm"),
+			NumReconnections,
+			Watcher->PassTimes.GetCount(),
+			Watcher->PassTimes.GetPercentile(99.0) * 1000000.0,
+			Watcher->PassTimes.GetMax() * 1000000.0,
+			NumReads,
+			STORM_READERS,
+			ReadP99 * 1000000.0,
+			ReadMax * 1000000.0,
+			NumWrongSlots,
+			NumBack,
+			STORM_CONTROLLERS);
+		if (NumWrongSlots > 0 || NumBack != STORM_CONTROLLERS || Devices.Num() != STORM_CONTROLLERS)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("Controllers changed slots or were lost during the hot-plug storm"));
+		}
+
+		for (int32 Replay = 0; Replay < STORM_REPLAYS; ++Replay)
+		{
+			Registry->FindOrAddController(STORM_CONTROLLERS, TEXT("XBench-Replay"));
+			Registry->RemoveController(STORM_CONTROLLERS);
+		}
+		const int32 NumRetiredSets = Registry->GetNumRetiredSets();
+
+		// nobody holds a set anymore, a refresh after the grace period frees them all
+		FPlatformProcess::Sleep((float)XIMMERSE_RETIRED_SET_GRACE_TIME);
+		Registry->Refresh();
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %d replays retired %d sets, %d left %.1f s later"),
+			TEXT("HotPlugReplays"),
+			STORM_REPLAYS,
+			NumRetiredSets,
+			Registry->GetNumRetiredSets(),
+			XIMMERSE_RETIRED_SET_GRACE_TIME);
+		if (Registry->GetNumRetiredSets() > 0)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("Replaced device sets outlived their grace period"));
+		}
+	}
+
+	/**
+	* Runs the poll thread on BENCHMARK_CONTROLLERS stub controllers that hand out every sample POLL_REPEATS times, with
+	* nobody draining the rings, until POLL_SAMPLES samples per controller filled them past capacity. Every sample must be
+	* taken once: queued in order while its ring has room, counted as dropped after that, and published once, which the
+	* pose stream's count shows. The status must only be refreshed every STATUS_REFRESH_INTERVAL, not per sample.
+	*/
+	static void RunPollThread()
+	{
+		ResetStubSdk(BENCHMARK_CONTROLLERS);
+		for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+		{
+			NumStubPolls[ControllerIndex] = 0;
+		}
+
+		FXimmerseDeviceRegistry Registry(StubSdk);
+		Registry.Refresh();
+		TUniquePtr<FXimmerseCaptureWriter> Capture(new FXimmerseCaptureWriter);
+		TUniquePtr<FXimmerseSharedMemoryPublisher> SharedMemory(new FXimmerseSharedMemoryPublisher);
+
+		NumStubGetInts = 0;
+		NumStubInputStates = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		TUniquePtr<FXimmerseInputPoller> Poller(new FXimmerseInputPoller(Registry, *Capture, *SharedMemory, StubSdk));
+
+		const int32 NumPollsNeeded = POLL_SAMPLES * POLL_REPEATS;
+		bool bDone = false;
+		while (!bDone && FPlatformTime::Seconds() - StartTime < POLL_TIMEOUT_SECONDS)
+		{
+			FPlatformProcess::Sleep(0.01f);
+			bDone = true;
+			for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+			{
+				bDone &= NumStubPolls[ControllerIndex] >= NumPollsNeeded;
+			}
+		}
+
+		// the stub stops handing out samples, and the poll cycle under way finishes before the rings are looked at
+		for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+		{
+			StubConnected[ControllerIndex] = 0;
+		}
+		FPlatformProcess::Sleep(POLL_SETTLE_SECONDS);
+		const int32 NumDropped = Poller->GetNumDroppedSamples();
+		Poller.Reset();
+		const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+		int32 NumTaken = 0;
+		int32 NumQueued = 0;
+		int32 NumOutOfOrder = 0;
+		int32 NumRepublished = 0;
+		const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+		for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+		{
+			FXimmerseDevice& Device = *Devices[ControllerIndex];
+			const int32 NumSamples = (NumStubPolls[ControllerIndex] + POLL_REPEATS - 1) / POLL_REPEATS;
+			NumTaken += NumSamples;
+			NumRepublished += FMath::Abs(Device.Pose.GetNumPublished() - NumSamples);
+
+			// the ring keeps the oldest samples, timestamps 1 on
+			ControllerState XControllerState;
+			int32 ExpectedTimestamp = 1;
+			while (Device.Samples.Dequeue(XControllerState))
+			{
+				NumOutOfOrder += (XControllerState.timestamp != ExpectedTimestamp) ? 1 : 0;
+				ExpectedTimestamp = XControllerState.timestamp + 1;
+				++NumQueued;
+			}
+		}
+
+		// three fields per refresh, one refresh per interval and controller, one more for the first poll
+		const int32 MaxGetInts = 3 * BENCHMARK_CONTROLLERS * (FMath::CeilToInt(Elapsed / STATUS_REFRESH_INTERVAL) + 1);
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %d samples in %.2f s, %d queued, %d dropped with the rings full, %d out of order, %d published more or less than once, %d XDeviceGetInt (at most %d)"),
+			TEXT("PollThread"),
+			NumTaken,
+			Elapsed,
+			NumQueued,
+			NumDropped,
+			NumOutOfOrder,
+			NumRepublished,
+			(int32)NumStubGetInts,
+			MaxGetInts);
+		if (!bDone || NumOutOfOrder > 0 || NumRepublished > 0 || NumDropped == 0 || NumQueued + NumDropped != NumTaken)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("The poll thread queued samples out of order, took a sample twice or miscounted the samples a full ring dropped"));
+		}
+		if (NumStubGetInts > MaxGetInts)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("The poll thread refreshed the status more often than every %.2f s"), STATUS_REFRESH_INTERVAL);
+		}
+	}
+
+	namespace EInputMode
+	{
+		enum Type
+		{
+			/** The game thread reads every controller's newest state once per frame */
+			Polled,
+
+			/** The stub fires callbacks into a listener, the game thread drains it once per frame */
+			Push,
+
+			Count
+		};
+	}
+
+	static const TCHAR* InputModeNames[EInputMode::Count] = { TEXT("Polled"), TEXT("Push") };
+
+	/** A controller state with the time it changed last, what a polled SDK hands out */
+	struct FStubSample
+	{
+		ControllerState State;
+		double Time;
+	};
+
+	/**
+	* Stands in for the SDK: a thread producing controller input at STUB_SAMPLE_RATE. It either fires the
+	* callbacks of a listener, or updates the state a poll would read. The pad axis and the pose change with
+	* every sample, a button flips every 50 samples. With a button flip the callbacks also get a key code that
+	* is no CONTROLLER_BUTTON_* flag, which the listener must count and drop.
+	*/
+	class FStubDevice : public FRunnable
+	{
+	public:
+		FStubDevice(FXimmerseInputListener* InListener)
+			: NumButtonEdges(0)
+			, NumUnknownKeys(0)
+			, Listener(InListener)
+			, Thread(nullptr)
+		{
+			for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+			{
+				FStubSample Sample;
+				FMemory::Memzero(Sample);
+				Sample.State.handle = STUB_FIRST_HANDLE + ControllerIndex;
+				Sample.State.rotation[3] = 1.0f;
+				Samples[ControllerIndex].Write(Sample);
+			}
+			Thread = FRunnableThread::Create(this, TEXT("XimmerseStubDevice"), 0, TPri_AboveNormal);
+		}
+
+		virtual ~FStubDevice()
+		{
+			Thread->Kill(true);
+			delete Thread;
+		}
+
+		virtual uint32 Run() override
+		{
+			for (int32 Tick = 0; !bStopRequested; ++Tick)
+			{
+				const float Angle = (float)Tick * 0.01f;
+				for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+				{
+					const int32 Handle = STUB_FIRST_HANDLE + ControllerIndex;
+					const bool bFlipButton = (Tick % 50) == 0;
+					const bool bPressed = ((Tick / 50) & 1) != 0;
+
+					if (Listener != nullptr)
+					{
+						Listener->PushAxis(Handle, CONTROLLER_AXIS_PRIMARY_THUMB_X, FMath::Cos(Angle));
+						Listener->PushVector(Handle, EXimmerseSdkEvent::Position, 0.3f * FMath::Cos(Angle), 1.2f, 0.3f * FMath::Sin(Angle));
+						Listener->PushVector(Handle, EXimmerseSdkEvent::Rotation, 0.0f, FMath::Sin(Angle * 0.5f), 0.0f, FMath::Cos(Angle * 0.5f));
+						if (bFlipButton)
+						{
+							Listener->PushKey(Handle, CONTROLLER_BUTTON_APP, bPressed ? 1 : 0);
+							Listener->PushKey(Handle, STUB_UNKNOWN_KEY, 1);
+							FPlatformAtomics::InterlockedIncrement(&NumUnknownKeys);
+						}
+					}
+					else
+					{
+						FStubSample Sample = Samples[ControllerIndex].Read();
+						Sample.State.timestamp = Tick + 1;
+						Sample.State.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X] = FMath::Cos(Angle);
+						Sample.State.position[0] = 0.3f * FMath::Cos(Angle);
+						Sample.State.position[1] = 1.2f;
+						Sample.State.position[2] = 0.3f * FMath::Sin(Angle);
+						Sample.State.rotation[1] = FMath::Sin(Angle * 0.5f);
+						Sample.State.rotation[3] = FMath::Cos(Angle * 0.5f);
+						if (bFlipButton)
+						{
+							Sample.State.buttons = bPressed ? CONTROLLER_BUTTON_APP : 0;
+						}
+						Sample.Time = FPlatformTime::Seconds();
+						Samples[ControllerIndex].Write(Sample);
+					}
+
+					if (bFlipButton && Tick > 0)
+					{
+						FPlatformAtomics::InterlockedIncrement(&NumButtonEdges);
+					}
+				}
+
+				FPlatformProcess::Sleep((float)(1.0 / STUB_SAMPLE_RATE));
+			}
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopRequested = true;
+		}
+
+		/** What XDeviceGetInputState would return for a controller */
+		FStubSample GetInputState(int32 ControllerIndex) const
+		{
+			return Samples[ControllerIndex].Read();
+		}
+
+		/** Button presses and releases produced so far */
+		volatile int32 NumButtonEdges;
+
+		/** Key events with a code that is no button flag pushed so far */
+		volatile int32 NumUnknownKeys;
+
+	private:
+		FXimmerseInputListener* Listener;
+		TXimmerseSeqLock<FStubSample> Samples[BENCHMARK_CONTROLLERS];
+		FThreadSafeBool bStopRequested;
+		FRunnableThread* Thread;
+	};
+
+	/** Drives the translator in real time from the stub device, reports game thread cost, event latency and button edges seen */
+	static void RunInputMode(EInputMode::Type Mode)
+	{
+		TSharedRef<FCountingMessageHandler> MessageHandler = MakeShareable(new FCountingMessageHandler);
+		FXimmerseInputTranslator Translator;
+		FXimmerseInputEventQueue EventQueue;
+		FXimmerseControllerInputState States[BENCHMARK_CONTROLLERS];
+		FMemory::Memzero(States);
+
+		FXimmerseDeviceRegistry Registry;
+		for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+		{
+			Registry.FindOrAddController(ControllerIndex, FString::Printf(TEXT("XBench-%d"), ControllerIndex)).SetHandle(STUB_FIRST_HANDLE + ControllerIndex);
+		}
+
+		FXimmerseSdkClock::Sync();
+		TUniquePtr<FXimmerseInputListener> Listener(Mode == EInputMode::Push ? new FXimmerseInputListener(Registry, false) : nullptr);
+		TUniquePtr<FStubDevice> Device(new FStubDevice(Listener.Get()));
+
+		FXimmerseLatencyStats EventLatency;
+		int32 NumButtonEdgesSeen = 0;
+		int32 NumMisroutedButtons = 0;
+		int32 NumFrames = 0;
+		uint64 Cycles = 0;
+
+		const double EndTime = FPlatformTime::Seconds() + INPUT_MODE_SECONDS;
+		while (FPlatformTime::Seconds() < EndTime)
+		{
+			const double FrameStartTime = FPlatformTime::Seconds();
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+
+			if (Listener.IsValid())
+			{
+				Listener->Drain([&](int32 DeviceIndex, ControllerState& PushedState, double EventTime)
+				{
+					const FXimmerseTranslatedEvents Events = Translator.ProcessControllerState(States[DeviceIndex], EventQueue, DeviceIndex, 0, (EControllerHand)(DeviceIndex % CONTROLLERS_PER_PLAYER), PushedState, EventTime);
+					NumButtonEdgesSeen += Events.NumPressed + Events.NumReleased;
+					NumMisroutedButtons += (PushedState.buttons & ~(uint32)CONTROLLER_BUTTON_APP) != 0 ? 1 : 0;
+				});
+			}
+			else
+			{
+				for (int32 ControllerIndex = 0; ControllerIndex < BENCHMARK_CONTROLLERS; ++ControllerIndex)
+				{
+					FStubSample Sample = Device->GetInputState(ControllerIndex);
+					const FXimmerseTranslatedEvents Events = Translator.ProcessControllerState(States[ControllerIndex], EventQueue, ControllerIndex, 0, (EControllerHand)(ControllerIndex % CONTROLLERS_PER_PLAYER), Sample.State, Sample.Time);
+					NumButtonEdgesSeen += Events.NumPressed + Events.NumReleased;
+				}
+			}
+
+			Translator.SendButtonRepeats(EventQueue, FrameStartTime);
+			EventQueue.Dispatch(*MessageHandler, &EventLatency);
+
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+			++NumFrames;
+
+			const double SleepTime = 1.0 / BENCHMARK_FRAME_RATE - (FPlatformTime::Seconds() - FrameStartTime);
+			if (SleepTime > 0.0)
+			{
+				FPlatformProcess::Sleep((float)SleepTime);
+			}
+		}
+
+		// edges of the last frame are not drained anymore
+		const int32 NumButtonEdges = Device->NumButtonEdges;
+		const int32 NumUnknownKeysPushed = Device->NumUnknownKeys;
+		Device.Reset();
+		const int32 NumUnknownKeys = Listener.IsValid() ? Listener->GetNumUnknownKeys() : 0;
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per frame, event latency p50 %.2f ms p99 %.2f ms, %d of %d button edges seen, %d events dropped"),
+			InputModeNames[Mode],
+			FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000000.0 / FMath::Max(NumFrames, 1),
+			EventLatency.AnalogDispatch.GetPercentile(50.0) * 1000.0,
+			EventLatency.AnalogDispatch.GetPercentile(99.0) * 1000.0,
+			NumButtonEdgesSeen,
+			NumButtonEdges,
+			Listener.IsValid() ? Listener->GetNumDroppedEvents() : 0);
+		if (Listener.IsValid() && (NumMisroutedButtons > 0 || NumUnknownKeys < NumUnknownKeysPushed))
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("Key codes that are no button flag reached the controller state: %d states with foreign buttons, %d of %d unknown codes dropped"),
+				NumMisroutedButtons,
+				NumUnknownKeys,
+				NumUnknownKeysPushed);
+		}
+	}
+
+	/** The fields of a device the sampler and the render thread touch, packed the way they were before the padding */
+	struct FPackedDevice
+	{
+		FXimmersePoseSnapshot Pose;
+		TXimmerseSeqLock<FXimmerseDeviceStatus> Status;
+		int32 LastQueuedTimestamp;
+	};
+
+	/** Reads the pose of a device as fast as it can, like a render thread with nothing else to do */
+	template<typename DeviceType>
+	class TPoseReader : public FRunnable
+	{
+	public:
+		TPoseReader(const DeviceType& InDevice)
+			: NumReads(0)
+			, Cycles(0)
+			, Device(InDevice)
+		{
+		}
+
+		virtual uint32 Run() override
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			double Sum = 0.0;
+			while (!bStopRequested)
+			{
+				Sum += Device.Pose.Read().DeviceTime;
+				++NumReads;
+			}
+			Cycles = FPlatformTime::Cycles64() - StartCycles;
+			Sink = (float)Sum;
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopRequested = true;
+		}
+
+		/** Only valid once the thread finished */
+		int64 NumReads;
+		uint64 Cycles;
+
+	private:
+		const DeviceType& Device;
+		FThreadSafeBool bStopRequested;
+	};
+
+	/**
+	* Refreshes the status and queue bookkeeping of a device from this thread while another thread reads its pose,
+	* the pose itself never changes. Whatever slows the reader down is false sharing between the two.
+	*/
+	template<typename DeviceType>
+	static void RunContention(const TCHAR* Name, DeviceType& Device)
+	{
+		TPoseReader<DeviceType> Reader(Device);
+		FRunnableThread* Thread = FRunnableThread::Create(&Reader, TEXT("XimmersePoseReader"), 0, TPri_Normal);
+
+		FXimmerseDeviceStatus Status;
+		int64 NumWrites = 0;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		const double EndTime = FPlatformTime::Seconds() + CONTENTION_SECONDS;
+		do
+		{
+			for (int32 Write = 0; Write < 1024; ++Write, ++NumWrites)
+			{
+				Status.BatteryLevel = (int32)NumWrites;
+				Device.Status.Write(Status);
+				Device.LastQueuedTimestamp = (int32)NumWrites;
+			}
+		}
+		while (FPlatformTime::Seconds() < EndTime);
+		const uint64 WriteCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		Thread->Kill(true);
+		delete Thread;
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per pose read, %.1f ns per status write, %.1f M reads and %.1f M writes per second"),
+			Name,
+			FPlatformTime::GetSecondsPerCycle64() * Reader.Cycles * 1000000000.0 / FMath::Max<int64>(Reader.NumReads, 1),
+			FPlatformTime::GetSecondsPerCycle64() * WriteCycles * 1000000000.0 / NumWrites,
+			Reader.NumReads / (FPlatformTime::GetSecondsPerCycle64() * FMath::Max<uint64>(Reader.Cycles, 1)) / 1000000.0,
+			NumWrites / (FPlatformTime::GetSecondsPerCycle64() * WriteCycles) / 1000000.0);
+	}
+
+	/** Every field of the pose written Nth carries N, so a pose mixing two writes shows */
+	static FXimmersePose MakeSeqLockPose(int64 Write)
+	{
+		// floats hold every integer below 2^24
+		const float Value = (float)(Write & 0x7fffff);
+
+		FXimmersePose Pose;
+		Pose.Position = FVector(Value, Value, Value);
+		Pose.Orientation = FQuat(Value, Value, Value, Value);
+		Pose.LinearVelocity = Pose.Position;
+		Pose.LinearAcceleration = Pose.Position;
+		Pose.AngularVelocity = Pose.Position;
+		Pose.SampleTime = (double)Write;
+		Pose.DeviceTime = (double)Write;
+		return Pose;
+	}
+
+	static bool IsSeqLockPoseConsistent(const FXimmersePose& Pose)
+	{
+		const float Value = (float)((int64)Pose.SampleTime & 0x7fffff);
+		const FVector Expected(Value, Value, Value);
+		return Pose.DeviceTime == Pose.SampleTime
+			&& Pose.Position == Expected && Pose.LinearVelocity == Expected && Pose.LinearAcceleration == Expected && Pose.AngularVelocity == Expected
+			&& Pose.Orientation.X == Value && Pose.Orientation.Y == Value && Pose.Orientation.Z == Value && Pose.Orientation.W == Value;
+	}
+
+	/** Reads a pose snapshot as fast as it can and checks every pose it gets is one whole write, newer than the last */
+	class FSeqLockReader : public FRunnable
+	{
+	public:
+		FSeqLockReader(const FXimmersePoseSnapshot& InSnapshot)
+			: NumReads(0)
+			, NumTornReads(0)
+			, NumStaleReads(0)
+			, Snapshot(InSnapshot)
+		{
+		}
+
+		virtual uint32 Run() override
+		{
+			double LastWrite = -1.0;
+			while (!bStopRequested)
+			{
+				const FXimmersePose Pose = Snapshot.Read();
+				++NumReads;
+				if (!IsSeqLockPoseConsistent(Pose))
+				{
+					++NumTornReads;
+				}
+				else if (Pose.SampleTime < LastWrite)
+				{
+					++NumStaleReads;
+				}
+				LastWrite = FMath::Max(LastWrite, Pose.SampleTime);
+			}
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopRequested = true;
+		}
+
+		/** Only valid once the thread finished */
+		int64 NumReads;
+		int64 NumTornReads;
+		int64 NumStaleReads;
+
+	private:
+		const FXimmersePoseSnapshot& Snapshot;
+		FThreadSafeBool bStopRequested;
+	};
+
+	/**
+	* One writer publishes poses into a snapshot, at Rate per second or as fast as it can if 0, while SEQLOCK_READERS
+	* threads read it like render threads latching the newest pose. Any read mixing two poses, or older than one the
+	* same thread read before, is a failure of the sequence lock.
+	*/
+	static void RunSeqLock(const TCHAR* Name, double Rate)
+	{
+		TUniquePtr<FXimmersePoseSnapshot> Snapshot(new FXimmersePoseSnapshot);
+		Snapshot->Write(MakeSeqLockPose(0));
+
+		TIndirectArray<FSeqLockReader> Readers;
+		TArray<FRunnableThread*> Threads;
+		for (int32 ReaderIndex = 0; ReaderIndex < SEQLOCK_READERS; ++ReaderIndex)
+		{
+			FSeqLockReader* Reader = new FSeqLockReader(*Snapshot);
+			Readers.Add(Reader);
+			Threads.Add(FRunnableThread::Create(Reader, *FString::Printf(TEXT("XimmerseSeqLockReader%d"), ReaderIndex), 0, TPri_Normal));
+		}
+
+		int64 NumWrites = 1;
+		const double StartTime = FPlatformTime::Seconds();
+		double CurrentTime = StartTime;
+		while (CurrentTime - StartTime < SEQLOCK_SECONDS)
+		{
+			if (Rate <= 0.0 || NumWrites <= (CurrentTime - StartTime) * Rate)
+			{
+				Snapshot->Write(MakeSeqLockPose(NumWrites));
+				++NumWrites;
+			}
+			else
+			{
+				FPlatformProcess::Yield();
+			}
+			CurrentTime = FPlatformTime::Seconds();
+		}
+
+		int64 NumReads = 0;
+		int64 NumTornReads = 0;
+		int64 NumStaleReads = 0;
+		for (int32 ReaderIndex = 0; ReaderIndex < SEQLOCK_READERS; ++ReaderIndex)
+		{
+			Threads[ReaderIndex]->Kill(true);
+			delete Threads[ReaderIndex];
+			NumReads += Readers[ReaderIndex].NumReads;
+			NumTornReads += Readers[ReaderIndex].NumTornReads;
+			NumStaleReads += Readers[ReaderIndex].NumStaleReads;
+		}
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %lld writes, %lld reads on %d threads, %lld torn, %lld older than a previous read"),
+			Name,
+			NumWrites - 1,
+			NumReads,
+			SEQLOCK_READERS,
+			NumTornReads,
+			NumStaleReads);
+		if (NumTornReads > 0 || NumStaleReads > 0)
+		{
+			UE_LOG(LogXimmerseInput, Error, TEXT("The pose snapshot handed out %lld torn and %lld stale poses"), NumTornReads, NumStaleReads);
+		}
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const int32 NumFrames = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : BENCHMARK_DEFAULT_FRAMES;
+
+		UE_LOG(LogXimmerseInput, Display, TEXT("Ximmerse input benchmark, %d frames of %d controllers"), NumFrames, BENCHMARK_CONTROLLERS);
+		for (int32 Scenario = 0; Scenario < EScenario::Count; ++Scenario)
+		{
+			const FResult Result = RunScenario((EScenario::Type)Scenario, NumFrames);
+			UE_LOG(LogXimmerseInput, Display, TEXT("  %-16s %8.1f ns per controller per frame, %6.2f messages per frame (%.0f per second), %d allocations"),
+				ScenarioNames[Scenario], Result.NanosecondsPerControllerFrame, Result.MessagesPerFrame, Result.MessagesPerFrame * BENCHMARK_FRAME_RATE, Result.NumAllocations);
+		}
+
+		RunFilter(NumFrames);
+		RunImuFusion(NumFrames);
+		RunPoseHistory(STUB_SAMPLE_RATE);
+		RunPoseHistory(BENCHMARK_FRAME_RATE);
+		RunPrediction();
+		RunTouchGestures(GESTURE_TRIALS, GESTURE_SAMPLE_RATE);
+		RunTouchGestures(GESTURE_TRIALS, GESTURE_FRAME_RATE);
+		RunPacketCodec(NumFrames);
+		RunPacketRoundTrip(CODEC_ROUND_TRIP_PACKETS);
+		RunButtonRepeats(NumFrames);
+
+		const int32 MarkerCounts[] = { 10, 50, 100, 200 };
+		for (const int32 NumMarkers : MarkerCounts)
+		{
+			RunMarkerTracker(NumMarkers, NumFrames);
+		}
+		RunHaptics(NumFrames);
+		RunHapticPattern();
+		RunSdkCalls(NumFrames);
+
+		const int32 ControllerCounts[] = { 2, 8, 32 };
+		for (const int32 NumControllers : ControllerCounts)
+		{
+			RunScaling(NumControllers, NumFrames);
+		}
+		RunHotPlugStorm();
+		RunPollThread();
+
+		RunSeqLock(TEXT("SeqLock1kHz"), STUB_SAMPLE_RATE);
+		RunSeqLock(TEXT("SeqLockFlatOut"), 0.0);
+
+		TUniquePtr<FPackedDevice> PackedDevice(new FPackedDevice);
+		RunContention(TEXT("ContentionPacked"), *PackedDevice);
+
+		TUniquePtr<FXimmerseDevice> PaddedDevice(new FXimmerseDevice(TEXT("XBench-Contention"), STUB_FIRST_HANDLE));
+		RunContention(TEXT("ContentionPadded"), *PaddedDevice);
+
+		for (int32 Mode = 0; Mode < EInputMode::Count; ++Mode)
+		{
+			RunInputMode((EInputMode::Type)Mode);
+		}
+	}
+}
+
+static FAutoConsoleCommand CmdBenchmark(
+    TEXT("ximmerse.Bench"),
+    TEXT("Measures the cost of translating controller samples into input messages for an idle, a noisy idle, a moving and a button-mashing controller,\n")
+    TEXT("then the cost, jitter reduction and lag of the pose filter on synthetic data, the cost and orientation error of the IMU fusion\n")
+    TEXT("on a synthetic rotation trace with a biased gyroscope and 60 Hz tracking that drops out, the cost and interpolation error of pose history lookups\n")
+    TEXT("on synthetic motion sampled at 1 kHz and at 90 Hz, the cost and error of pose prediction one to four frames ahead\n")
+    TEXT("and its clamp to ximmerse.MaxPredictionTime (Predict, PredictClamp), the accuracy and cost of the touchpad gesture recognizer\n")
+    TEXT("on synthetic gestures sampled at 1 kHz and at 90 Hz, the bandwidth, cost and round-trip error of the pose packet codec,\n")
+    TEXT("the cost and accuracy of the button repeat timers with one of many controllers holding a button,\n")
+    TEXT("the cost per frame and the identity switches of the XHawk marker tracker following 10 to 200 synthetic markers,\n")
+    TEXT("the game thread's cost of queueing vibration, whether a haptic pattern survives per-frame force feedback,\n")
+    TEXT("the SDK calls per frame of the status queries before the status cache, when polled and when pushed (SdkCallsBefore, SdkCallsPolled, SdkCallsPush),\n")
+    TEXT("the cost of registry refreshes and polls with 2, 8 and 32 stub controllers (Scaling2, Scaling8, Scaling32),\n")
+    TEXT("whether readers of the device registry block or see controllers change slots during a reconnection storm (HotPlugStorm)\n")
+    TEXT("and whether the sets replaced by replays starting and stopping are freed (HotPlugReplays),\n")
+    TEXT("whether the poll thread queues every sample of a stub SDK once and in order and counts what a full ring drops (PollThread),\n")
+    TEXT("whether render-thread readers of a pose snapshot ever see a torn pose while a writer publishes at 1 kHz and flat out,\n")
+    TEXT("and how much a status writer slows down a pose reader on another thread\n")
+    TEXT("with the device fields packed together and with the padding FXimmerseDevice uses.\n")
+    TEXT("Finally drives a stub device in real time and compares the game thread cost and event latency of polled and push input (Polled, Push),\n")
+    TEXT("checking that push input drops key codes that are no button.\n")
+    TEXT("Takes the number of frames to simulate per scenario."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&XimmerseInputBenchmark::Run));
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS && !UE_BUILD_SHIPPING
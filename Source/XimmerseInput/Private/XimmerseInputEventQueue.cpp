@@ -0,0 +1,128 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseInputEventQueue.h"
+#include "XimmerseLatency.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Room reserved up front, enough for a frame of two busy controllers without growing */
+#define EVENT_QUEUE_INITIAL_EVENTS		64
+#define EVENT_QUEUE_INITIAL_REPEATS		32
+
+FXimmerseInputEventQueue::FXimmerseInputEventQueue()
+	: NextSequence(0)
+{
+	Events.Reserve(EVENT_QUEUE_INITIAL_EVENTS);
+	RepeatTimers.Reserve(EVENT_QUEUE_INITIAL_REPEATS);
+	ArmedRepeatTimes.Reserve(EVENT_QUEUE_INITIAL_REPEATS);
+}
+
+void FXimmerseInputEventQueue::AddButton(EXimmerseInputEventType::Type Type, const FGamepadKeyNames::Type& Key, int32 ControllerIndex, double Time)
+{
+	FXimmerseQueuedInputEvent& Event = Events[Events.AddUninitialized()];
+	Event.Time = Time;
+	Event.Sequence = NextSequence++;
+	Event.Type = Type;
+	Event.ControllerIndex = ControllerIndex;
+	Event.Key = Key;
+	Event.AnalogValue = 0.0f;
+}
+
+void FXimmerseInputEventQueue::AddAnalog(const FGamepadKeyNames::Type& Key, int32 ControllerIndex, float Value, double Time)
+{
+	FXimmerseQueuedInputEvent& Event = Events[Events.AddUninitialized()];
+	Event.Time = Time;
+	Event.Sequence = NextSequence++;
+	Event.Type = EXimmerseInputEventType::Analog;
+	Event.ControllerIndex = ControllerIndex;
+	Event.Key = Key;
+	Event.AnalogValue = Value;
+}
+
+void FXimmerseInputEventQueue::ScheduleRepeat(int32 RepeatId, const FGamepadKeyNames::Type& Key, int32 ControllerIndex, double Time)
+{
+	if (RepeatId >= ArmedRepeatTimes.Num())
+	{
+		ArmedRepeatTimes.AddZeroed(RepeatId + 1 - ArmedRepeatTimes.Num());
+	}
+	ArmedRepeatTimes[RepeatId] = Time;
+
+	FXimmerseRepeatTimer Timer;
+	Timer.Time = Time;
+	Timer.RepeatId = RepeatId;
+	Timer.ControllerIndex = ControllerIndex;
+	Timer.Key = Key;
+	RepeatTimers.HeapPush(Timer);
+}
+
+void FXimmerseInputEventQueue::CancelRepeat(int32 RepeatId)
+{
+	if (ArmedRepeatTimes.IsValidIndex(RepeatId))
+	{
+		ArmedRepeatTimes[RepeatId] = 0.0;
+	}
+}
+
+bool FXimmerseInputEventQueue::PopDueRepeat(double CurrentTime, FXimmerseRepeatTimer& OutTimer)
+{
+	while (RepeatTimers.Num() > 0 && RepeatTimers.HeapTop().Time <= CurrentTime)
+	{
+		RepeatTimers.HeapPop(OutTimer, false);
+
+		// a timer whose button was released, or released and pressed again, is no longer the armed one
+		if (ArmedRepeatTimes[OutTimer.RepeatId] == OutTimer.Time)
+		{
+			ArmedRepeatTimes[OutTimer.RepeatId] = 0.0;
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 FXimmerseInputEventQueue::Dispatch(FGenericApplicationMessageHandler& MessageHandler, FXimmerseLatencyStats* Latency)
+{
+	// controllers are visited one after the other, their samples interleave in time
+	Events.Sort();
+
+	const int32 NumEvents = Events.Num();
+	for (int32 EventIndex = 0; EventIndex < NumEvents; ++EventIndex)
+	{
+		const FXimmerseQueuedInputEvent& Event = Events[EventIndex];
+		switch (Event.Type)
+		{
+		case EXimmerseInputEventType::Pressed:
+			MessageHandler.OnControllerButtonPressed(Event.Key, Event.ControllerIndex, false);
+			break;
+		case EXimmerseInputEventType::Released:
+			MessageHandler.OnControllerButtonReleased(Event.Key, Event.ControllerIndex, false);
+			break;
+		case EXimmerseInputEventType::Repeat:
+			MessageHandler.OnControllerButtonPressed(Event.Key, Event.ControllerIndex, true);
+			break;
+		case EXimmerseInputEventType::Analog:
+			MessageHandler.OnControllerAnalog(Event.Key, Event.ControllerIndex, Event.AnalogValue);
+			break;
+		}
+
+		if (Latency != nullptr && Event.Type != EXimmerseInputEventType::Repeat)
+		{
+			FXimmerseLatencyHistogram& Histogram = (Event.Type == EXimmerseInputEventType::Analog) ? Latency->AnalogDispatch : Latency->ButtonDispatch;
+			Histogram.Record(FPlatformTime::Seconds() - Event.Time);
+		}
+	}
+
+	Events.Reset();
+	NextSequence = 0;
+	return NumEvents;
+}
+
+void FXimmerseInputEventQueue::Reset()
+{
+	Events.Reset();
+	RepeatTimers.Reset();
+	FMemory::Memzero(ArmedRepeatTimes.GetData(), ArmedRepeatTimes.Num() * sizeof(double));
+	NextSequence = 0;
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
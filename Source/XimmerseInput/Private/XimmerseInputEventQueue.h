@@ -0,0 +1,114 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+struct FXimmerseLatencyStats;
+
+/** What an FXimmerseQueuedInputEvent tells the message handler */
+struct EXimmerseInputEventType
+{
+	enum Type
+	{
+		Pressed,
+		Released,
+		Repeat,
+		Analog,
+	};
+};
+
+/** One input message, stamped with the time of the sample that caused it */
+struct FXimmerseQueuedInputEvent
+{
+	/** FPlatformTime::Seconds() at which the device took the sample, or at which the repeat fell due */
+	double Time;
+
+	/** Order of queueing, keeps the events of one sample in the order the translator produced them */
+	uint32 Sequence;
+
+	EXimmerseInputEventType::Type Type;
+	int32 ControllerIndex;
+	FGamepadKeyNames::Type Key;
+
+	/** Only for EXimmerseInputEventType::Analog */
+	float AnalogValue;
+
+	bool operator<(const FXimmerseQueuedInputEvent& Other) const
+	{
+		return (Time < Other.Time) || (Time == Other.Time && Sequence < Other.Sequence);
+	}
+};
+
+/** A button repeat falling due, see FXimmerseInputEventQueue::ScheduleRepeat */
+struct FXimmerseRepeatTimer
+{
+	double Time;
+
+	/** Caller's id of the button, one per button of every controller */
+	int32 RepeatId;
+
+	int32 ControllerIndex;
+	FGamepadKeyNames::Type Key;
+
+	/** Min-heap order */
+	bool operator<(const FXimmerseRepeatTimer& Other) const
+	{
+		return Time < Other.Time;
+	}
+};
+
+/**
+* Collects the input messages of a frame so they reach the message handler in the order the device produced
+* them, not in the order the controllers were visited. Button repeats wait in a min-heap of timers: a frame
+* without a held button only looks at the top of an empty heap. Releasing a button cancels its timer lazily,
+* stale timers are dropped when they come up. Memory is reused from frame to frame.
+*/
+class FXimmerseInputEventQueue
+{
+public:
+	FXimmerseInputEventQueue();
+
+	void AddButton(EXimmerseInputEventType::Type Type, const FGamepadKeyNames::Type& Key, int32 ControllerIndex, double Time);
+	void AddAnalog(const FGamepadKeyNames::Type& Key, int32 ControllerIndex, float Value, double Time);
+
+	/** Arms the repeat of a button to fall due at Time, replacing the one armed before */
+	void ScheduleRepeat(int32 RepeatId, const FGamepadKeyNames::Type& Key, int32 ControllerIndex, double Time);
+
+	/** Disarms the repeat of a button, its timer is dropped when it comes up */
+	void CancelRepeat(int32 RepeatId);
+
+	/** Takes the earliest repeat due at CurrentTime or before that is still armed. It is disarmed until scheduled again. */
+	bool PopDueRepeat(double CurrentTime, FXimmerseRepeatTimer& OutTimer);
+
+	/**
+	* Sends every queued event to the handler, oldest first, and empties the queue. Returns the number of events sent.
+	* With Latency, the time from each button and analog event's sample to the handler taking it is recorded; repeats
+	* are not. Only pass it when the events carry device timestamps.
+	*/
+	int32 Dispatch(FGenericApplicationMessageHandler& MessageHandler, FXimmerseLatencyStats* Latency = nullptr);
+
+	/** Drops every event and repeat */
+	void Reset();
+
+	int32 GetNumEvents() const
+	{
+		return Events.Num();
+	}
+
+	/** Timers in the heap, including cancelled ones not popped yet */
+	int32 GetNumRepeatTimers() const
+	{
+		return RepeatTimers.Num();
+	}
+
+private:
+	TArray<FXimmerseQueuedInputEvent> Events;
+	TArray<FXimmerseRepeatTimer> RepeatTimers;
+
+	/** Due time of the armed timer of every repeat id, 0 when none is armed */
+	TArray<double> ArmedRepeatTimes;
+
+	uint32 NextSequence;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
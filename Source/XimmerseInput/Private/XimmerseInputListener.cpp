@@ -0,0 +1,349 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseInputListener.h"
+#include "XimmerseLatency.h"
+#include "XimmerseSdkStats.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+FXimmerseInputListener* volatile FXimmerseInputListener::SdkListener = nullptr;
+FThreadSafeCounter FXimmerseInputListener::NumCallbacksInFlight;
+
+const EXimmerseSdkEvent::Type FXimmerseInputListener::ListenedEvents[] =
+{
+	EXimmerseSdkEvent::Key,
+	EXimmerseSdkEvent::Axis,
+	EXimmerseSdkEvent::Position,
+	EXimmerseSdkEvent::Accelerometer,
+	EXimmerseSdkEvent::Rotation,
+	EXimmerseSdkEvent::Gyroscope,
+};
+const int32 FXimmerseInputListener::NumListenedEvents = ARRAY_COUNT(ListenedEvents);
+
+FXimmerseInputListener::FXimmerseInputListener(const FXimmerseDeviceRegistry& InRegistry, bool bInListenToSdk)
+	: Registry(InRegistry)
+	, bListenToSdk(bInListenToSdk)
+	, ListenStartTime(0.0)
+	, bHeardFromSdk(false)
+{
+	if (bListenToSdk)
+	{
+		check(SdkListener == nullptr);
+		FPlatformAtomics::InterlockedExchangePtr((void**)&SdkListener, this);
+	}
+}
+
+FXimmerseInputListener::~FXimmerseInputListener()
+{
+	if (bListenToSdk)
+	{
+		for (const FDeviceState& DeviceState : DeviceStates)
+		{
+			if (DeviceState.Handle >= 0)
+			{
+				SetListeners(DeviceState.Handle, false);
+			}
+		}
+
+		// a callback that picked up the listener before it was cleared finishes before the ring goes away
+		FPlatformAtomics::InterlockedExchangePtr((void**)&SdkListener, nullptr);
+		while (NumCallbacksInFlight.GetValue() > 0)
+		{
+			FPlatformProcess::Yield();
+		}
+	}
+}
+
+uint32 FXimmerseInputListener::GetKeyButton(int32 Code)
+{
+	switch (Code)
+	{
+	case CONTROLLER_BUTTON_HOME:
+	case CONTROLLER_BUTTON_APP:
+	case CONTROLLER_BUTTON_CLICK:
+	case CONTROLLER_BUTTON_LEFT_GRIP:
+	case CONTROLLER_BUTTON_RIGHT_GRIP:
+	case CONTROLLER_BUTTON_TRIGGER:
+	case CONTROLLER_BUTTON_TOUCH:
+		return (uint32)Code;
+	default:
+		return 0;
+	}
+}
+
+void FXimmerseInputListener::PushKey(int32 Handle, int32 Button, int32 Action)
+{
+	const uint32 ButtonFlag = GetKeyButton(Button);
+	if (ButtonFlag == 0)
+	{
+		NumUnknownKeys.Increment();
+		return;
+	}
+
+	FXimmerseInputEvent Event;
+	Event.Time = FPlatformTime::Seconds();
+	Event.Handle = Handle;
+	Event.Type = EXimmerseSdkEvent::Key;
+	Event.Axis = 0;
+	Event.bPressed = (Action != 0) ? 1 : 0;
+	Event.Button = ButtonFlag;
+	Enqueue(Event);
+}
+
+void FXimmerseInputListener::PushAxis(int32 Handle, int32 Axis, float Value)
+{
+	if (Axis < 0 || Axis >= CONTROLLER_AXIS_MAX)
+	{
+		return;
+	}
+
+	FXimmerseInputEvent Event;
+	Event.Time = FPlatformTime::Seconds();
+	Event.Handle = Handle;
+	Event.Type = EXimmerseSdkEvent::Axis;
+	Event.Axis = (uint8)Axis;
+	Event.bPressed = 0;
+	Event.Values[0] = Value;
+	Enqueue(Event);
+}
+
+void FXimmerseInputListener::PushVector(int32 Handle, EXimmerseSdkEvent::Type Type, float X, float Y, float Z, float W)
+{
+	FXimmerseInputEvent Event;
+	Event.Time = FPlatformTime::Seconds();
+	Event.Handle = Handle;
+	Event.Type = (uint8)Type;
+	Event.Axis = 0;
+	Event.bPressed = 0;
+	Event.Values[0] = X;
+	Event.Values[1] = Y;
+	Event.Values[2] = Z;
+	Event.Values[3] = W;
+	Enqueue(Event);
+}
+
+void FXimmerseInputListener::Enqueue(const FXimmerseInputEvent& Event)
+{
+	if (!Events.Enqueue(Event))
+	{
+		NumDroppedEvents.Increment();
+	}
+}
+
+int32 FXimmerseInputListener::Drain(TFunctionRef<void(int32, ControllerState&, double)> OnSample)
+{
+	// controllers that appeared or came back under a new handle
+	const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+	while (DeviceStates.Num() < Devices.Num())
+	{
+		FDeviceState& DeviceState = DeviceStates[DeviceStates.AddZeroed()];
+		DeviceState.Handle = INDEX_NONE;
+		DeviceState.State.rotation[3] = 1.0f;
+	}
+
+	for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+	{
+		const int32 Handle = (Devices[DeviceIndex] != nullptr) ? Devices[DeviceIndex]->Handle : INDEX_NONE;
+		FDeviceState& DeviceState = DeviceStates[DeviceIndex];
+		if (Handle != DeviceState.Handle)
+		{
+			if (bListenToSdk && DeviceState.Handle >= 0)
+			{
+				SetListeners(DeviceState.Handle, false);
+			}
+			if (bListenToSdk && Handle >= 0)
+			{
+				SetListeners(Handle, true);
+			}
+			DeviceState.Handle = Handle;
+			DeviceState.State.handle = Handle;
+		}
+
+		// silence only counts against the SDK while a controller is there to be heard
+		if (bListenToSdk && Handle >= 0 && ListenStartTime == 0.0 && Devices[DeviceIndex]->Status.Read().IsConnected())
+		{
+			ListenStartTime = FPlatformTime::Seconds();
+		}
+	}
+
+	int32 NumEvents = 0;
+	FXimmerseInputEvent Event;
+	while (Events.Dequeue(Event))
+	{
+		++NumEvents;
+
+		// a handful of controllers at most, a scan beats a map
+		int32 DeviceIndex = 0;
+		while (DeviceIndex < DeviceStates.Num() && DeviceStates[DeviceIndex].Handle != Event.Handle)
+		{
+			++DeviceIndex;
+		}
+		if (Event.Handle < 0 || DeviceIndex == DeviceStates.Num())
+		{
+			continue;
+		}
+
+		FDeviceState& DeviceState = DeviceStates[DeviceIndex];
+		ControllerState& State = DeviceState.State;
+		bHeardFromSdk = true;
+		DeviceState.EventTime = Event.Time;
+		DeviceState.bDirty = true;
+
+		switch (Event.Type)
+		{
+		case EXimmerseSdkEvent::Key:
+			if (Event.bPressed)
+			{
+				State.buttons |= Event.Button;
+			}
+			else
+			{
+				State.buttons &= ~Event.Button;
+			}
+			EmitSample(DeviceIndex, DeviceState, OnSample);
+			break;
+
+		case EXimmerseSdkEvent::Axis:
+			State.axes[Event.Axis] = Event.Values[0];
+			break;
+
+		case EXimmerseSdkEvent::Position:
+			FMemory::Memcpy(State.position, Event.Values, sizeof(State.position));
+			break;
+
+		case EXimmerseSdkEvent::Accelerometer:
+			FMemory::Memcpy(State.accelerometer, Event.Values, sizeof(State.accelerometer));
+			break;
+
+		case EXimmerseSdkEvent::Rotation:
+			FMemory::Memcpy(State.rotation, Event.Values, sizeof(State.rotation));
+			break;
+
+		case EXimmerseSdkEvent::Gyroscope:
+			FMemory::Memcpy(State.gyroscope, Event.Values, sizeof(State.gyroscope));
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	for (int32 DeviceIndex = 0; DeviceIndex < DeviceStates.Num(); ++DeviceIndex)
+	{
+		if (DeviceStates[DeviceIndex].bDirty)
+		{
+			EmitSample(DeviceIndex, DeviceStates[DeviceIndex], OnSample);
+		}
+	}
+
+	return NumEvents;
+}
+
+void FXimmerseInputListener::EmitSample(int32 DeviceIndex, FDeviceState& DeviceState, TFunctionRef<void(int32, ControllerState&, double)> OnSample)
+{
+	// two samples within a millisecond still need different timestamps, or the second one reads as a duplicate
+	const int32 Timestamp = FXimmerseSdkClock::ToTicks(DeviceState.EventTime);
+	DeviceState.State.timestamp = ((int32)((uint32)Timestamp - (uint32)DeviceState.State.timestamp) > 0) ? Timestamp : DeviceState.State.timestamp + 1;
+	DeviceState.bDirty = false;
+
+	// the input path may change the sample, e.g. zero an untouched touchpad, the assembled state must not
+	ControllerState Sample = DeviceState.State;
+	OnSample(DeviceIndex, Sample, DeviceState.EventTime);
+}
+
+void FXimmerseInputListener::SetListeners(int32 Handle, bool bListen)
+{
+	// callbacks go in before the switches are turned on, and the switches off before the callbacks go
+	if (bListen)
+	{
+		XIMMERSE_SDK_CALL(SetEventListener, Handle, XDeviceSetEventListener(Handle, EXimmerseSdkEvent::Key, (void*)(key_delegate)&OnKey));
+		XIMMERSE_SDK_CALL(SetEventListener, Handle, XDeviceSetEventListener(Handle, EXimmerseSdkEvent::Axis, (void*)(axis_delegate)&OnAxis));
+		XIMMERSE_SDK_CALL(SetEventListener, Handle, XDeviceSetEventListener(Handle, EXimmerseSdkEvent::Position, (void*)(vector3f_delegate)&OnPosition));
+		XIMMERSE_SDK_CALL(SetEventListener, Handle, XDeviceSetEventListener(Handle, EXimmerseSdkEvent::Accelerometer, (void*)(vector3f_delegate)&OnAccelerometer));
+		XIMMERSE_SDK_CALL(SetEventListener, Handle, XDeviceSetEventListener(Handle, EXimmerseSdkEvent::Rotation, (void*)(vector4f_delegate)&OnRotation));
+		XIMMERSE_SDK_CALL(SetEventListener, Handle, XDeviceSetEventListener(Handle, EXimmerseSdkEvent::Gyroscope, (void*)(vector3f_delegate)&OnGyroscope));
+	}
+
+	// the SDK processes the device's input on its own thread and fires the callbacks from there, nobody pumps them
+	XIMMERSE_SDK_CALL(SetBool, Handle, XDeviceSetBool(Handle, kField_AutoProcessInputEvent, bListen));
+	for (int32 EventIndex = 0; EventIndex < NumListenedEvents; ++EventIndex)
+	{
+		XIMMERSE_SDK_CALL(SetBool, Handle, XDeviceSetBool(Handle, EXimmerseSdkEvent::GetSwitchField(ListenedEvents[EventIndex]), bListen));
+	}
+
+	if (!bListen)
+	{
+		for (int32 EventIndex = 0; EventIndex < NumListenedEvents; ++EventIndex)
+		{
+			XIMMERSE_SDK_CALL(SetEventListener, Handle, XDeviceSetEventListener(Handle, ListenedEvents[EventIndex], nullptr));
+		}
+	}
+}
+
+FXimmerseInputListener* FXimmerseInputListener::BeginCallback()
+{
+	NumCallbacksInFlight.Increment();
+	return SdkListener;
+}
+
+void FXimmerseInputListener::EndCallback()
+{
+	NumCallbacksInFlight.Decrement();
+}
+
+void FXimmerseInputListener::OnKey(int Which, int Code, int Action)
+{
+	if (FXimmerseInputListener* Listener = BeginCallback())
+	{
+		Listener->PushKey(Which, Code, Action);
+	}
+	EndCallback();
+}
+
+void FXimmerseInputListener::OnAxis(int Which, int Axis, float Value)
+{
+	if (FXimmerseInputListener* Listener = BeginCallback())
+	{
+		Listener->PushAxis(Which, Axis, Value);
+	}
+	EndCallback();
+}
+
+void FXimmerseInputListener::OnPosition(int Which, int Node, float X, float Y, float Z)
+{
+	if (FXimmerseInputListener* Listener = BeginCallback())
+	{
+		Listener->PushVector(Which, EXimmerseSdkEvent::Position, X, Y, Z);
+	}
+	EndCallback();
+}
+
+void FXimmerseInputListener::OnAccelerometer(int Which, int Node, float X, float Y, float Z)
+{
+	if (FXimmerseInputListener* Listener = BeginCallback())
+	{
+		Listener->PushVector(Which, EXimmerseSdkEvent::Accelerometer, X, Y, Z);
+	}
+	EndCallback();
+}
+
+void FXimmerseInputListener::OnRotation(int Which, int Node, float X, float Y, float Z, float W)
+{
+	if (FXimmerseInputListener* Listener = BeginCallback())
+	{
+		Listener->PushVector(Which, EXimmerseSdkEvent::Rotation, X, Y, Z, W);
+	}
+	EndCallback();
+}
+
+void FXimmerseInputListener::OnGyroscope(int Which, int Node, float X, float Y, float Z)
+{
+	if (FXimmerseInputListener* Listener = BeginCallback())
+	{
+		Listener->PushVector(Which, EXimmerseSdkEvent::Gyroscope, X, Y, Z);
+	}
+	EndCallback();
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,198 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+#include "XimmerseDeviceRegistry.h"
+#include "XimmerseMpscQueue.h"
+#include "Function.h"
+
+/**
+* Event IDs of XDeviceSetEventListener, each with the delegate type of Delegates.h it is fired with.
+* UNVERIFIED: xdevice.h and FieldIDs.h do not define the IDs. These assume they count the events in the order of
+* their kField_CanProcess*Event switches, from kField_CanProcessInputEvent on, and that kField_AutoProcessInputEvent
+* makes the SDK fire the callbacks from its own thread. The code of a key event is assumed to be the
+* CONTROLLER_BUTTON_* flag of the key; codes that are not one are counted and dropped, see
+* FXimmerseInputListener::GetNumUnknownKeys and the InputMode run of ximmerse.Bench. The listener falls back
+* to polling if the SDK stays silent, see ximmerse.ListenerTimeout.
+*/
+namespace EXimmerseSdkEvent
+{
+	enum Type
+	{
+		/** void_delegate, a new input state is available */
+		Input,
+		/** axis_delegate */
+		Axis,
+		/** key_delegate, action 0 is a release */
+		Key,
+		/** vector3f_delegate */
+		Position,
+		/** vector3f_delegate */
+		Accelerometer,
+		/** vector4f_delegate */
+		Rotation,
+		/** vector3f_delegate */
+		Gyroscope,
+		Count,
+	};
+
+	/** The kField_CanProcess*Event switch that lets the SDK fire Event */
+	inline int32 GetSwitchField(Type Event)
+	{
+		static const int32 SwitchFields[Count] =
+		{
+			kField_CanProcessInputEvent,
+			kField_CanProcessAxisEvent,
+			kField_CanProcessKeyEvent,
+			kField_CanProcessPositionEvent,
+			kField_CanProcessAccelerometerEvent,
+			kField_CanProcessRotationEvent,
+			kField_CanProcessGyroscopeEvent,
+		};
+		return SwitchFields[Event];
+	}
+}
+
+/** One SDK callback, as compact as the callbacks allow */
+struct FXimmerseInputEvent
+{
+	/** FPlatformTime::Seconds() when the SDK fired the callback */
+	double Time;
+
+	int32 Handle;
+
+	/** EXimmerseSdkEvent */
+	uint8 Type;
+
+	/** Axis of an axis event */
+	uint8 Axis;
+
+	/** Key events: non-zero if pressed */
+	uint16 bPressed;
+
+	/** Button flag of a key event, value of an axis event, or the vector of a vector event */
+	union
+	{
+		uint32 Button;
+		float Values[4];
+	};
+};
+
+/**
+* Input backend driven by the SDK's event callbacks instead of polling, see ximmerse.InputMode.
+* With kField_AutoProcessInputEvent set, the SDK processes each device's input on its own thread and fires
+* the callbacks there, stamped when they fire; they only push an FXimmerseInputEvent into a bounded
+* multiple-producer/single-consumer ring. The game thread makes no SDK call per frame for input: it drains
+* the ring and folds the events into a ControllerState per device, so the rest of the input path stays the same.
+*/
+class FXimmerseInputListener
+{
+public:
+	/** With bListenToSdk false the listener only hears what is pushed to it, as in the benchmark */
+	FXimmerseInputListener(const FXimmerseDeviceRegistry& InRegistry, bool bInListenToSdk = true);
+	~FXimmerseInputListener();
+
+	/** Queue an event, from any thread */
+	void PushKey(int32 Handle, int32 Button, int32 Action);
+	void PushAxis(int32 Handle, int32 Axis, float Value);
+	void PushVector(int32 Handle, EXimmerseSdkEvent::Type Type, float X, float Y, float Z, float W = 0.0f);
+
+	/**
+	* Listens to controllers that appeared or reconnected, then folds the queued events into the device states.
+	* OnSample gets a device's state after every button change, so no edge is merged away, and once more
+	* for any other change. Its arguments are the device index, the state and the time of the newest event
+	* in it. Game thread only, returns the number of events drained.
+	*/
+	int32 Drain(TFunctionRef<void(int32, ControllerState&, double)> OnSample);
+
+	/** Events dropped because the game thread fell a whole ring behind */
+	int32 GetNumDroppedEvents() const
+	{
+		return NumDroppedEvents.GetValue();
+	}
+
+	/** Key events dropped because their code is not a CONTROLLER_BUTTON_* flag */
+	int32 GetNumUnknownKeys() const
+	{
+		return NumUnknownKeys.GetValue();
+	}
+
+	/**
+	* True once a controller has been connected and listened to for Timeout seconds without a single callback, e.g.
+	* because the SDK does not know the event IDs. A listener that heard from the SDK once is never silent.
+	*/
+	bool IsSilent(double CurrentTime, double Timeout) const
+	{
+		return bListenToSdk && !bHeardFromSdk && ListenStartTime > 0.0 && CurrentTime - ListenStartTime > Timeout;
+	}
+
+private:
+	/** Events buffered between two frames, room for a few frames of every controller at 1 kHz */
+	static const uint32 QueueSize = 4096;
+
+	/** A device's state as assembled from its events */
+	struct FDeviceState
+	{
+		/** Handle the callbacks are registered for, INDEX_NONE if none */
+		int32 Handle;
+
+		ControllerState State;
+
+		/** Time of the newest event folded into State */
+		double EventTime;
+
+		/** State changed since OnSample last saw it */
+		bool bDirty;
+	};
+
+	void Enqueue(const FXimmerseInputEvent& Event);
+
+	/** The CONTROLLER_BUTTON_* flag of a key event's code, 0 if the code is not one */
+	static uint32 GetKeyButton(int32 Code);
+
+	/** Registers the callbacks of one device and turns its event processing on, or the other way round */
+	void SetListeners(int32 Handle, bool bListen);
+
+	/** The events the listener registers callbacks for */
+	static const EXimmerseSdkEvent::Type ListenedEvents[];
+	static const int32 NumListenedEvents;
+
+	/** Stamps a device's state with the time of its newest event and hands it out */
+	static void EmitSample(int32 DeviceIndex, FDeviceState& DeviceState, TFunctionRef<void(int32, ControllerState&, double)> OnSample);
+
+	/** Returns the listener registered with the SDK, which is not destroyed before the matching EndCallback */
+	static FXimmerseInputListener* BeginCallback();
+	static void EndCallback();
+
+	// SDK callbacks, forwarded to the listener registered with the SDK
+	static void OnKey(int Which, int Code, int Action);
+	static void OnAxis(int Which, int Axis, float Value);
+	static void OnPosition(int Which, int Node, float X, float Y, float Z);
+	static void OnAccelerometer(int Which, int Node, float X, float Y, float Z);
+	static void OnRotation(int Which, int Node, float X, float Y, float Z, float W);
+	static void OnGyroscope(int Which, int Node, float X, float Y, float Z);
+
+	/** The listener registered with the SDK, there is at most one */
+	static FXimmerseInputListener* volatile SdkListener;
+	static FThreadSafeCounter NumCallbacksInFlight;
+
+	const FXimmerseDeviceRegistry& Registry;
+	const bool bListenToSdk;
+
+	TXimmerseMpscQueue<FXimmerseInputEvent, QueueSize> Events;
+
+	/** Game thread only, indexed like the registry's controller slots */
+	TArray<FDeviceState> DeviceStates;
+
+	/** FPlatformTime::Seconds() when a connected controller was first listened to, 0 until then */
+	double ListenStartTime;
+
+	/** An event arrived from the SDK since the listener was created */
+	bool bHeardFromSdk;
+
+	FThreadSafeCounter NumDroppedEvents;
+	FThreadSafeCounter NumUnknownKeys;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -3,6 +3,7 @@
 #include "XimmerseInputPrivatePCH.h"
 #include "XimmerseInput.h"
 #include "IXimmerseInputPlugin.h"
+#include "XimmerseSdkInit.h"
 
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 
@@ -13,25 +14,32 @@ class FXimmerseInputModule : public IXimmerseInputPlugin
 	virtual TSharedPtr< class IInputDevice > CreateInputDevice(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler) override
 	{
 		FXimmerseInput* XimmerseInput = new FXimmerseInput(InMessageHandler);
-		XimmerseInput->DeviceHandle[0] = XDeviceGetInputDeviceHandle("XCobra-0");
-		XimmerseInput->DeviceHandle[1] = XDeviceGetInputDeviceHandle("XCobra-1");
-		XimmerseInput->DeviceHandle[2] = XDeviceGetInputDeviceHandle("XHawk-0");
+		XimmerseInput->DiscoverDevices();
 		return TSharedPtr< class IInputDevice >(XimmerseInput);
 	}
 
 	virtual void StartupModule() override
 	{
+		const double StartTime = FPlatformTime::Seconds();
+
 		IXimmerseInputPlugin::StartupModule();
 
-		XDeviceInit();
+		// driver enumeration happens in the background, devices are picked up once it is done
+		SdkInit.Reset(new FXimmerseSdkInit);
+
+		UE_LOG(LogXimmerseInput, Log, TEXT("XimmerseInput module started in %.2f ms"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
 	}
 
 	virtual void ShutdownModule() override
 	{
 		IXimmerseInputPlugin::ShutdownModule();
 
-		XDeviceExit();
+		SdkInit.Reset();
 	}
+
+private:
+	/** Initializes the SDK, and shuts it down when destroyed */
+	TUniquePtr<FXimmerseSdkInit> SdkInit;
 };
 
 #else	//	XIMMERSE_INPUT_SUPPORTED_PLATFORMS
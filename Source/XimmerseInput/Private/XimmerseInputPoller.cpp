@@ -0,0 +1,127 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseInputPoller.h"
+#include "XimmerseCapture.h"
+#include "XimmerseLatency.h"
+#include "XimmerseSdkStats.h"
+#include "XimmerseSharedMemory.h"
+#include "XimmerseTrace.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+static TAutoConsoleVariable<float> CVarPollRate(
+    TEXT("ximmerse.PollRate"),
+    1000.0f,
+    TEXT("Rate in Hz at which the poll thread samples the Ximmerse devices.\n")
+    TEXT("Should be at least the native sample rate of the controllers."),
+    ECVF_Default);
+
+FXimmerseInputPoller::FXimmerseInputPoller(const FXimmerseDeviceRegistry& InRegistry, FXimmerseCaptureWriter& InCapture, FXimmerseSharedMemoryPublisher& InSharedMemory, const FXimmerseSdkFunctions& InSdk)
+	: Sdk(InSdk)
+	, Registry(InRegistry)
+	, Capture(InCapture)
+	, SharedMemory(InSharedMemory)
+	, Thread(nullptr)
+{
+	Thread = FRunnableThread::Create(this, TEXT("XimmerseInputPoller"), 0, TPri_AboveNormal);
+}
+
+FXimmerseInputPoller::~FXimmerseInputPoller()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+uint32 FXimmerseInputPoller::Run()
+{
+	while (!bStopRequested)
+	{
+		const double PollStartTime = FPlatformTime::Seconds();
+
+		PollDevices();
+
+		const double PollInterval = 1.0 / FMath::Max(CVarPollRate.GetValueOnAnyThread(), 1.0f);
+		const double SleepTime = PollInterval - (FPlatformTime::Seconds() - PollStartTime);
+		if (SleepTime > 0.0)
+		{
+			FPlatformProcess::Sleep((float)SleepTime);
+		}
+	}
+
+	// the next poll thread, started when the input mode changes back, traces into the same ring
+	XIMMERSE_TRACE(ReleaseThreadBuffer());
+
+	return 0;
+}
+
+void FXimmerseInputPoller::Stop()
+{
+	bStopRequested = true;
+}
+
+void FXimmerseInputPoller::PollDevices()
+{
+	ControllerState XControllerState;
+
+	const double CurrentTime = FPlatformTime::Seconds();
+	FXimmerseSdkClock::Sync();
+
+	// controllers added by hot-plug show up in the next published set
+	const TArray<FXimmerseDevice*>& Devices = Registry.GetDevices().Controllers;
+	for (int32 DeviceIndex = 0; DeviceIndex < Devices.Num(); ++DeviceIndex)
+	{
+		if (Devices[DeviceIndex] == nullptr)
+		{
+			continue;
+		}
+
+		FXimmerseDevice& Device = *Devices[DeviceIndex];
+
+		// the status is refreshed on its interval only, whether the device sends samples or not
+		if (CurrentTime - Device.LastStatusTime >= STATUS_REFRESH_INTERVAL)
+		{
+			Device.RefreshStatus(Sdk);
+			Device.LastStatusTime = CurrentTime;
+		}
+
+		if (XIMMERSE_SDK_CALL(GetInputState, Device.Handle, Sdk.GetInputState(Device.Handle, &XControllerState)) < 0)
+		{
+			continue;
+		}
+
+		// only new samples are interesting; a sample counts as taken even if the ring has no room for it,
+		// so a full ring does not publish the same sample again every cycle
+		if (XControllerState.timestamp == Device.LastQueuedTimestamp)
+		{
+			continue;
+		}
+		Device.LastQueuedTimestamp = XControllerState.timestamp;
+
+		XIMMERSE_TRACE(Sample(DeviceIndex, XControllerState));
+
+		// publish the pose right away, readers on the render thread should not wait for the next frame
+		Device.Pose.Publish(XControllerState, Device.Status.Read().TrackingResult, CurrentTime, FXimmerseSdkClock::ToSeconds(XControllerState.timestamp));
+
+		if (Capture.IsRecording())
+		{
+			Capture.Append(DeviceIndex, Device.Status.Read().TrackingResult, XControllerState, CurrentTime);
+		}
+
+		if (SharedMemory.IsPublishing())
+		{
+			SharedMemory.Publish(DeviceIndex, Device.Status.Read().TrackingResult, XControllerState, Device.Pose.Read());
+		}
+
+		if (!Device.Samples.Enqueue(XControllerState))
+		{
+			NumDroppedSamples.Increment();
+		}
+	}
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
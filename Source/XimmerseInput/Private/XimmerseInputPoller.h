@@ -0,0 +1,53 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+#include "XimmerseDeviceRegistry.h"
+
+class FXimmerseCaptureWriter;
+class FXimmerseSharedMemoryPublisher;
+
+/**
+* Samples the Ximmerse devices on a dedicated thread, so controller states between two game frames are not lost.
+* Every device owns a single-producer/single-consumer ring: the poll thread enqueues, the game thread dequeues.
+* While it runs, the poller is also the only writer of the devices' shared state.
+*/
+class FXimmerseInputPoller : public FRunnable
+{
+public:
+	FXimmerseInputPoller(const FXimmerseDeviceRegistry& InRegistry, FXimmerseCaptureWriter& InCapture, FXimmerseSharedMemoryPublisher& InSharedMemory, const FXimmerseSdkFunctions& InSdk = FXimmerseSdkFunctions::GetDefault());
+	virtual ~FXimmerseInputPoller();
+
+	/** Number of samples dropped because a ring was full, since the poller was created */
+	int32 GetNumDroppedSamples() const
+	{
+		return NumDroppedSamples.GetValue();
+	}
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	/** Polls every device once and enqueues the samples whose timestamp changed */
+	void PollDevices();
+
+	/** Samples the devices and refreshes their status */
+	const FXimmerseSdkFunctions Sdk;
+
+	/** Devices to sample, owned by the input device which outlives the poller */
+	const FXimmerseDeviceRegistry& Registry;
+
+	/** Receives every sample while a capture is recording */
+	FXimmerseCaptureWriter& Capture;
+
+	/** Receives every processed sample while ximmerse.shm is publishing */
+	FXimmerseSharedMemoryPublisher& SharedMemory;
+
+	FThreadSafeCounter NumDroppedSamples;
+	FThreadSafeBool bStopRequested;
+	FRunnableThread* Thread;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
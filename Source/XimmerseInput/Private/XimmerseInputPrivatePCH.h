@@ -11,3 +11,5 @@
 #if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 #include <xdevice.h>
 #endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+DECLARE_LOG_CATEGORY_EXTERN(LogXimmerseInput, Log, All);
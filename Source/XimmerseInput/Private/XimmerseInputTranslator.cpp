@@ -0,0 +1,352 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseInputTranslator.h"
+#include <ControllerState.h>
+
+#define DOT_45DEG		0.7071f
+
+//
+// Gamepad thresholds
+//
+#define TOUCHPAD_DEADZONE			0.0f
+#define TRIGGER_DEADZONE			0.02f
+#define ANALOG_EPSILON				0.01f
+#define TRIGGER_PRESS_THRESHOLD		0.55f
+#define TRIGGER_RELEASE_THRESHOLD	0.45f
+
+//
+// Button repeat, in seconds
+//
+#define INITIAL_BUTTON_REPEAT_DELAY	0.2f
+#define BUTTON_REPEAT_DELAY			0.1f
+
+namespace XimmerseControllerKeyNames
+{
+const FGamepadKeyNames::Type Touch0("Ximmerse_Touch_0");
+const FGamepadKeyNames::Type Touch1("Ximmerse_Touch_1");
+
+const FGamepadKeyNames::Type TouchGestures[CONTROLLERS_PER_PLAYER][EXimmerseTouchGesture::Count] =
+{
+	{
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_Tap"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_Hold"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_SwipeUp"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_SwipeDown"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_SwipeLeft"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_SwipeRight"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_FlickUp"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_FlickDown"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_FlickLeft"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_FlickRight"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_ScrollClockwise"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_0_ScrollCounterClockwise"),
+	},
+	{
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_Tap"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_Hold"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_SwipeUp"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_SwipeDown"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_SwipeLeft"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_SwipeRight"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_FlickUp"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_FlickDown"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_FlickLeft"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_FlickRight"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_ScrollClockwise"),
+		FGamepadKeyNames::Type("Ximmerse_Touch_1_ScrollCounterClockwise"),
+	},
+};
+}
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+FXimmerseInputTranslator::FXimmerseInputTranslator()
+	: InitialButtonRepeatDelay(INITIAL_BUTTON_REPEAT_DELAY)
+	, ButtonRepeatDelay(BUTTON_REPEAT_DELAY)
+	, TriggerPressThreshold(TRIGGER_PRESS_THRESHOLD)
+	, TriggerReleaseThreshold(TRIGGER_RELEASE_THRESHOLD)
+{
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::System] = FGamepadKeyNames::SpecialLeft;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::ApplicationMenu] = FGamepadKeyNames::MotionController_Left_Shoulder;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadPress] = FGamepadKeyNames::MotionController_Left_Thumbstick;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadTouch] = XimmerseControllerKeyNames::Touch0;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TriggerPress] = FGamepadKeyNames::MotionController_Left_Trigger;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::Grip] = FGamepadKeyNames::MotionController_Left_Grip1;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadUp] = FGamepadKeyNames::MotionController_Left_FaceButton1;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadDown] = FGamepadKeyNames::MotionController_Left_FaceButton3;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadLeft] = FGamepadKeyNames::MotionController_Left_FaceButton4;
+	Buttons[(int32)EControllerHand::Left][EXimmerseInputButton::TouchPadRight] = FGamepadKeyNames::MotionController_Left_FaceButton2;
+
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::System] = FGamepadKeyNames::SpecialRight;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::ApplicationMenu] = FGamepadKeyNames::MotionController_Right_Shoulder;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadPress] = FGamepadKeyNames::MotionController_Right_Thumbstick;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadTouch] = XimmerseControllerKeyNames::Touch1;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TriggerPress] = FGamepadKeyNames::MotionController_Right_Trigger;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::Grip] = FGamepadKeyNames::MotionController_Right_Grip1;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadUp] = FGamepadKeyNames::MotionController_Right_FaceButton1;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadDown] = FGamepadKeyNames::MotionController_Right_FaceButton3;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadLeft] = FGamepadKeyNames::MotionController_Right_FaceButton4;
+	Buttons[(int32)EControllerHand::Right][EXimmerseInputButton::TouchPadRight] = FGamepadKeyNames::MotionController_Right_FaceButton2;
+
+	for (int32 Hand = 0; Hand < CONTROLLERS_PER_PLAYER; ++Hand)
+	{
+		for (int32 Gesture = 0; Gesture < EXimmerseTouchGesture::Count; ++Gesture)
+		{
+			GestureKeys[Hand][Gesture] = XimmerseControllerKeyNames::TouchGestures[Hand][Gesture];
+		}
+	}
+
+	FXimmerseAnalogAxisMapping& TouchPadX = AnalogAxes[EXimmerseAnalogAxis::TouchPadX];
+	TouchPadX.SdkAxis = CONTROLLER_AXIS_PRIMARY_THUMB_X;
+	TouchPadX.Scale = 1.0f;
+	TouchPadX.DeadZone = TOUCHPAD_DEADZONE;
+	TouchPadX.Epsilon = ANALOG_EPSILON;
+	TouchPadX.Keys[(int32)EControllerHand::Left] = FGamepadKeyNames::MotionController_Left_Thumbstick_X;
+	TouchPadX.Keys[(int32)EControllerHand::Right] = FGamepadKeyNames::MotionController_Right_Thumbstick_X;
+
+	// Invert the y to match UE4 convention
+	FXimmerseAnalogAxisMapping& TouchPadY = AnalogAxes[EXimmerseAnalogAxis::TouchPadY];
+	TouchPadY.SdkAxis = CONTROLLER_AXIS_PRIMARY_THUMB_Y;
+	TouchPadY.Scale = -1.0f;
+	TouchPadY.DeadZone = TOUCHPAD_DEADZONE;
+	TouchPadY.Epsilon = ANALOG_EPSILON;
+	TouchPadY.Keys[(int32)EControllerHand::Left] = FGamepadKeyNames::MotionController_Left_Thumbstick_Y;
+	TouchPadY.Keys[(int32)EControllerHand::Right] = FGamepadKeyNames::MotionController_Right_Thumbstick_Y;
+
+	FXimmerseAnalogAxisMapping& Trigger = AnalogAxes[EXimmerseAnalogAxis::Trigger];
+	Trigger.SdkAxis = CONTROLLER_AXIS_PRIMARY_TRIGGER;
+	Trigger.Scale = 1.0f;
+	Trigger.DeadZone = TRIGGER_DEADZONE;
+	Trigger.Epsilon = ANALOG_EPSILON;
+	Trigger.Keys[(int32)EControllerHand::Left] = FGamepadKeyNames::MotionController_Left_TriggerAxis;
+	Trigger.Keys[(int32)EControllerHand::Right] = FGamepadKeyNames::MotionController_Right_TriggerAxis;
+}
+
+/** Bit of a button in FXimmerseControllerInputState::ButtonStates */
+static FORCEINLINE uint32 ButtonBit(const EXimmerseInputButton::Type Button)
+{
+	return 1u << Button;
+}
+
+/** Id of a button's repeat timer in the event queue */
+static FORCEINLINE int32 GetRepeatId(const int32 DeviceIndex, const int32 ButtonIndex)
+{
+	return DeviceIndex * EXimmerseInputButton::TotalButtonCount + ButtonIndex;
+}
+
+/** Zeroes values inside the dead zone and rescales the rest to the full range */
+static FORCEINLINE float ApplyDeadZone(const float Value, const float DeadZone)
+{
+	const float Magnitude = FMath::Abs(Value);
+	if (Magnitude <= DeadZone)
+	{
+		return 0.0f;
+	}
+
+	return FMath::Sign(Value) * FMath::Min((Magnitude - DeadZone) / (1.0f - DeadZone), 1.0f);
+}
+
+void FXimmerseInputTranslator::ZeroUntouchedAxes(ControllerState& XControllerState)
+{
+	// If the touchpad isn't currently pressed or touched, zero put both of the axes
+	if ((XControllerState.buttons & CONTROLLER_BUTTON_TOUCH) == 0)
+	{
+		XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X] = 0.0f;
+		XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y] = 0.0f;
+	}
+}
+
+FXimmerseTranslatedEvents FXimmerseInputTranslator::ProcessControllerState(FXimmerseControllerInputState& State, FXimmerseInputEventQueue& Queue, const int32 DeviceIndex, const int32 ControllerIndex, const EControllerHand HandToUse, ControllerState& XControllerState, const double SampleTime) const
+{
+	FXimmerseTranslatedEvents Events;
+
+	if (XControllerState.timestamp == State.Timestamp)
+	{
+		return Events;
+	}
+
+	uint32 CurrentStates = 0;
+
+	// Get the current state of all buttons
+	if (XControllerState.buttons & CONTROLLER_BUTTON_HOME)
+	{
+		CurrentStates |= ButtonBit(EXimmerseInputButton::System);
+	}
+	if (XControllerState.buttons & CONTROLLER_BUTTON_APP)
+	{
+		CurrentStates |= ButtonBit(EXimmerseInputButton::ApplicationMenu);
+	}
+	if (XControllerState.buttons & CONTROLLER_BUTTON_CLICK)
+	{
+		CurrentStates |= ButtonBit(EXimmerseInputButton::TouchPadPress);
+	}
+	if (XControllerState.buttons & CONTROLLER_BUTTON_TOUCH)
+	{
+		CurrentStates |= ButtonBit(EXimmerseInputButton::TouchPadTouch);
+	}
+	if (XControllerState.buttons & (CONTROLLER_BUTTON_LEFT_GRIP | CONTROLLER_BUTTON_RIGHT_GRIP))
+	{
+		CurrentStates |= ButtonBit(EXimmerseInputButton::Grip);
+	}
+
+	const bool bTouching = (CurrentStates & ButtonBit(EXimmerseInputButton::TouchPadTouch)) != 0;
+	ZeroUntouchedAxes(XControllerState);
+
+	// D-pad emulation
+	const FVector2D TouchDir = FVector2D(XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X], XControllerState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y]).GetSafeNormal();
+	const FVector2D UpDir(0.f, 1.f);
+	const FVector2D RightDir(1.f, 0.f);
+
+	const float VerticalDot = TouchDir | UpDir;
+	const float RightDot = TouchDir | RightDir;
+
+	const bool bPressed = !TouchDir.IsNearlyZero() && (CurrentStates & ButtonBit(EXimmerseInputButton::TouchPadPress)) != 0;
+	if (bPressed)
+	{
+		if (VerticalDot >= DOT_45DEG)
+		{
+			CurrentStates |= ButtonBit(EXimmerseInputButton::TouchPadUp);
+		}
+		else if (VerticalDot <= -DOT_45DEG)
+		{
+			CurrentStates |= ButtonBit(EXimmerseInputButton::TouchPadDown);
+		}
+
+		if (RightDot <= -DOT_45DEG)
+		{
+			CurrentStates |= ButtonBit(EXimmerseInputButton::TouchPadLeft);
+		}
+		else if (RightDot >= DOT_45DEG)
+		{
+			CurrentStates |= ButtonBit(EXimmerseInputButton::TouchPadRight);
+		}
+	}
+
+	float AnalogValues[EXimmerseAnalogAxis::TotalAxisCount];
+	for (int32 AxisIndex = 0; AxisIndex < EXimmerseAnalogAxis::TotalAxisCount; ++AxisIndex)
+	{
+		const FXimmerseAnalogAxisMapping& Axis = AnalogAxes[AxisIndex];
+		const float Value = ApplyDeadZone(XControllerState.axes[Axis.SdkAxis] * Axis.Scale, Axis.DeadZone);
+		AnalogValues[AxisIndex] = Value;
+
+		// changes within the noise are dropped, but coming to rest or reaching the end of the range always gets through
+		const float SentValue = State.AnalogValues[AxisIndex];
+		const bool bReachedLimit = (Value == 0.0f || FMath::Abs(Value) == 1.0f) && Value != SentValue;
+		if (bReachedLimit || FMath::Abs(Value - SentValue) > Axis.Epsilon)
+		{
+			Queue.AddAnalog(Axis.Keys[(int32)HandToUse], ControllerIndex, Value, SampleTime);
+			++Events.NumAnalog;
+			State.AnalogValues[AxisIndex] = Value;
+		}
+	}
+
+	// emulate trigger button state on every sample, with hysteresis so a trigger held at the threshold does not chatter
+	const float TriggerValue = AnalogValues[EXimmerseAnalogAxis::Trigger];
+	const bool bTriggerWasPressed = (State.ButtonStates & ButtonBit(EXimmerseInputButton::TriggerPress)) != 0;
+	if (bTriggerWasPressed ? (TriggerValue > TriggerReleaseThreshold) : (TriggerValue >= TriggerPressThreshold))
+	{
+		CurrentStates |= ButtonBit(EXimmerseInputButton::TriggerPress);
+	}
+
+	// Only the buttons that changed since the previous sample queue an event, most samples change none
+	for (uint32 ChangedStates = CurrentStates ^ State.ButtonStates; ChangedStates != 0; ChangedStates &= ChangedStates - 1)
+	{
+		const int32 ButtonIndex = (int32)FMath::CountTrailingZeros(ChangedStates);
+		const FGamepadKeyNames::Type& Key = Buttons[(int32)HandToUse][ButtonIndex];
+		if (CurrentStates & (1u << ButtonIndex))
+		{
+			Queue.AddButton(EXimmerseInputEventType::Pressed, Key, ControllerIndex, SampleTime);
+			++Events.NumPressed;
+
+			// the first repeat counts from the sample that pressed the button, not from the frame that saw it
+			Queue.ScheduleRepeat(GetRepeatId(DeviceIndex, ButtonIndex), Key, ControllerIndex, SampleTime + InitialButtonRepeatDelay);
+		}
+		else
+		{
+			Queue.AddButton(EXimmerseInputEventType::Released, Key, ControllerIndex, SampleTime);
+			++Events.NumReleased;
+
+			Queue.CancelRepeat(GetRepeatId(DeviceIndex, ButtonIndex));
+		}
+	}
+
+	// Update the state for next time
+	State.ButtonStates = CurrentStates;
+
+	// gestures see every sample, in the orientation of the thumbstick axes
+	const FXimmerseAnalogAxisMapping& TouchPadX = AnalogAxes[EXimmerseAnalogAxis::TouchPadX];
+	const FXimmerseAnalogAxisMapping& TouchPadY = AnalogAxes[EXimmerseAnalogAxis::TouchPadY];
+	const FVector2D TouchPosition(XControllerState.axes[TouchPadX.SdkAxis] * TouchPadX.Scale, XControllerState.axes[TouchPadY.SdkAxis] * TouchPadY.Scale);
+
+	const FXimmerseTouchGestureEvents Gestures = TouchGestures.Update(State.TouchGesture, bTouching, TouchPosition, XControllerState.timestamp);
+	if ((Gestures.Pressed | Gestures.Released) != 0)
+	{
+		// a gesture that is over at once is pressed and released by the same sample, in that order
+		for (int32 Gesture = 0; Gesture < EXimmerseTouchGesture::Count; ++Gesture)
+		{
+			if (Gestures.Pressed & (1u << Gesture))
+			{
+				Queue.AddButton(EXimmerseInputEventType::Pressed, GestureKeys[(int32)HandToUse][Gesture], ControllerIndex, SampleTime);
+				++Events.NumPressed;
+			}
+		}
+		for (int32 Gesture = 0; Gesture < EXimmerseTouchGesture::Count; ++Gesture)
+		{
+			if (Gestures.Released & (1u << Gesture))
+			{
+				Queue.AddButton(EXimmerseInputEventType::Released, GestureKeys[(int32)HandToUse][Gesture], ControllerIndex, SampleTime);
+				++Events.NumReleased;
+			}
+		}
+	}
+
+	State.Timestamp = XControllerState.timestamp;
+
+	Events.bNewSample = true;
+	return Events;
+}
+
+void FXimmerseInputTranslator::ReleaseControllerState(FXimmerseControllerInputState& State, FXimmerseInputEventQueue& Queue, const int32 DeviceIndex, const int32 ControllerIndex, const EControllerHand HandToUse, const double CurrentTime) const
+{
+	for (uint32 HeldStates = State.ButtonStates; HeldStates != 0; HeldStates &= HeldStates - 1)
+	{
+		const int32 ButtonIndex = (int32)FMath::CountTrailingZeros(HeldStates);
+		Queue.AddButton(EXimmerseInputEventType::Released, Buttons[(int32)HandToUse][ButtonIndex], ControllerIndex, CurrentTime);
+		Queue.CancelRepeat(GetRepeatId(DeviceIndex, ButtonIndex));
+	}
+	State.ButtonStates = 0;
+
+	if (FXimmerseTouchGestureRecognizer::Reset(State.TouchGesture))
+	{
+		Queue.AddButton(EXimmerseInputEventType::Released, GestureKeys[(int32)HandToUse][EXimmerseTouchGesture::Hold], ControllerIndex, CurrentTime);
+	}
+
+	for (int32 AxisIndex = 0; AxisIndex < EXimmerseAnalogAxis::TotalAxisCount; ++AxisIndex)
+	{
+		Queue.AddAnalog(AnalogAxes[AxisIndex].Keys[(int32)HandToUse], ControllerIndex, 0.0f, CurrentTime);
+		State.AnalogValues[AxisIndex] = 0.0f;
+	}
+
+	// the first sample after reconnecting is processed even if the timestamp restarted at the old value
+	State.Timestamp = 0;
+}
+
+void FXimmerseInputTranslator::SendButtonRepeats(FXimmerseInputEventQueue& Queue, const double CurrentTime) const
+{
+	FXimmerseRepeatTimer Timer;
+	while (Queue.PopDueRepeat(CurrentTime, Timer))
+	{
+		Queue.AddButton(EXimmerseInputEventType::Repeat, Timer.Key, Timer.ControllerIndex, Timer.Time);
+
+		// after a hitch the repeats resume at the usual rate instead of catching up in a burst
+		double NextRepeatTime = Timer.Time + ButtonRepeatDelay;
+		if (NextRepeatTime <= CurrentTime)
+		{
+			NextRepeatTime = CurrentTime + ButtonRepeatDelay;
+		}
+		Queue.ScheduleRepeat(Timer.RepeatId, Timer.Key, Timer.ControllerIndex, NextRepeatTime);
+	}
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
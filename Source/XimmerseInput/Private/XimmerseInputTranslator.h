@@ -0,0 +1,165 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "IMotionController.h"
+#include "XimmerseTouchGestures.h"
+#include "XimmerseInputEventQueue.h"
+
+/** Total number of controllers in a set */
+#define CONTROLLERS_PER_PLAYER	2
+
+namespace XimmerseControllerKeyNames
+{
+extern const FGamepadKeyNames::Type Touch0;
+extern const FGamepadKeyNames::Type Touch1;
+
+/** Touchpad gestures of each hand, see EXimmerseTouchGesture */
+extern const FGamepadKeyNames::Type TouchGestures[CONTROLLERS_PER_PLAYER][EXimmerseTouchGesture::Count];
+}
+
+/**
+* Buttons on the SteamVR controller
+*/
+struct EXimmerseInputButton
+{
+	enum Type
+	{
+		System,
+		ApplicationMenu,
+		TouchPadPress,
+		TouchPadTouch,
+		TriggerPress,
+		Grip,
+		TouchPadUp,
+		TouchPadDown,
+		TouchPadLeft,
+		TouchPadRight,
+
+		/** Max number of controller buttons.  Must be <= 32, the states are a bit mask */
+		TotalButtonCount
+	};
+};
+
+/**
+* Analog axes sent as OnControllerAnalog
+*/
+struct EXimmerseAnalogAxis
+{
+	enum Type
+	{
+		TouchPadX,
+		TouchPadY,
+		Trigger,
+
+		TotalAxisCount
+	};
+};
+
+/** How one SDK axis becomes analog messages */
+struct FXimmerseAnalogAxisMapping
+{
+	/** Index into ControllerState::axes */
+	int32 SdkAxis;
+
+	/** Multiplies the SDK value, -1 flips an axis into the UE4 convention */
+	float Scale;
+
+	/** Values closer to 0 read as 0, the rest is rescaled so the full range remains */
+	float DeadZone;
+
+	/** Smallest change worth a message, smaller ones are sensor noise */
+	float Epsilon;
+
+	/** Key sent for each hand */
+	FGamepadKeyNames::Type Keys[CONTROLLERS_PER_PLAYER];
+};
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+static_assert(EXimmerseInputButton::TotalButtonCount <= 32, "Button states no longer fit FXimmerseControllerInputState::ButtonStates");
+
+/**
+* What the translator made of one controller so far: everything a sample reads and writes, aligned to
+* a cache line of its own so a controller's sample touches no line shared with another controller.
+*/
+MS_ALIGN(PLATFORM_CACHE_LINE_SIZE) struct FXimmerseControllerInputState
+{
+	/** If timestamp matches that on your prior call, then the controller state hasn't been changed since
+	* your last call and there is no need to process it. */
+	int Timestamp;
+
+	/** Last frame's button states, bit per EXimmerseInputButton, so we only send events on edges */
+	uint32 ButtonStates;
+
+	/** Last value sent for each EXimmerseAnalogAxis */
+	float AnalogValues[EXimmerseAnalogAxis::TotalAxisCount];
+
+	/** Touch in progress on the touchpad, for the gesture recognizer */
+	FXimmerseTouchGestureState TouchGesture;
+} GCC_ALIGN(PLATFORM_CACHE_LINE_SIZE);
+
+/** Number of events queued for one sample */
+struct FXimmerseTranslatedEvents
+{
+	/** False if the sample was a duplicate and nothing was queued */
+	bool bNewSample;
+
+	int32 NumPressed;
+	int32 NumReleased;
+	int32 NumAnalog;
+
+	FXimmerseTranslatedEvents()
+		: bNewSample(false)
+		, NumPressed(0)
+		, NumReleased(0)
+		, NumAnalog(0)
+	{
+	}
+};
+
+/**
+* Turns raw SDK samples into button and analog events, stamped with the sample's time. Knows nothing about
+* devices, threads or poses, so it can be driven by the input device and by the benchmark alike.
+* DeviceIndex identifies a controller's buttons in the queue's repeat timers, any index unique per controller will do.
+*/
+class FXimmerseInputTranslator
+{
+public:
+	FXimmerseInputTranslator();
+
+	/** Queues the button, gesture and analog events of one sample, zeroing its touchpad axes if the pad is not touched */
+	FXimmerseTranslatedEvents ProcessControllerState(FXimmerseControllerInputState& State, FXimmerseInputEventQueue& Queue, const int32 DeviceIndex, const int32 ControllerIndex, const EControllerHand HandToUse, ControllerState& XControllerState, const double SampleTime) const;
+
+	/** Zeroes the touchpad axes of a sample if the pad is not touched, the SDK leaves the last touch's position in them */
+	static void ZeroUntouchedAxes(ControllerState& XControllerState);
+
+	/** Queues releases for every held button and gesture, zeroes the axes and cancels the repeats */
+	void ReleaseControllerState(FXimmerseControllerInputState& State, FXimmerseInputEventQueue& Queue, const int32 DeviceIndex, const int32 ControllerIndex, const EControllerHand HandToUse, const double CurrentTime) const;
+
+	/** Queues a repeat for every button whose timer fell due by CurrentTime, at the time it fell due, and schedules the next */
+	void SendButtonRepeats(FXimmerseInputEventQueue& Queue, const double CurrentTime) const;
+
+	/** Delay before sending a repeat message after a button was first pressed */
+	float InitialButtonRepeatDelay;
+
+	/** Delay before sending a repeat message after a button has been pressed for a while, must be above 0 */
+	float ButtonRepeatDelay;
+
+	/** Mapping of controller buttons */
+	FGamepadKeyNames::Type Buttons[CONTROLLERS_PER_PLAYER][EXimmerseInputButton::TotalButtonCount];
+
+	/** Mapping and change detection of the analog axes */
+	FXimmerseAnalogAxisMapping AnalogAxes[EXimmerseAnalogAxis::TotalAxisCount];
+
+	/** The emulated trigger button goes down at the first value and up again below the second */
+	float TriggerPressThreshold;
+	float TriggerReleaseThreshold;
+
+	/** Mapping of touchpad gestures */
+	FGamepadKeyNames::Type GestureKeys[CONTROLLERS_PER_PLAYER][EXimmerseTouchGesture::Count];
+
+	/** Gesture thresholds */
+	FXimmerseTouchGestureRecognizer TouchGestures;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
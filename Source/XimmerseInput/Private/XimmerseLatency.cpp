@@ -0,0 +1,145 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseLatency.h"
+#include "XimmerseSdkStats.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+void FXimmerseLatencyHistogram::Record(double Seconds)
+{
+	// a clock that drifted past the sample time reads as no latency rather than as a huge one
+	const uint32 Microseconds = (uint32)FMath::Clamp(Seconds * 1000000.0, 0.0, (double)MAX_int32);
+	FPlatformAtomics::InterlockedIncrement(&Counts[GetBucketIndex(Microseconds)]);
+
+	int32 CurrentMax = MaxMicroseconds;
+	while ((int32)Microseconds > CurrentMax)
+	{
+		const int32 PreviousMax = FPlatformAtomics::InterlockedCompareExchange(&MaxMicroseconds, (int32)Microseconds, CurrentMax);
+		if (PreviousMax == CurrentMax)
+		{
+			break;
+		}
+		CurrentMax = PreviousMax;
+	}
+}
+
+double FXimmerseLatencyHistogram::GetPercentile(double Percentile) const
+{
+	const int64 Count = GetCount();
+	if (Count == 0)
+	{
+		return 0.0;
+	}
+
+	const int64 Rank = FMath::Max((int64)FMath::CeilToDouble(Percentile * 0.01 * Count), (int64)1);
+	int64 Seen = 0;
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; ++BucketIndex)
+	{
+		Seen += Counts[BucketIndex];
+		if (Seen >= Rank)
+		{
+			return FMath::Min(GetBucketMax(BucketIndex), (uint32)MaxMicroseconds) * 0.000001;
+		}
+	}
+
+	return GetMax();
+}
+
+int64 FXimmerseLatencyHistogram::GetCount() const
+{
+	int64 Count = 0;
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; ++BucketIndex)
+	{
+		Count += Counts[BucketIndex];
+	}
+	return Count;
+}
+
+void FXimmerseLatencyHistogram::Reset()
+{
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; ++BucketIndex)
+	{
+		FPlatformAtomics::InterlockedExchange(&Counts[BucketIndex], 0);
+	}
+	FPlatformAtomics::InterlockedExchange(&MaxMicroseconds, 0);
+}
+
+int32 FXimmerseLatencyHistogram::GetBucketIndex(uint32 Microseconds)
+{
+	if (Microseconds < SubBucketCount)
+	{
+		return Microseconds;
+	}
+
+	// the top SubBucketBits + 1 bits select the bucket, the lower ones are the precision given up
+	const int32 Shift = FMath::Min((int32)FMath::FloorLog2(Microseconds), ValueBits - 1) - SubBucketBits;
+	const int32 SubBucket = FMath::Min(Microseconds >> Shift, (uint32)(2 * SubBucketCount - 1)) - SubBucketCount;
+	return (Shift + 1) * SubBucketCount + SubBucket;
+}
+
+uint32 FXimmerseLatencyHistogram::GetBucketMax(int32 BucketIndex)
+{
+	if (BucketIndex < SubBucketCount)
+	{
+		return BucketIndex;
+	}
+
+	const int32 Shift = BucketIndex / SubBucketCount - 1;
+	const uint32 SubBucket = BucketIndex % SubBucketCount + SubBucketCount;
+	return ((SubBucket + 1) << Shift) - 1;
+}
+
+TXimmerseSeqLock<FXimmerseSdkClock::FSyncPoint> FXimmerseSdkClock::SyncPoint;
+
+void FXimmerseSdkClock::Sync()
+{
+	FSyncPoint NewSyncPoint;
+	NewSyncPoint.TickCount = XIMMERSE_SDK_CALL(GetTickCount, -1, XDeviceGetTickCount());
+	NewSyncPoint.Seconds = FPlatformTime::Seconds();
+	SyncPoint.Write(NewSyncPoint);
+}
+
+double FXimmerseSdkClock::ToSeconds(int32 Timestamp)
+{
+	const FSyncPoint CurrentSyncPoint = SyncPoint.Read();
+	if (CurrentSyncPoint.Seconds == 0.0)
+	{
+		return 0.0;
+	}
+
+	// the difference stays right when the tick count wraps around
+	return CurrentSyncPoint.Seconds + (int32)((uint32)Timestamp - (uint32)CurrentSyncPoint.TickCount) * 0.001;
+}
+
+int32 FXimmerseSdkClock::ToTicks(double Seconds)
+{
+	const FSyncPoint CurrentSyncPoint = SyncPoint.Read();
+	if (CurrentSyncPoint.Seconds == 0.0)
+	{
+		return 0;
+	}
+
+	return (int32)((uint32)CurrentSyncPoint.TickCount + (uint32)(int32)FMath::FloorToDouble((Seconds - CurrentSyncPoint.Seconds) * 1000.0));
+}
+
+static void DumpHistogram(FOutputDevice& Ar, const TCHAR* Name, const FXimmerseLatencyHistogram& Histogram)
+{
+	Ar.Logf(TEXT("  %-18s %10lld samples  p50 %7.2f ms  p99 %7.2f ms  p99.9 %7.2f ms  max %7.2f ms"),
+		Name,
+		Histogram.GetCount(),
+		Histogram.GetPercentile(50.0) * 1000.0,
+		Histogram.GetPercentile(99.0) * 1000.0,
+		Histogram.GetPercentile(99.9) * 1000.0,
+		Histogram.GetMax() * 1000.0);
+}
+
+void FXimmerseLatencyStats::Dump(FOutputDevice& Ar) const
+{
+	Ar.Logf(TEXT("Ximmerse input latency since the device sampled:"));
+	DumpHistogram(Ar, TEXT("Button dispatch"), ButtonDispatch);
+	DumpHistogram(Ar, TEXT("Analog dispatch"), AnalogDispatch);
+	DumpHistogram(Ar, TEXT("Render thread pose"), RenderThreadPose);
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,106 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+#include "XimmerseSeqLock.h"
+
+/**
+* Log-linear histogram of latencies in microseconds, in the spirit of HdrHistogram: every power of two
+* is split into 2^SubBucketBits linear buckets, so any value is kept to about 3% precision.
+* Recording is an interlocked increment, plus a compare-exchange when the maximum grows, and may happen
+* on any number of threads at once.
+*/
+class FXimmerseLatencyHistogram
+{
+public:
+	FXimmerseLatencyHistogram()
+	{
+		Reset();
+	}
+
+	void Record(double Seconds);
+
+	/** Smallest recorded latency in seconds that Percentile percent of the samples do not exceed */
+	double GetPercentile(double Percentile) const;
+
+	int64 GetCount() const;
+
+	double GetMax() const
+	{
+		return MaxMicroseconds * 0.000001;
+	}
+
+	/** Zeroes every bucket. Samples recorded concurrently may survive. */
+	void Reset();
+
+private:
+	enum
+	{
+		SubBucketBits = 5,
+		SubBucketCount = 1 << SubBucketBits,
+
+		/** Values from 2^ValueBits microseconds (about 33 s) on land in the last bucket */
+		ValueBits = 25,
+		NumBuckets = (ValueBits - SubBucketBits + 1) * SubBucketCount,
+	};
+
+	static int32 GetBucketIndex(uint32 Microseconds);
+
+	/** Largest value that falls into a bucket */
+	static uint32 GetBucketMax(int32 BucketIndex);
+
+	volatile int32 Counts[NumBuckets];
+	volatile int32 MaxMicroseconds;
+};
+
+/**
+* Maps SDK timestamps, in milliseconds of XDeviceGetTickCount(), to FPlatformTime::Seconds().
+* The sampling thread syncs it once per poll cycle, any thread may convert.
+*/
+class FXimmerseSdkClock
+{
+public:
+	/** Pairs the current SDK tick count with the current platform time */
+	static void Sync();
+
+	/** Platform time at which the SDK stamped a sample, 0 if the clock was never synced */
+	static double ToSeconds(int32 Timestamp);
+
+	/** SDK tick count at a platform time, for samples the plugin stamps itself. 0 if the clock was never synced. */
+	static int32 ToTicks(double Seconds);
+
+private:
+	struct FSyncPoint
+	{
+		int32 TickCount;
+		double Seconds;
+	};
+
+	static TXimmerseSeqLock<FSyncPoint> SyncPoint;
+};
+
+/** Latency from the moment the device took a sample to each of its consumers */
+struct FXimmerseLatencyStats
+{
+	/** Until OnControllerButtonPressed / OnControllerButtonReleased */
+	FXimmerseLatencyHistogram ButtonDispatch;
+
+	/** Until OnControllerAnalog */
+	FXimmerseLatencyHistogram AnalogDispatch;
+
+	/** Until the render thread reads the pose */
+	FXimmerseLatencyHistogram RenderThreadPose;
+
+	/** Prints p50, p99, p99.9 and the maximum of every histogram */
+	void Dump(FOutputDevice& Ar) const;
+
+	void Reset()
+	{
+		ButtonDispatch.Reset();
+		AnalogDispatch.Reset();
+		RenderThreadPose.Reset();
+	}
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
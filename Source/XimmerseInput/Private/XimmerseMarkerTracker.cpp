@@ -0,0 +1,232 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseMarkerTracker.h"
+#include "XimmerseSdkStats.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+//
+// Association thresholds
+//
+#define TRACKER_GATE_RADIUS				5.0f
+#define TRACKER_MAX_MISSED_FRAMES		10
+#define TRACKER_VELOCITY_SMOOTHING		0.5f
+
+/** Frame time assumed when the tracker's timestamps do not advance */
+#define TRACKER_DEFAULT_FRAME_TIME		(1.0f / 60.0f)
+
+/** Fewest hash buckets, the hash has at least twice as many buckets as markers */
+#define TRACKER_MIN_BUCKETS				16
+
+/** Position of a blob in Unreal space: the SDK's right-handed meters into Unreal's left-handed centimeters, like XimmerseToUnrealPose */
+static FORCEINLINE FVector GetBlobPosition(const TrackerState& State, int32 BlobIndex)
+{
+	const float* Data = State.data + BlobIndex * XIMMERSE_TRACKER_BLOB_STRIDE;
+	return FVector(-Data[2] * 100.0f, Data[0] * 100.0f, Data[1] * 100.0f);
+}
+
+FXimmerseMarkerTracker::FXimmerseMarkerTracker()
+	: GateRadius(TRACKER_GATE_RADIUS)
+	, MaxMissedFrames(TRACKER_MAX_MISSED_FRAMES)
+	, VelocitySmoothing(TRACKER_VELOCITY_SMOOTHING)
+	, LastFrameCount(0)
+	, LastTimestamp(0)
+	, NextTrackId(0)
+	, NumDroppedFrames(0)
+{
+	IdBuffer.SetNumZeroed(XIMMERSE_TRACKER_MAX_BLOBS);
+	DataBuffer.SetNumZeroed(XIMMERSE_TRACKER_MAX_BLOBS * XIMMERSE_TRACKER_BLOB_STRIDE);
+}
+
+bool FXimmerseMarkerTracker::Poll(int32 TrackerHandle)
+{
+	if (TrackerHandle < 0)
+	{
+		return false;
+	}
+
+	TrackerState State;
+	FMemory::Memzero(State);
+	State.capacity = XIMMERSE_TRACKER_MAX_BLOBS;
+	State.id = IdBuffer.GetData();
+	State.data = DataBuffer.GetData();
+
+	if (XIMMERSE_SDK_CALL(GetInputState, TrackerHandle, XDeviceGetInputState(TrackerHandle, &State)) < 0 || State.frameCount == LastFrameCount)
+	{
+		return false;
+	}
+
+	if (LastFrameCount != 0 && State.frameCount - LastFrameCount > 1)
+	{
+		NumDroppedFrames += State.frameCount - LastFrameCount - 1;
+	}
+	LastFrameCount = State.frameCount;
+
+	Update(State);
+	return true;
+}
+
+FIntVector FXimmerseMarkerTracker::GetCell(const FVector& Position) const
+{
+	const float InvCellSize = 1.0f / GateRadius;
+	return FIntVector(FMath::FloorToInt(Position.X * InvCellSize), FMath::FloorToInt(Position.Y * InvCellSize), FMath::FloorToInt(Position.Z * InvCellSize));
+}
+
+uint32 FXimmerseMarkerTracker::GetCellHash(const FIntVector& Cell) const
+{
+	return (((uint32)Cell.X * 73856093u) ^ ((uint32)Cell.Y * 19349663u) ^ ((uint32)Cell.Z * 83492791u)) & (uint32)(BucketHeads.Num() - 1);
+}
+
+void FXimmerseMarkerTracker::BuildHash()
+{
+	const int32 NumBuckets = (int32)FMath::RoundUpToPowerOfTwo((uint32)FMath::Max(Markers.Num() * 2, TRACKER_MIN_BUCKETS));
+	BucketHeads.SetNumUninitialized(NumBuckets, false);
+	for (int32& Head : BucketHeads)
+	{
+		Head = INDEX_NONE;
+	}
+
+	NextInBucket.SetNumUninitialized(Markers.Num(), false);
+	for (int32 MarkerIndex = 0; MarkerIndex < Markers.Num(); ++MarkerIndex)
+	{
+		const uint32 Bucket = GetCellHash(GetCell(Predictions[MarkerIndex]));
+		NextInBucket[MarkerIndex] = BucketHeads[Bucket];
+		BucketHeads[Bucket] = MarkerIndex;
+	}
+}
+
+void FXimmerseMarkerTracker::Update(const TrackerState& State)
+{
+	if (State.data == nullptr)
+	{
+		return;
+	}
+
+	// a state pointing at the SDK's own buffers describes their capacity
+	const int32 NumBlobs = FMath::Clamp(State.count, 0, (State.capacity > 0) ? State.capacity : XIMMERSE_TRACKER_MAX_BLOBS);
+
+	// SDK timestamps count milliseconds, differences stay right across a wrap
+	float DeltaTime = (LastTimestamp != 0) ? (float)(State.timestamp - LastTimestamp) * 0.001f : 0.0f;
+	if (DeltaTime <= 0.0f)
+	{
+		DeltaTime = TRACKER_DEFAULT_FRAME_TIME;
+	}
+	LastTimestamp = State.timestamp;
+
+	const int32 NumMarkers = Markers.Num();
+	Predictions.SetNumUninitialized(NumMarkers, false);
+	MarkerBlobs.SetNumUninitialized(NumMarkers, false);
+	MarkerDistances.SetNumUninitialized(NumMarkers, false);
+	for (int32 MarkerIndex = 0; MarkerIndex < NumMarkers; ++MarkerIndex)
+	{
+		const FXimmerseTrackedMarker& Marker = Markers[MarkerIndex];
+		Predictions[MarkerIndex] = Marker.Position + Marker.Velocity * DeltaTime;
+		MarkerBlobs[MarkerIndex] = INDEX_NONE;
+		MarkerDistances[MarkerIndex] = MAX_flt;
+	}
+
+	BuildHash();
+
+	// every blob asks for the nearest marker within the gate, every marker keeps the nearest blob that asked
+	const float GateRadiusSquared = FMath::Square(GateRadius);
+	BlobMarkers.SetNumUninitialized(NumBlobs, false);
+	for (int32 BlobIndex = 0; BlobIndex < NumBlobs; ++BlobIndex)
+	{
+		const FVector Position = GetBlobPosition(State, BlobIndex);
+		const FIntVector Cell = GetCell(Position);
+
+		int32 NearestMarker = INDEX_NONE;
+		float NearestDistance = GateRadiusSquared;
+		for (int32 Z = -1; Z <= 1; ++Z)
+		{
+			for (int32 Y = -1; Y <= 1; ++Y)
+			{
+				for (int32 X = -1; X <= 1; ++X)
+				{
+					const uint32 Bucket = GetCellHash(Cell + FIntVector(X, Y, Z));
+					for (int32 MarkerIndex = BucketHeads[Bucket]; MarkerIndex != INDEX_NONE; MarkerIndex = NextInBucket[MarkerIndex])
+					{
+						const float Distance = FVector::DistSquared(Position, Predictions[MarkerIndex]);
+						if (Distance <= NearestDistance)
+						{
+							NearestMarker = MarkerIndex;
+							NearestDistance = Distance;
+						}
+					}
+				}
+			}
+		}
+
+		BlobMarkers[BlobIndex] = NearestMarker;
+		if (NearestMarker != INDEX_NONE && NearestDistance < MarkerDistances[NearestMarker])
+		{
+			MarkerBlobs[NearestMarker] = BlobIndex;
+			MarkerDistances[NearestMarker] = NearestDistance;
+		}
+	}
+
+	// markers that got a blob move to it, the others coast along their prediction
+	for (int32 MarkerIndex = 0; MarkerIndex < NumMarkers; ++MarkerIndex)
+	{
+		FXimmerseTrackedMarker& Marker = Markers[MarkerIndex];
+		const int32 BlobIndex = MarkerBlobs[MarkerIndex];
+		if (BlobIndex == INDEX_NONE)
+		{
+			Marker.Position = Predictions[MarkerIndex];
+			++Marker.NumFramesMissed;
+			continue;
+		}
+
+		// after a miss the marker coasted on its old velocity, the jump back onto the blob is no velocity of its own
+		const FVector Position = GetBlobPosition(State, BlobIndex);
+		if (Marker.NumFramesMissed == 0)
+		{
+			const FVector MeasuredVelocity = (Position - Marker.Position) / DeltaTime;
+			Marker.Velocity = (Marker.NumFramesSeen > 1) ? FMath::Lerp(Marker.Velocity, MeasuredVelocity, VelocitySmoothing) : MeasuredVelocity;
+		}
+		Marker.Position = Position;
+		Marker.BlobId = (State.id != nullptr) ? State.id[BlobIndex] : -1;
+		++Marker.NumFramesSeen;
+		Marker.NumFramesMissed = 0;
+	}
+
+	// the survivors keep their order, the association arrays are rebuilt next frame anyway
+	int32 NumKept = 0;
+	for (int32 MarkerIndex = 0; MarkerIndex < NumMarkers; ++MarkerIndex)
+	{
+		if (Markers[MarkerIndex].NumFramesMissed <= MaxMissedFrames)
+		{
+			Markers[NumKept++] = Markers[MarkerIndex];
+		}
+	}
+	Markers.SetNum(NumKept, false);
+
+	// blobs no marker took are new markers, or a marker that jumped farther than the gate
+	for (int32 BlobIndex = 0; BlobIndex < NumBlobs; ++BlobIndex)
+	{
+		const int32 MarkerIndex = BlobMarkers[BlobIndex];
+		if (MarkerIndex != INDEX_NONE && MarkerBlobs[MarkerIndex] == BlobIndex)
+		{
+			continue;
+		}
+
+		FXimmerseTrackedMarker& Marker = Markers[Markers.AddUninitialized()];
+		Marker.TrackId = NextTrackId++;
+		Marker.BlobId = (State.id != nullptr) ? State.id[BlobIndex] : -1;
+		Marker.Position = GetBlobPosition(State, BlobIndex);
+		Marker.Velocity = FVector::ZeroVector;
+		Marker.NumFramesSeen = 1;
+		Marker.NumFramesMissed = 0;
+	}
+}
+
+void FXimmerseMarkerTracker::Reset()
+{
+	Markers.Reset();
+	LastFrameCount = 0;
+	LastTimestamp = 0;
+	NumDroppedFrames = 0;
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,106 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Blobs one XHawk frame may report, the buffers handed to the SDK have room for this many */
+#define XIMMERSE_TRACKER_MAX_BLOBS		256
+
+/** Floats per blob in TrackerState::data: x, y and z in meters, in the SDK's right-handed space */
+#define XIMMERSE_TRACKER_BLOB_STRIDE	3
+
+/** A marker followed from tracker frame to tracker frame */
+struct FXimmerseTrackedMarker
+{
+	/** Assigned by the tracker when the marker first appears, never reused */
+	int32 TrackId;
+
+	/** SDK id of the blob last associated with the marker, -1 if the SDK did not identify it */
+	int32 BlobId;
+
+	/** In Unreal space, cm and cm/s, relative to the tracker */
+	FVector Position;
+	FVector Velocity;
+
+	/** Tracker frames the marker was seen in, and frames since it was seen last */
+	int32 NumFramesSeen;
+	int32 NumFramesMissed;
+};
+
+/**
+* Follows the blobs of the XHawk tracker across frames. Every frame's blobs are associated with the markers'
+* predicted positions through a spatial hash, so a frame costs time linear in the number of blobs and markers.
+* The blobs are read straight from the TrackerState's buffers, nothing is copied. Memory is reused from frame
+* to frame once the largest frame was seen. Game thread only.
+*/
+class FXimmerseMarkerTracker
+{
+public:
+	FXimmerseMarkerTracker();
+
+	/**
+	* Reads the tracker's newest frame, handing the SDK buffers of its own to fill. If the SDK points the state at
+	* its own buffers instead, those are borrowed for the frame. Returns true if there was a new frame.
+	*/
+	bool Poll(int32 TrackerHandle);
+
+	/** Associates the blobs of a frame with the markers, whatever filled the TrackerState */
+	void Update(const TrackerState& State);
+
+	/** Markers currently followed, including those missed for less than MaxMissedFrames */
+	const TArray<FXimmerseTrackedMarker>& GetMarkers() const
+	{
+		return Markers;
+	}
+
+	/** Tracker frames skipped between two polls, the frame counter jumped over them */
+	int32 GetNumDroppedFrames() const
+	{
+		return NumDroppedFrames;
+	}
+
+	/** Forgets every marker */
+	void Reset();
+
+	/** A blob farther than this from a marker's predicted position is not that marker, in cm. Also the hash cell size. */
+	float GateRadius;
+
+	/** Frames a marker survives without a blob before it is dropped */
+	int32 MaxMissedFrames;
+
+	/** Weight of a new velocity measurement, from 0 (ignore) to 1 (use as is) */
+	float VelocitySmoothing;
+
+private:
+	/** Hash of the grid cell a position falls into */
+	uint32 GetCellHash(const FIntVector& Cell) const;
+	FIntVector GetCell(const FVector& Position) const;
+
+	/** Fills the hash with the markers' predicted positions */
+	void BuildHash();
+
+	TArray<FXimmerseTrackedMarker> Markers;
+
+	/** Predicted position of every marker for the frame being associated */
+	TArray<FVector> Predictions;
+
+	/** Spatial hash of the predictions: first marker of every bucket, and the next marker of every marker, INDEX_NONE ends a chain */
+	TArray<int32> BucketHeads;
+	TArray<int32> NextInBucket;
+
+	/** Blob each marker accepted and its squared distance, and the marker each blob asked for */
+	TArray<int32> MarkerBlobs;
+	TArray<float> MarkerDistances;
+	TArray<int32> BlobMarkers;
+
+	/** What Poll hands to the SDK */
+	TArray<int32> IdBuffer;
+	TArray<float> DataBuffer;
+
+	int32 LastFrameCount;
+	int32 LastTimestamp;
+	int32 NextTrackId;
+	int32 NumDroppedFrames;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
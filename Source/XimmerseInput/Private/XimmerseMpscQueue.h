@@ -0,0 +1,96 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/**
+* Bounded multiple-producer/single-consumer ring of trivially copyable elements (after Vyukov's bounded queue).
+* Every cell carries a sequence number telling whose turn it is, so producers only contend on one
+* compare-exchange of the enqueue position and never wait for each other; the consumer takes no lock at all.
+* Enqueueing into a full ring fails instead of blocking. Positions and sequence numbers are unsigned and wrap
+* around, they are only ever compared through their difference.
+*/
+template<typename ElementType, uint32 Capacity>
+class TXimmerseMpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	TXimmerseMpscQueue()
+		: EnqueuePosition(0)
+		, DequeuePosition(0)
+	{
+		for (uint32 Index = 0; Index < Capacity; ++Index)
+		{
+			Cells[Index].Sequence = Index;
+		}
+	}
+
+	/** Adds an element from any thread, returns false if the ring is full */
+	bool Enqueue(const ElementType& Element)
+	{
+		uint32 Position = EnqueuePosition;
+		for (;;)
+		{
+			FCell& Cell = Cells[Position & (Capacity - 1)];
+			const uint32 Sequence = Cell.Sequence;
+			FPlatformMisc::MemoryBarrier();
+
+			const int32 Difference = (int32)(Sequence - Position);
+			if (Difference == 0)
+			{
+				// the cell is free for this position, claim the position; the atomics only come signed
+				const uint32 PreviousPosition = (uint32)FPlatformAtomics::InterlockedCompareExchange((volatile int32*)&EnqueuePosition, (int32)(Position + 1), (int32)Position);
+				if (PreviousPosition == Position)
+				{
+					Cell.Element = Element;
+					FPlatformMisc::MemoryBarrier();
+					Cell.Sequence = Position + 1;
+					return true;
+				}
+				Position = PreviousPosition;
+			}
+			else if (Difference < 0)
+			{
+				// the consumer has not freed the cell of the previous lap yet
+				return false;
+			}
+			else
+			{
+				Position = EnqueuePosition;
+			}
+		}
+	}
+
+	/** Removes the oldest element, only from the consumer thread. Returns false if the ring is empty. */
+	bool Dequeue(ElementType& OutElement)
+	{
+		FCell& Cell = Cells[DequeuePosition & (Capacity - 1)];
+		const uint32 Sequence = Cell.Sequence;
+		FPlatformMisc::MemoryBarrier();
+
+		// a producer claimed the position but is still writing the element
+		if (Sequence != DequeuePosition + 1)
+		{
+			return false;
+		}
+
+		OutElement = Cell.Element;
+		FPlatformMisc::MemoryBarrier();
+		Cell.Sequence = DequeuePosition + Capacity;
+		++DequeuePosition;
+		return true;
+	}
+
+private:
+	struct FCell
+	{
+		volatile uint32 Sequence;
+		ElementType Element;
+	};
+
+	FCell Cells[Capacity];
+
+	/** Padding keeps the producers' and the consumer's positions on different cache lines */
+	volatile uint32 EnqueuePosition;
+	uint8 EnqueuePadding[PLATFORM_CACHE_LINE_SIZE - sizeof(uint32)];
+	uint32 DequeuePosition;
+};
@@ -0,0 +1,522 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmersePacketCodec.h"
+#include <ControllerState.h>
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Bits of the sequence number, of the distance back to the baseline and of each field without a baseline */
+#define PACKET_SEQUENCE_BITS		16
+#define PACKET_BASELINE_AGE_BITS	5
+#define PACKET_TIMESTAMP_BITS		32
+#define PACKET_BUTTON_BITS			7
+#define PACKET_TRACKING_BITS		2
+#define PACKET_AXIS_BITS			8
+
+/** Changes sent as a delta, about 2 s of timestamp and 12.8 cm of position, anything further is sent whole */
+#define PACKET_TIMESTAMP_DELTA_BITS	12
+#define PACKET_POSITION_DELTA_BITS	9
+
+#define PACKET_SQRT2				1.41421356f
+
+static_assert(XIMMERSE_PACKET_HISTORY == (1 << PACKET_BASELINE_AGE_BITS), "The baseline age must be able to name every packet in the history");
+static_assert(XIMMERSE_PACKET_MAX_CONTROLLERS <= 8, "The controller mask is a uint8");
+static_assert(2 + 3 * XIMMERSE_PACKET_ROTATION_BITS <= 32, "A packed rotation is a uint32");
+
+/** SDK buttons in the order of the packet's button bits */
+static const uint32 PacketButtons[PACKET_BUTTON_BITS] =
+{
+	CONTROLLER_BUTTON_HOME,
+	CONTROLLER_BUTTON_APP,
+	CONTROLLER_BUTTON_CLICK,
+	CONTROLLER_BUTTON_LEFT_GRIP,
+	CONTROLLER_BUTTON_RIGHT_GRIP,
+	CONTROLLER_BUTTON_TRIGGER,
+	CONTROLLER_BUTTON_TOUCH,
+};
+
+/** SDK axes in the order of FXimmerseQuantizedSample::Axes, the trigger first */
+static const int32 PacketAxes[3] =
+{
+	CONTROLLER_AXIS_PRIMARY_TRIGGER,
+	CONTROLLER_AXIS_PRIMARY_THUMB_X,
+	CONTROLLER_AXIS_PRIMARY_THUMB_Y,
+};
+
+//
+// Bit packing
+//
+
+static void WriteUnsigned(FBitWriter& Writer, uint32 Value, int32 NumBits)
+{
+	if (NumBits >= 32)
+	{
+		Writer << Value;
+	}
+	else
+	{
+		Writer.WriteInt(Value, 1u << NumBits);
+	}
+}
+
+static uint32 ReadUnsigned(FBitReader& Reader, int32 NumBits)
+{
+	uint32 Value = 0;
+	if (NumBits >= 32)
+	{
+		Reader << Value;
+	}
+	else
+	{
+		Value = Reader.ReadInt(1u << NumBits);
+	}
+	return Value;
+}
+
+/** Values must fit into NumBits as two's complement, they are sent offset to be positive */
+static void WriteSigned(FBitWriter& Writer, int32 Value, int32 NumBits)
+{
+	WriteUnsigned(Writer, (NumBits >= 32) ? (uint32)Value : (uint32)(Value + (1 << (NumBits - 1))), NumBits);
+}
+
+static int32 ReadSigned(FBitReader& Reader, int32 NumBits)
+{
+	const uint32 Value = ReadUnsigned(Reader, NumBits);
+	return (NumBits >= 32) ? (int32)Value : (int32)Value - (1 << (NumBits - 1));
+}
+
+/** One bit if the value did not change since the baseline, else the new value */
+static void WriteChanged(FBitWriter& Writer, uint32 Value, uint32 BaselineValue, int32 NumBits)
+{
+	Writer.WriteBit(Value != BaselineValue);
+	if (Value != BaselineValue)
+	{
+		WriteUnsigned(Writer, Value, NumBits);
+	}
+}
+
+static uint32 ReadChanged(FBitReader& Reader, uint32 BaselineValue, int32 NumBits)
+{
+	return Reader.ReadBit() ? ReadUnsigned(Reader, NumBits) : BaselineValue;
+}
+
+/** One bit if the value did not change since the baseline, a short delta if it changed a little, else the whole value */
+static void WriteDelta(FBitWriter& Writer, int32 Value, int32 BaselineValue, int32 DeltaBits, int32 ValueBits)
+{
+	const int32 Delta = Value - BaselineValue;
+	Writer.WriteBit(Delta != 0);
+	if (Delta == 0)
+	{
+		return;
+	}
+
+	const int32 DeltaLimit = 1 << (DeltaBits - 1);
+	const bool bSmall = Delta >= -DeltaLimit && Delta < DeltaLimit;
+	Writer.WriteBit(bSmall);
+	WriteSigned(Writer, bSmall ? Delta : Value, bSmall ? DeltaBits : ValueBits);
+}
+
+static int32 ReadDelta(FBitReader& Reader, int32 BaselineValue, int32 DeltaBits, int32 ValueBits)
+{
+	if (!Reader.ReadBit())
+	{
+		return BaselineValue;
+	}
+	return Reader.ReadBit() ? BaselineValue + ReadSigned(Reader, DeltaBits) : ReadSigned(Reader, ValueBits);
+}
+
+//
+// Quantization
+//
+
+/**
+* Smallest three: a unit quaternion is known from any three components, and the three smallest lie within
+* +-1/sqrt(2). The largest is left out and made positive, q and -q being the same rotation.
+*/
+static uint32 QuantizeRotation(const float* Rotation)
+{
+	float Components[4] = { Rotation[0], Rotation[1], Rotation[2], Rotation[3] };
+
+	const float SizeSquared = Components[0] * Components[0] + Components[1] * Components[1] + Components[2] * Components[2] + Components[3] * Components[3];
+	if (SizeSquared < KINDA_SMALL_NUMBER)
+	{
+		// an untracked controller may report no rotation at all
+		Components[0] = Components[1] = Components[2] = 0.0f;
+		Components[3] = 1.0f;
+	}
+	else
+	{
+		const float Scale = FMath::InvSqrt(SizeSquared);
+		for (float& Component : Components)
+		{
+			Component *= Scale;
+		}
+	}
+
+	int32 Largest = 0;
+	for (int32 Index = 1; Index < 4; ++Index)
+	{
+		if (FMath::Abs(Components[Index]) > FMath::Abs(Components[Largest]))
+		{
+			Largest = Index;
+		}
+	}
+
+	const float Sign = (Components[Largest] < 0.0f) ? -1.0f : 1.0f;
+	const float MaxValue = (float)((1 << XIMMERSE_PACKET_ROTATION_BITS) - 1);
+
+	uint32 Packed = (uint32)Largest;
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		if (Index != Largest)
+		{
+			const float Normalized = FMath::Clamp((Components[Index] * Sign * PACKET_SQRT2 + 1.0f) * 0.5f, 0.0f, 1.0f);
+			Packed = (Packed << XIMMERSE_PACKET_ROTATION_BITS) | (uint32)FMath::RoundToInt(Normalized * MaxValue);
+		}
+	}
+	return Packed;
+}
+
+static void DequantizeRotation(uint32 Packed, float* OutRotation)
+{
+	const uint32 Mask = (1u << XIMMERSE_PACKET_ROTATION_BITS) - 1;
+	const float MaxValue = (float)Mask;
+	const int32 Largest = (int32)(Packed >> (3 * XIMMERSE_PACKET_ROTATION_BITS)) & 3;
+
+	// the first component written is in the highest bits
+	int32 Shift = 2 * XIMMERSE_PACKET_ROTATION_BITS;
+	float SumSquares = 0.0f;
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		if (Index != Largest)
+		{
+			const float Normalized = (float)((Packed >> Shift) & Mask) / MaxValue;
+			OutRotation[Index] = (Normalized * 2.0f - 1.0f) / PACKET_SQRT2;
+			SumSquares += OutRotation[Index] * OutRotation[Index];
+			Shift -= XIMMERSE_PACKET_ROTATION_BITS;
+		}
+	}
+	OutRotation[Largest] = FMath::Sqrt(FMath::Max(1.0f - SumSquares, 0.0f));
+}
+
+static void QuantizeSample(int32 TrackingResult, const ControllerState& State, FXimmerseQuantizedSample& OutSample)
+{
+	const int32 PositionLimit = 1 << (XIMMERSE_PACKET_POSITION_BITS - 1);
+
+	OutSample.Timestamp = State.timestamp;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		OutSample.Position[Axis] = FMath::Clamp(FMath::RoundToInt(State.position[Axis] * XIMMERSE_PACKET_POSITION_SCALE), -PositionLimit, PositionLimit - 1);
+	}
+	OutSample.Rotation = QuantizeRotation(State.rotation);
+
+	OutSample.Buttons = 0;
+	for (int32 Button = 0; Button < PACKET_BUTTON_BITS; ++Button)
+	{
+		if (State.buttons & PacketButtons[Button])
+		{
+			OutSample.Buttons |= 1 << Button;
+		}
+	}
+
+	OutSample.TrackingResult = (uint8)(TrackingResult & ((1 << PACKET_TRACKING_BITS) - 1));
+
+	// the pad axes are symmetric so a thumb at the center decodes as exactly 0
+	OutSample.Axes[0] = (uint8)FMath::RoundToInt(FMath::Clamp(State.axes[PacketAxes[0]], 0.0f, 1.0f) * 255.0f);
+	OutSample.Axes[1] = (uint8)(FMath::RoundToInt(FMath::Clamp(State.axes[PacketAxes[1]], -1.0f, 1.0f) * 127.0f) + 128);
+	OutSample.Axes[2] = (uint8)(FMath::RoundToInt(FMath::Clamp(State.axes[PacketAxes[2]], -1.0f, 1.0f) * 127.0f) + 128);
+}
+
+static void DequantizeSample(const FXimmerseQuantizedSample& Sample, ControllerState& OutState)
+{
+	FMemory::Memzero(OutState);
+	OutState.timestamp = Sample.Timestamp;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		OutState.position[Axis] = (float)Sample.Position[Axis] / XIMMERSE_PACKET_POSITION_SCALE;
+	}
+	DequantizeRotation(Sample.Rotation, OutState.rotation);
+
+	for (int32 Button = 0; Button < PACKET_BUTTON_BITS; ++Button)
+	{
+		if (Sample.Buttons & (1 << Button))
+		{
+			OutState.buttons |= PacketButtons[Button];
+		}
+	}
+
+	OutState.axes[PacketAxes[0]] = (float)Sample.Axes[0] / 255.0f;
+	OutState.axes[PacketAxes[1]] = (float)((int32)Sample.Axes[1] - 128) / 127.0f;
+	OutState.axes[PacketAxes[2]] = (float)((int32)Sample.Axes[2] - 128) / 127.0f;
+}
+
+//
+// Samples
+//
+
+static void WriteSample(FBitWriter& Writer, const FXimmerseQuantizedSample& Sample, const FXimmerseQuantizedSample* Baseline)
+{
+	if (Baseline == nullptr)
+	{
+		WriteSigned(Writer, Sample.Timestamp, PACKET_TIMESTAMP_BITS);
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			WriteSigned(Writer, Sample.Position[Axis], XIMMERSE_PACKET_POSITION_BITS);
+		}
+		WriteUnsigned(Writer, Sample.Rotation, 2 + 3 * XIMMERSE_PACKET_ROTATION_BITS);
+		WriteUnsigned(Writer, Sample.Buttons, PACKET_BUTTON_BITS);
+		WriteUnsigned(Writer, Sample.TrackingResult, PACKET_TRACKING_BITS);
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			WriteUnsigned(Writer, Sample.Axes[Axis], PACKET_AXIS_BITS);
+		}
+		return;
+	}
+
+	WriteDelta(Writer, Sample.Timestamp, Baseline->Timestamp, PACKET_TIMESTAMP_DELTA_BITS, PACKET_TIMESTAMP_BITS);
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		WriteDelta(Writer, Sample.Position[Axis], Baseline->Position[Axis], PACKET_POSITION_DELTA_BITS, XIMMERSE_PACKET_POSITION_BITS);
+	}
+	WriteChanged(Writer, Sample.Rotation, Baseline->Rotation, 2 + 3 * XIMMERSE_PACKET_ROTATION_BITS);
+	WriteChanged(Writer, Sample.Buttons, Baseline->Buttons, PACKET_BUTTON_BITS);
+	WriteChanged(Writer, Sample.TrackingResult, Baseline->TrackingResult, PACKET_TRACKING_BITS);
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		WriteChanged(Writer, Sample.Axes[Axis], Baseline->Axes[Axis], PACKET_AXIS_BITS);
+	}
+}
+
+static void ReadSample(FBitReader& Reader, FXimmerseQuantizedSample& OutSample, const FXimmerseQuantizedSample* Baseline)
+{
+	if (Baseline == nullptr)
+	{
+		OutSample.Timestamp = ReadSigned(Reader, PACKET_TIMESTAMP_BITS);
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			OutSample.Position[Axis] = ReadSigned(Reader, XIMMERSE_PACKET_POSITION_BITS);
+		}
+		OutSample.Rotation = ReadUnsigned(Reader, 2 + 3 * XIMMERSE_PACKET_ROTATION_BITS);
+		OutSample.Buttons = (uint8)ReadUnsigned(Reader, PACKET_BUTTON_BITS);
+		OutSample.TrackingResult = (uint8)ReadUnsigned(Reader, PACKET_TRACKING_BITS);
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			OutSample.Axes[Axis] = (uint8)ReadUnsigned(Reader, PACKET_AXIS_BITS);
+		}
+		return;
+	}
+
+	OutSample.Timestamp = ReadDelta(Reader, Baseline->Timestamp, PACKET_TIMESTAMP_DELTA_BITS, PACKET_TIMESTAMP_BITS);
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		OutSample.Position[Axis] = ReadDelta(Reader, Baseline->Position[Axis], PACKET_POSITION_DELTA_BITS, XIMMERSE_PACKET_POSITION_BITS);
+	}
+	OutSample.Rotation = ReadChanged(Reader, Baseline->Rotation, 2 + 3 * XIMMERSE_PACKET_ROTATION_BITS);
+	OutSample.Buttons = (uint8)ReadChanged(Reader, Baseline->Buttons, PACKET_BUTTON_BITS);
+	OutSample.TrackingResult = (uint8)ReadChanged(Reader, Baseline->TrackingResult, PACKET_TRACKING_BITS);
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		OutSample.Axes[Axis] = (uint8)ReadChanged(Reader, Baseline->Axes[Axis], PACKET_AXIS_BITS);
+	}
+}
+
+//
+// Encoder
+//
+
+FXimmersePacketEncoder::FXimmersePacketEncoder()
+{
+	Reset();
+}
+
+void FXimmersePacketEncoder::SetSample(int32 DeviceIndex, int32 TrackingResult, const ControllerState& State)
+{
+	if (DeviceIndex >= 0 && DeviceIndex < XIMMERSE_PACKET_MAX_CONTROLLERS)
+	{
+		QuantizeSample(TrackingResult, State, Current.Samples[DeviceIndex]);
+		Current.ControllerMask |= 1 << DeviceIndex;
+	}
+}
+
+void FXimmersePacketEncoder::ClearSample(int32 DeviceIndex)
+{
+	if (DeviceIndex >= 0 && DeviceIndex < XIMMERSE_PACKET_MAX_CONTROLLERS)
+	{
+		Current.ControllerMask &= ~(1 << DeviceIndex);
+	}
+}
+
+uint16 FXimmersePacketEncoder::WritePacket(FBitWriter& Writer)
+{
+	const uint16 Sequence = Current.Sequence;
+
+	// the newest acknowledged packet is the baseline, unless the receiver may have forgotten it by now
+	const FXimmerseQuantizedPacket* Baseline = nullptr;
+	uint16 BaselineAge = 0;
+	if (BaselineSequence != INDEX_NONE)
+	{
+		const FXimmerseQuantizedPacket& Candidate = History[BaselineSequence % XIMMERSE_PACKET_HISTORY];
+		BaselineAge = Sequence - (uint16)BaselineSequence;
+		if (BaselineAge > 0 && BaselineAge < XIMMERSE_PACKET_HISTORY && Candidate.bValid && Candidate.Sequence == (uint16)BaselineSequence)
+		{
+			Baseline = &Candidate;
+		}
+		else
+		{
+			BaselineSequence = INDEX_NONE;
+		}
+	}
+
+	WriteUnsigned(Writer, Sequence, PACKET_SEQUENCE_BITS);
+	Writer.WriteBit(Baseline != nullptr);
+	if (Baseline != nullptr)
+	{
+		WriteUnsigned(Writer, BaselineAge, PACKET_BASELINE_AGE_BITS);
+	}
+	WriteUnsigned(Writer, Current.ControllerMask, XIMMERSE_PACKET_MAX_CONTROLLERS);
+
+	for (int32 DeviceIndex = 0; DeviceIndex < XIMMERSE_PACKET_MAX_CONTROLLERS; ++DeviceIndex)
+	{
+		if (Current.ControllerMask & (1 << DeviceIndex))
+		{
+			// a controller the baseline did not have yet is sent whole
+			const bool bHasBaseline = Baseline != nullptr && (Baseline->ControllerMask & (1 << DeviceIndex)) != 0;
+			WriteSample(Writer, Current.Samples[DeviceIndex], bHasBaseline ? &Baseline->Samples[DeviceIndex] : nullptr);
+		}
+	}
+
+	FXimmerseQuantizedPacket& Sent = History[Sequence % XIMMERSE_PACKET_HISTORY];
+	Sent = Current;
+	Sent.bValid = true;
+
+	Current.Sequence = Sequence + 1;
+	return Sequence;
+}
+
+void FXimmersePacketEncoder::Acknowledge(uint16 Sequence)
+{
+	const FXimmerseQuantizedPacket& Packet = History[Sequence % XIMMERSE_PACKET_HISTORY];
+	if (!Packet.bValid || Packet.Sequence != Sequence)
+	{
+		return;
+	}
+
+	// acknowledgments may arrive out of order, only a newer one moves the baseline
+	if (BaselineSequence == INDEX_NONE || (int16)(Sequence - (uint16)BaselineSequence) > 0)
+	{
+		BaselineSequence = Sequence;
+	}
+}
+
+void FXimmersePacketEncoder::Reset()
+{
+	FMemory::Memzero(History);
+	FMemory::Memzero(Current);
+	BaselineSequence = INDEX_NONE;
+}
+
+int32 FXimmersePacketEncoder::GetMaxPacketBits()
+{
+	const int32 HeaderBits = PACKET_SEQUENCE_BITS + 1 + PACKET_BASELINE_AGE_BITS + XIMMERSE_PACKET_MAX_CONTROLLERS;
+	const int32 SampleBits = PACKET_TIMESTAMP_BITS + 3 * XIMMERSE_PACKET_POSITION_BITS + 2 + 3 * XIMMERSE_PACKET_ROTATION_BITS + PACKET_BUTTON_BITS + PACKET_TRACKING_BITS + 3 * PACKET_AXIS_BITS;
+
+	// against a baseline, every field costs one or two flag bits on top of its whole value at worst
+	const int32 FlagBits = 2 + 3 * 2 + 1 + 1 + 1 + 3 * 1;
+	return HeaderBits + XIMMERSE_PACKET_MAX_CONTROLLERS * (SampleBits + FlagBits);
+}
+
+//
+// Decoder
+//
+
+FXimmersePacketDecoder::FXimmersePacketDecoder()
+{
+	Reset();
+}
+
+bool FXimmersePacketDecoder::ReadPacket(FBitReader& Reader, FXimmerseDecodedPacket& OutPacket)
+{
+	const uint16 Sequence = (uint16)ReadUnsigned(Reader, PACKET_SEQUENCE_BITS);
+	const bool bHasBaseline = Reader.ReadBit() != 0;
+	const uint16 BaselineAge = bHasBaseline ? (uint16)ReadUnsigned(Reader, PACKET_BASELINE_AGE_BITS) : 0;
+	const uint8 ControllerMask = (uint8)ReadUnsigned(Reader, XIMMERSE_PACKET_MAX_CONTROLLERS);
+
+	if (Reader.IsError())
+	{
+		return false;
+	}
+
+	if (LastSequence != INDEX_NONE && (int16)(Sequence - (uint16)LastSequence) <= 0)
+	{
+		return false;
+	}
+
+	const FXimmerseQuantizedPacket* Baseline = nullptr;
+	if (bHasBaseline)
+	{
+		const uint16 BaselineSequence = Sequence - BaselineAge;
+		const FXimmerseQuantizedPacket& Candidate = History[BaselineSequence % XIMMERSE_PACKET_HISTORY];
+		if (BaselineAge == 0 || !Candidate.bValid || Candidate.Sequence != BaselineSequence)
+		{
+			return false;
+		}
+		Baseline = &Candidate;
+	}
+
+	FXimmerseQuantizedPacket Packet;
+	Packet.Sequence = Sequence;
+	Packet.bValid = true;
+	Packet.ControllerMask = ControllerMask;
+
+	for (int32 DeviceIndex = 0; DeviceIndex < XIMMERSE_PACKET_MAX_CONTROLLERS; ++DeviceIndex)
+	{
+		if (ControllerMask & (1 << DeviceIndex))
+		{
+			const bool bHasControllerBaseline = Baseline != nullptr && (Baseline->ControllerMask & (1 << DeviceIndex)) != 0;
+			ReadSample(Reader, Packet.Samples[DeviceIndex], bHasControllerBaseline ? &Baseline->Samples[DeviceIndex] : nullptr);
+		}
+	}
+
+	if (Reader.IsError())
+	{
+		return false;
+	}
+
+	History[Sequence % XIMMERSE_PACKET_HISTORY] = Packet;
+	LastSequence = Sequence;
+
+	OutPacket.Sequence = Sequence;
+	OutPacket.NumSamples = 0;
+	for (int32 DeviceIndex = 0; DeviceIndex < XIMMERSE_PACKET_MAX_CONTROLLERS; ++DeviceIndex)
+	{
+		if ((ControllerMask & (1 << DeviceIndex)) == 0)
+		{
+			// a controller that comes back reports its held buttons as pressed again
+			LastButtons[DeviceIndex] = 0;
+			continue;
+		}
+
+		const FXimmerseQuantizedSample& Sample = Packet.Samples[DeviceIndex];
+		FXimmerseDecodedSample& Decoded = OutPacket.Samples[OutPacket.NumSamples++];
+		Decoded.DeviceIndex = DeviceIndex;
+		Decoded.TrackingResult = Sample.TrackingResult;
+		DequantizeSample(Sample, Decoded.State);
+		Decoded.Pose = XimmerseToUnrealPose(Decoded.State);
+
+		Decoded.PressedButtons = Decoded.State.buttons & ~LastButtons[DeviceIndex];
+		Decoded.ReleasedButtons = LastButtons[DeviceIndex] & ~Decoded.State.buttons;
+		LastButtons[DeviceIndex] = Decoded.State.buttons;
+	}
+
+	return true;
+}
+
+void FXimmersePacketDecoder::Reset()
+{
+	FMemory::Memzero(History);
+	FMemory::Memzero(LastButtons);
+	LastSequence = INDEX_NONE;
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,149 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "XimmersePose.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Controller slots a packet can carry */
+#define XIMMERSE_PACKET_MAX_CONTROLLERS		8
+
+/** Packets each side remembers, a baseline older than this is no longer usable */
+#define XIMMERSE_PACKET_HISTORY				32
+
+/** Positions are fixed point with this many units per meter, in this many bits, about +-32 m at half a millimeter */
+#define XIMMERSE_PACKET_POSITION_SCALE		2000.0f
+#define XIMMERSE_PACKET_POSITION_BITS		17
+
+/** Bits of each of the three smallest quaternion components, two more name the largest */
+#define XIMMERSE_PACKET_ROTATION_BITS		10
+
+class FBitWriter;
+class FBitReader;
+
+/** One controller sample reduced to what is replicated, every field quantized */
+struct FXimmerseQuantizedSample
+{
+	/** SDK timestamp in milliseconds */
+	int32 Timestamp;
+
+	/** Position relative to the tracker, in 1 / XIMMERSE_PACKET_POSITION_SCALE meters */
+	int32 Position[3];
+
+	/** Smallest three: the index of the largest component, then the other three, see QuantizeRotation */
+	uint32 Rotation;
+
+	/** One bit per entry of the codec's button table */
+	uint8 Buttons;
+
+	/** TrackingResult flags */
+	uint8 TrackingResult;
+
+	/** Trigger from 0 to 255, touchpad X and Y from 1 to 255 with 128 at the center */
+	uint8 Axes[3];
+};
+
+/** The samples of one packet, as both sides remember it */
+struct FXimmerseQuantizedPacket
+{
+	uint16 Sequence;
+	bool bValid;
+
+	/** Bit per controller slot present in the packet */
+	uint8 ControllerMask;
+
+	FXimmerseQuantizedSample Samples[XIMMERSE_PACKET_MAX_CONTROLLERS];
+};
+
+/** One controller of a decoded packet */
+struct FXimmerseDecodedSample
+{
+	int32 DeviceIndex;
+	int32 TrackingResult;
+
+	/** The sample as the SDK would have returned it, within the quantization error. The IMU fields are zero. */
+	ControllerState State;
+
+	/** The pose in Unreal space, without derivatives */
+	FXimmersePose Pose;
+
+	/** SDK button bits that went down and up since the previous packet of this controller */
+	uint32 PressedButtons;
+	uint32 ReleasedButtons;
+};
+
+struct FXimmerseDecodedPacket
+{
+	uint16 Sequence;
+	int32 NumSamples;
+	FXimmerseDecodedSample Samples[XIMMERSE_PACKET_MAX_CONTROLLERS];
+};
+
+/**
+* Encodes the newest sample of every controller into a compact packet for replication and spectators.
+* Rotations use smallest-three compression, positions are fixed point and buttons a bit mask. Once the
+* receiver acknowledged a packet, later packets only carry what changed since then, with small position
+* changes in fewer bits. Lost packets never break decoding: only acknowledged packets become baselines.
+* Memory is fixed, nothing is allocated after construction.
+*/
+class FXimmersePacketEncoder
+{
+public:
+	FXimmersePacketEncoder();
+
+	/** Quantizes the newest sample of a controller slot, the next packet carries it */
+	void SetSample(int32 DeviceIndex, int32 TrackingResult, const ControllerState& State);
+
+	/** Leaves a controller out of the next packets, receivers take its absence for a disconnect */
+	void ClearSample(int32 DeviceIndex);
+
+	/** Writes a packet with the newest sample of every controller and returns its sequence number */
+	uint16 WritePacket(FBitWriter& Writer);
+
+	/** The receiver got a packet, it may serve as a baseline from now on */
+	void Acknowledge(uint16 Sequence);
+
+	/** Forgets every sample and baseline, for a new connection */
+	void Reset();
+
+	/** Largest packet possible, to size the FBitWriter */
+	static int32 GetMaxPacketBits();
+
+private:
+	/** Packets sent, indexed by sequence modulo the history size */
+	FXimmerseQuantizedPacket History[XIMMERSE_PACKET_HISTORY];
+
+	/** What the next packet sends */
+	FXimmerseQuantizedPacket Current;
+
+	/** Newest acknowledged packet still in the history, INDEX_NONE before the first acknowledgment */
+	int32 BaselineSequence;
+};
+
+/** Reads packets written by FXimmersePacketEncoder and turns them back into samples, poses and button edges */
+class FXimmersePacketDecoder
+{
+public:
+	FXimmersePacketDecoder();
+
+	/**
+	* Decodes one packet. Returns false if it is malformed, its baseline was forgotten, or it is older than
+	* the last one decoded; reordered packets are dropped, not replayed. Acknowledge the packet to the encoder
+	* when this returns true.
+	*/
+	bool ReadPacket(FBitReader& Reader, FXimmerseDecodedPacket& OutPacket);
+
+	/** Forgets every packet received, for a new connection */
+	void Reset();
+
+private:
+	FXimmerseQuantizedPacket History[XIMMERSE_PACKET_HISTORY];
+
+	/** Newest packet decoded, INDEX_NONE before the first */
+	int32 LastSequence;
+
+	/** SDK button bits of every controller in the newest packet, to report edges */
+	uint32 LastButtons[XIMMERSE_PACKET_MAX_CONTROLLERS];
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
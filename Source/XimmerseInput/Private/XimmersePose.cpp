@@ -0,0 +1,173 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmersePose.h"
+
+/** Weight of the newest finite difference in the smoothed velocity */
+#define VELOCITY_SMOOTHING	0.5f
+
+FXimmersePose FXimmersePose::Predict(double TargetTime, float MaxPredictionTime) const
+{
+	const float DeltaTime = FMath::Clamp((float)(TargetTime - GetTime()), 0.0f, MaxPredictionTime);
+
+	FXimmersePose Predicted = *this;
+	Predicted.SampleTime = SampleTime + DeltaTime;
+	Predicted.DeviceTime = (DeviceTime > 0.0) ? DeviceTime + DeltaTime : 0.0;
+	Predicted.Position += (LinearVelocity + LinearAcceleration * (0.5f * DeltaTime)) * DeltaTime;
+	Predicted.LinearVelocity += LinearAcceleration * DeltaTime;
+
+	// the gyroscope measures in the controller's frame, so the rotation delta is applied on the right
+	const float AngularSpeed = AngularVelocity.Size();
+	if (AngularSpeed > KINDA_SMALL_NUMBER)
+	{
+		const FQuat DeltaRotation(AngularVelocity / AngularSpeed, AngularSpeed * DeltaTime);
+		Predicted.Orientation = Orientation * DeltaRotation;
+		Predicted.Orientation.Normalize();
+	}
+
+	return Predicted;
+}
+
+FXimmersePose FXimmersePose::Interpolate(const FXimmersePose& Before, const FXimmersePose& After, double Time)
+{
+	const double Interval = After.GetTime() - Before.GetTime();
+	const float Alpha = (Interval > 0.0) ? FMath::Clamp((float)((Time - Before.GetTime()) / Interval), 0.0f, 1.0f) : 0.0f;
+
+	FXimmersePose Pose;
+	Pose.Position = FMath::Lerp(Before.Position, After.Position, Alpha);
+	Pose.Orientation = FQuat::Slerp(Before.Orientation, After.Orientation, Alpha);
+	Pose.LinearVelocity = FMath::Lerp(Before.LinearVelocity, After.LinearVelocity, Alpha);
+	Pose.LinearAcceleration = FMath::Lerp(Before.LinearAcceleration, After.LinearAcceleration, Alpha);
+	Pose.AngularVelocity = FMath::Lerp(Before.AngularVelocity, After.AngularVelocity, Alpha);
+	Pose.SampleTime = FMath::Lerp(Before.SampleTime, After.SampleTime, (double)Alpha);
+	Pose.DeviceTime = (Before.DeviceTime > 0.0 && After.DeviceTime > 0.0) ? FMath::Lerp(Before.DeviceTime, After.DeviceTime, (double)Alpha) : 0.0;
+	return Pose;
+}
+
+void FXimmersePoseHistory::Add(const FXimmersePose& Pose)
+{
+	Poses[(uint32)NumWrites & (XIMMERSE_POSE_HISTORY_SIZE - 1)] = Pose;
+
+	// the interlocked increment publishes the pose before the count that makes it visible
+	FPlatformAtomics::InterlockedIncrement(&NumWrites);
+}
+
+bool FXimmersePoseHistory::Sample(double Time, float MaxPredictionTime, FXimmersePose& OutPose) const
+{
+	const uint32 Mask = XIMMERSE_POSE_HISTORY_SIZE - 1;
+	for (;;)
+	{
+		const int32 Published = NumWrites;
+		FPlatformMisc::MemoryBarrier();
+
+		if (Published == 0)
+		{
+			return false;
+		}
+
+		// the slot the next write goes to is left out, a write in progress never touches the poses searched
+		const int32 First = Published - FMath::Min(Published, XIMMERSE_POSE_HISTORY_SIZE - 1);
+		const int32 Last = Published - 1;
+
+		bool bFound = true;
+		const FXimmersePose& Newest = Poses[(uint32)Last & Mask];
+		if (Time >= Newest.GetTime())
+		{
+			OutPose = Newest.Predict(Time, MaxPredictionTime);
+		}
+		else if (Time < Poses[(uint32)First & Mask].GetTime())
+		{
+			bFound = false;
+		}
+		else
+		{
+			// Poses[Low] is at or before Time, Poses[High] after it
+			int32 Low = First;
+			int32 High = Last;
+			while (High - Low > 1)
+			{
+				const int32 Middle = Low + (High - Low) / 2;
+				if (Poses[(uint32)Middle & Mask].GetTime() <= Time)
+				{
+					Low = Middle;
+				}
+				else
+				{
+					High = Middle;
+				}
+			}
+			OutPose = FXimmersePose::Interpolate(Poses[(uint32)Low & Mask], Poses[(uint32)High & Mask], Time);
+		}
+
+		// a write that completed meanwhile may have started the next one, over the oldest pose searched
+		FPlatformMisc::MemoryBarrier();
+		if (NumWrites == Published)
+		{
+			return bFound;
+		}
+	}
+}
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+void FXimmersePoseStream::Publish(const ControllerState& XControllerState, int32 TrackingResult, double SampleTime, double DeviceTime)
+{
+	FXimmersePose Pose = XimmerseToUnrealPose(XControllerState);
+	Pose.SampleTime = SampleTime;
+	Pose.DeviceTime = DeviceTime;
+
+	// the device's stamps space the samples as they were taken, the poll's as they happened to be read
+	const double DeltaTime = Pose.GetTime() - PreviousPose.GetTime();
+
+	// angular velocity is an axial vector, it changes handedness like the quaternion's imaginary part
+	const FVector Gyroscope(XControllerState.gyroscope[2], -XControllerState.gyroscope[0], -XControllerState.gyroscope[1]);
+	const FVector SpecificForce(-XControllerState.accelerometer[2], XControllerState.accelerometer[0], XControllerState.accelerometer[1]);
+	Pose.AngularVelocity = Gyroscope;
+
+	// the fused orientation replaces the SDK's before anything is filtered or derived from it
+	const FXimmerseImuFusionSettings FusionSettings = FXimmerseImuFusionSettings::Get();
+	if (FusionSettings.bEnabled)
+	{
+		const bool bRotationTracked = (TrackingResult & kTrackingResult_RotationTracked) != 0;
+		Pose.Orientation = ImuFusion.Update(Gyroscope, SpecificForce, Pose.Orientation, bRotationTracked, bHasPreviousSample ? (float)DeltaTime : 0.0f, FusionSettings);
+		Pose.AngularVelocity = ImuFusion.GetAngularVelocity(Gyroscope);
+	}
+	else
+	{
+		ImuFusion.Reset();
+	}
+
+	// everything below is derived from the filtered pose, so the derivatives are smooth as well
+	const FXimmerseFilterSettings FilterSettings = FXimmerseFilterSettings::Get();
+	if (FilterSettings.bEnabled)
+	{
+		Filter.Filter(Pose.Position, Pose.Orientation, bHasPreviousSample ? (float)DeltaTime : 0.0f, FilterSettings);
+	}
+	else
+	{
+		Filter.Reset();
+	}
+
+	// rotate the specific force into Unreal space and remove gravity to get the linear acceleration,
+	// devices without an accelerometer report zeros and are extrapolated with constant velocity
+	if (!SpecificForce.IsZero())
+	{
+		Pose.LinearAcceleration = Pose.Orientation.RotateVector(SpecificForce) * XIMMERSE_GRAVITY - FVector(0.0f, 0.0f, XIMMERSE_GRAVITY);
+	}
+
+	if (bHasPreviousSample && DeltaTime > SMALL_NUMBER)
+	{
+		const FVector Velocity = (Pose.Position - PreviousPose.Position) / (float)DeltaTime;
+		Pose.LinearVelocity = FMath::Lerp(PreviousPose.LinearVelocity, Velocity, VELOCITY_SMOOTHING);
+	}
+	else
+	{
+		Pose.LinearVelocity = PreviousPose.LinearVelocity;
+	}
+
+	Snapshot.Write(Pose);
+	History.Add(Pose);
+
+	PreviousPose = Pose;
+	bHasPreviousSample = true;
+}
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
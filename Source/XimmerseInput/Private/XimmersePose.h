@@ -0,0 +1,179 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "XimmerseSeqLock.h"
+#include "XimmerseFilter.h"
+#include "XimmerseImuFusion.h"
+
+/** Standard gravity in cm/s^2, the accelerometer reports specific force in g */
+#define XIMMERSE_GRAVITY	980.665f
+
+/** Controller pose in Unreal space, as shared between the sampling thread and its readers */
+struct FXimmersePose
+{
+	FVector Position;
+	FQuat Orientation;
+
+	/** Estimated linear velocity in cm/s and acceleration in cm/s^2, in Unreal space */
+	FVector LinearVelocity;
+	FVector LinearAcceleration;
+
+	/** Angular velocity in rad/s, in the controller's local space */
+	FVector AngularVelocity;
+
+	/** FPlatformTime::Seconds() at which the sample was taken */
+	double SampleTime;
+
+	/** FPlatformTime::Seconds() at which the device stamped the sample, 0 if unknown */
+	double DeviceTime;
+
+	FXimmersePose()
+		: Position(FVector::ZeroVector)
+		, Orientation(FQuat::Identity)
+		, LinearVelocity(FVector::ZeroVector)
+		, LinearAcceleration(FVector::ZeroVector)
+		, AngularVelocity(FVector::ZeroVector)
+		, SampleTime(0.0)
+		, DeviceTime(0.0)
+	{
+	}
+
+	/**
+	* FPlatformTime::Seconds() the pose belongs to: when the device stamped it if known, when it was sampled otherwise.
+	* Poses are ordered, interpolated and extrapolated on this time.
+	*/
+	double GetTime() const
+	{
+		return (DeviceTime > 0.0) ? DeviceTime : SampleTime;
+	}
+
+	/**
+	* Extrapolates the pose to TargetTime, integrating the angular velocity on the orientation and
+	* the velocity and acceleration on the position. The horizon is clamped to MaxPredictionTime.
+	*/
+	FXimmersePose Predict(double TargetTime, float MaxPredictionTime) const;
+
+	/** The pose at Time between two samples, positions and velocities lerped and orientations slerped */
+	static FXimmersePose Interpolate(const FXimmersePose& Before, const FXimmersePose& After, double Time);
+};
+
+/** Newest pose of a device, written once per fresh sample and readable from the render thread */
+typedef TXimmerseSeqLock<FXimmersePose> FXimmersePoseSnapshot;
+
+/** Poses a device keeps for lookups by time, half a second at the poll thread's 1 kHz. Must be a power of two. */
+#define XIMMERSE_POSE_HISTORY_SIZE	512
+
+/**
+* Ring of a device's newest poses, ordered by GetTime(), so poses at past timestamps need no SDK query.
+* Lookups are a binary search. Only one thread may add at a time; any thread may sample, retrying if
+* the writer overwrote the poses it searched meanwhile, the way a seqlock would.
+*/
+class FXimmersePoseHistory
+{
+public:
+	FXimmersePoseHistory()
+		: NumWrites(0)
+	{
+	}
+
+	/** Appends a pose, its GetTime() must not be older than the previous one's */
+	void Add(const FXimmersePose& Pose);
+
+	/**
+	* The pose at Time, interpolated between the two poses around it, or extrapolated from the newest pose by at most
+	* MaxPredictionTime. Returns false if Time is older than the oldest pose kept, or if nothing was added yet.
+	*/
+	bool Sample(double Time, float MaxPredictionTime, FXimmersePose& OutPose) const;
+
+	/** Poses that can be sampled */
+	int32 Num() const
+	{
+		return FMath::Min(NumWrites, XIMMERSE_POSE_HISTORY_SIZE - 1);
+	}
+
+private:
+	static_assert((XIMMERSE_POSE_HISTORY_SIZE & (XIMMERSE_POSE_HISTORY_SIZE - 1)) == 0, "XIMMERSE_POSE_HISTORY_SIZE must be a power of two");
+
+	FXimmersePose Poses[XIMMERSE_POSE_HISTORY_SIZE];
+
+	/** Poses added so far, the next one goes to NumWrites modulo the size */
+	volatile int32 NumWrites;
+};
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Converts the SDK's right-handed meters into Unreal's left-handed centimeters */
+inline FXimmersePose XimmerseToUnrealPose(const ControllerState& XControllerState)
+{
+	FXimmersePose Pose;
+	Pose.Position.X = -XControllerState.position[2] * 100;
+	Pose.Position.Y = XControllerState.position[0] * 100;
+	Pose.Position.Z = XControllerState.position[1] * 100;
+	Pose.Orientation.X = XControllerState.rotation[2];
+	Pose.Orientation.Y = -XControllerState.rotation[0];
+	Pose.Orientation.Z = -XControllerState.rotation[1];
+	Pose.Orientation.W = XControllerState.rotation[3];
+	return Pose;
+}
+
+/**
+* Pose snapshot of one device plus the motion estimate needed to fill its derivatives.
+* Only one thread may publish at a time; any thread may read.
+*/
+class FXimmersePoseStream
+{
+public:
+	FXimmersePoseStream()
+		: bHasPreviousSample(false)
+	{
+	}
+
+	/**
+	* Converts a fresh sample, estimates its derivatives and publishes it. TrackingResult is the device's, it tells
+	* the IMU fusion whether to trust the sample's orientation. DeviceTime is 0 if unknown, the pose is then timed
+	* by SampleTime.
+	*/
+	void Publish(const ControllerState& XControllerState, int32 TrackingResult, double SampleTime, double DeviceTime = 0.0);
+
+	/** Newest published pose */
+	FXimmersePose Read() const
+	{
+		return Snapshot.Read();
+	}
+
+	/** Number of poses published so far */
+	int32 GetNumPublished() const
+	{
+		return Snapshot.GetNumWrites();
+	}
+
+	/** Published pose at a past or future time, see FXimmersePoseHistory::Sample */
+	bool ReadAtTime(double Time, float MaxPredictionTime, FXimmersePose& OutPose) const
+	{
+		return History.Sample(Time, MaxPredictionTime, OutPose);
+	}
+
+private:
+	FXimmersePoseSnapshot Snapshot;
+
+	/** Keeps the writer's bookkeeping off the lines the render thread reads the snapshot from */
+	uint8 SnapshotPadding[PLATFORM_CACHE_LINE_SIZE];
+
+	/** Writer-side state, the previous sample is only used to difference the positions */
+	FXimmersePose PreviousPose;
+	bool bHasPreviousSample;
+
+	/** Smooths the raw poses while ximmerse.Filter is on, writer-side */
+	FXimmerseOneEuroFilter Filter;
+
+	/** Integrates the IMU into the orientation while ximmerse.ImuFusion is on, writer-side */
+	FXimmerseImuFusion ImuFusion;
+
+	/** Keeps the history's write position off the writer-side lines */
+	uint8 HistoryPadding[PLATFORM_CACHE_LINE_SIZE];
+
+	/** Every published pose, readable from any thread */
+	FXimmersePoseHistory History;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,76 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseSdkInit.h"
+#include "XimmerseSdkStats.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+FThreadSafeBool FXimmerseSdkInit::bReady;
+
+FXimmerseSdkInit::FXimmerseSdkInit()
+	: RequestTime(FPlatformTime::Seconds())
+	, Thread(nullptr)
+{
+	Thread = FRunnableThread::Create(this, TEXT("XimmerseSdkInit"), 0, TPri_BelowNormal);
+}
+
+FXimmerseSdkInit::~FXimmerseSdkInit()
+{
+	if (Thread != nullptr)
+	{
+		const double JoinStartTime = FPlatformTime::Seconds();
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+
+		UE_LOG(LogXimmerseInput, Log, TEXT("Ximmerse SDK initialization joined in %.2f ms"), (FPlatformTime::Seconds() - JoinStartTime) * 1000.0);
+	}
+
+	bReady = false;
+	if (bInitialized)
+	{
+		XIMMERSE_SDK_CALL(Exit, -1, XDeviceExit());
+		bInitialized = false;
+	}
+}
+
+uint32 FXimmerseSdkInit::Run()
+{
+#if !UE_BUILD_SHIPPING
+	// -XimmerseInitDelay=<seconds> stands in for slow driver enumeration, to measure what startup no longer waits for
+	float InitDelay = 0.0f;
+	if (FParse::Value(FCommandLine::Get(), TEXT("XimmerseInitDelay="), InitDelay))
+	{
+		const double DelayEndTime = FPlatformTime::Seconds() + InitDelay;
+		while (!bStopRequested && FPlatformTime::Seconds() < DelayEndTime)
+		{
+			FPlatformProcess::Sleep(0.01f);
+		}
+	}
+#endif // !UE_BUILD_SHIPPING
+
+	// the SDK call itself cannot be interrupted, only skipped
+	if (bStopRequested)
+	{
+		return 0;
+	}
+
+	const double InitStartTime = FPlatformTime::Seconds();
+	const int32 Result = XIMMERSE_SDK_CALL(Init, -1, XDeviceInit());
+	const double InitEndTime = FPlatformTime::Seconds();
+
+	bInitialized = true;
+	bReady = true;
+
+	UE_LOG(LogXimmerseInput, Log, TEXT("Ximmerse SDK initialized in %.1f ms on a background thread, %.1f ms after the module started (XDeviceInit returned %d)"),
+		(InitEndTime - InitStartTime) * 1000.0, (InitEndTime - RequestTime) * 1000.0, Result);
+	return 0;
+}
+
+void FXimmerseSdkInit::Stop()
+{
+	bStopRequested = true;
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
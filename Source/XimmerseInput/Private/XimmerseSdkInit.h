@@ -0,0 +1,42 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/**
+* Runs XDeviceInit on a background thread. It enumerates the device drivers and may take seconds, with or
+* without controllers attached, so module startup no longer waits for it. Nothing may call the SDK before
+* IsReady() returns true; the input device reports no controllers until then.
+*/
+class FXimmerseSdkInit : public FRunnable
+{
+public:
+	FXimmerseSdkInit();
+
+	/** Cancels an initialization that has not started yet, waits for one in progress, then shuts the SDK down */
+	virtual ~FXimmerseSdkInit();
+
+	/** True once XDeviceInit has returned, until the SDK is shut down */
+	static bool IsReady()
+	{
+		return bReady;
+	}
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	static FThreadSafeBool bReady;
+
+	/** XDeviceInit was called and needs a matching XDeviceExit */
+	FThreadSafeBool bInitialized;
+
+	/** Time the module asked for the SDK, startup time measurements are relative to it */
+	double RequestTime;
+
+	FThreadSafeBool bStopRequested;
+	FRunnableThread* Thread;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
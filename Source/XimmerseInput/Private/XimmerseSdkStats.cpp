@@ -0,0 +1,171 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseSdkStats.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+DEFINE_STAT(STAT_XimmerseSdk_Init);
+DEFINE_STAT(STAT_XimmerseSdk_Exit);
+DEFINE_STAT(STAT_XimmerseSdk_GetTickCount);
+DEFINE_STAT(STAT_XimmerseSdk_GetInputDeviceCount);
+DEFINE_STAT(STAT_XimmerseSdk_GetInputDevices);
+DEFINE_STAT(STAT_XimmerseSdk_GetInputDeviceHandle);
+DEFINE_STAT(STAT_XimmerseSdk_GetInputDeviceName);
+DEFINE_STAT(STAT_XimmerseSdk_GetInputState);
+DEFINE_STAT(STAT_XimmerseSdk_GetInt);
+DEFINE_STAT(STAT_XimmerseSdk_SetInt);
+DEFINE_STAT(STAT_XimmerseSdk_SetBool);
+DEFINE_STAT(STAT_XimmerseSdk_SetEventListener);
+DEFINE_STAT(STAT_XimmerseSdk_SendMessage);
+DEFINE_STAT(STAT_XimmerseSdk_AddExternalControllerDevice);
+DEFINE_STAT(STAT_XimmerseSdk_RemoveInputDeviceAt);
+
+static TAutoConsoleVariable<float> CVarSdkSlowCallThreshold(
+    TEXT("ximmerse.SdkSlowCallThreshold"),
+    0.0f,
+    TEXT("Milliseconds after which a call into the Ximmerse SDK is logged with the device it was about and kept for ximmerse.sdkstats.\n")
+    TEXT(" 0: slow calls are not captured (default)"),
+    ECVF_Default);
+
+/** Slow calls kept for ximmerse.sdkstats, the oldest make room for new ones */
+#define SDK_MAX_SLOW_CALLS	64
+
+namespace XimmerseSdkStats
+{
+	struct FFunctionStats
+	{
+		volatile int64 NumCalls;
+		volatile int64 Cycles;
+		FXimmerseLatencyHistogram Latency;
+	};
+
+	static FFunctionStats Functions[EXimmerseSdkFunction::Count];
+
+	/** Slow calls are rare, a lock on their path costs nothing the fast calls pay for */
+	static FCriticalSection SlowCallsLock;
+	static TArray<FXimmerseSdkSlowCall> SlowCalls;
+	static int32 NumSlowCalls = 0;
+}
+
+void FXimmerseSdkStats::Record(EXimmerseSdkFunction::Type Function, int32 Handle, uint64 Cycles)
+{
+	using namespace XimmerseSdkStats;
+
+	FFunctionStats& Stats = Functions[Function];
+	FPlatformAtomics::InterlockedIncrement(&Stats.NumCalls);
+	FPlatformAtomics::InterlockedAdd(&Stats.Cycles, (int64)Cycles);
+
+	const double Seconds = FPlatformTime::GetSecondsPerCycle64() * Cycles;
+	Stats.Latency.Record(Seconds);
+
+	const float Threshold = CVarSdkSlowCallThreshold.GetValueOnAnyThread();
+	if (Threshold <= 0.0f || Seconds * 1000.0 < Threshold)
+	{
+		return;
+	}
+
+	FXimmerseSdkSlowCall SlowCall;
+	SlowCall.Function = Function;
+	SlowCall.Handle = Handle;
+	SlowCall.ThreadId = FPlatformTLS::GetCurrentThreadId();
+	SlowCall.Seconds = Seconds;
+	SlowCall.EndTime = FPlatformTime::Seconds();
+
+	UE_LOG(LogXimmerseInput, Warning, TEXT("Slow Ximmerse SDK call: %s took %.2f ms (handle %d, thread %u)"), GetFunctionName(Function), Seconds * 1000.0, Handle, SlowCall.ThreadId);
+
+	FScopeLock Lock(&SlowCallsLock);
+	if (SlowCalls.Num() < SDK_MAX_SLOW_CALLS)
+	{
+		SlowCalls.Add(SlowCall);
+	}
+	else
+	{
+		SlowCalls[NumSlowCalls % SDK_MAX_SLOW_CALLS] = SlowCall;
+	}
+	++NumSlowCalls;
+}
+
+void FXimmerseSdkStats::Dump(FOutputDevice& Ar)
+{
+	using namespace XimmerseSdkStats;
+
+	Ar.Logf(TEXT("Ximmerse SDK calls:"));
+	for (int32 Function = 0; Function < EXimmerseSdkFunction::Count; ++Function)
+	{
+		const FFunctionStats& Stats = Functions[Function];
+		if (Stats.NumCalls == 0)
+		{
+			continue;
+		}
+
+		const double TotalSeconds = FPlatformTime::GetSecondsPerCycle64() * Stats.Cycles;
+		Ar.Logf(TEXT("  %-34s %10lld calls  %9.2f ms total  mean %8.2f us  p50 %7.2f ms  p99 %7.2f ms  p99.9 %7.2f ms  max %7.2f ms"),
+			GetFunctionName((EXimmerseSdkFunction::Type)Function),
+			Stats.NumCalls,
+			TotalSeconds * 1000.0,
+			TotalSeconds * 1000000.0 / Stats.NumCalls,
+			Stats.Latency.GetPercentile(50.0) * 1000.0,
+			Stats.Latency.GetPercentile(99.0) * 1000.0,
+			Stats.Latency.GetPercentile(99.9) * 1000.0,
+			Stats.Latency.GetMax() * 1000.0);
+	}
+
+	FScopeLock Lock(&SlowCallsLock);
+	const float Threshold = CVarSdkSlowCallThreshold.GetValueOnAnyThread();
+	if (Threshold <= 0.0f && NumSlowCalls == 0)
+	{
+		Ar.Logf(TEXT("Slow calls are not captured, set ximmerse.SdkSlowCallThreshold to a number of milliseconds"));
+		return;
+	}
+
+	Ar.Logf(TEXT("%d calls slower than %.2f ms, the last %d:"), NumSlowCalls, Threshold, SlowCalls.Num());
+	const double CurrentTime = FPlatformTime::Seconds();
+	for (int32 Index = FMath::Max(NumSlowCalls - SDK_MAX_SLOW_CALLS, 0); Index < NumSlowCalls; ++Index)
+	{
+		const FXimmerseSdkSlowCall& SlowCall = SlowCalls[Index % SDK_MAX_SLOW_CALLS];
+		Ar.Logf(TEXT("  %-34s %7.2f ms  handle %5d  thread %6u  %.1f s ago"),
+			GetFunctionName(SlowCall.Function), SlowCall.Seconds * 1000.0, SlowCall.Handle, SlowCall.ThreadId, CurrentTime - SlowCall.EndTime);
+	}
+}
+
+void FXimmerseSdkStats::Reset()
+{
+	using namespace XimmerseSdkStats;
+
+	for (FFunctionStats& Stats : Functions)
+	{
+		FPlatformAtomics::InterlockedExchange(&Stats.NumCalls, 0);
+		FPlatformAtomics::InterlockedExchange(&Stats.Cycles, 0);
+		Stats.Latency.Reset();
+	}
+
+	FScopeLock Lock(&SlowCallsLock);
+	SlowCalls.Reset();
+	NumSlowCalls = 0;
+}
+
+const TCHAR* FXimmerseSdkStats::GetFunctionName(EXimmerseSdkFunction::Type Function)
+{
+	static const TCHAR* FunctionNames[EXimmerseSdkFunction::Count] =
+	{
+		TEXT("XDeviceInit"),
+		TEXT("XDeviceExit"),
+		TEXT("XDeviceGetTickCount"),
+		TEXT("XDeviceGetInputDeviceCount"),
+		TEXT("XDeviceGetInputDevices"),
+		TEXT("XDeviceGetInputDeviceHandle"),
+		TEXT("XDeviceGetInputDeviceName"),
+		TEXT("XDeviceGetInputState"),
+		TEXT("XDeviceGetInt"),
+		TEXT("XDeviceSetInt"),
+		TEXT("XDeviceSetBool"),
+		TEXT("XDeviceSetEventListener"),
+		TEXT("XDeviceSendMessage"),
+		TEXT("XDeviceAddExternalControllerDevice"),
+		TEXT("XDeviceRemoveInputDeviceAt"),
+	};
+	return FunctionNames[Function];
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
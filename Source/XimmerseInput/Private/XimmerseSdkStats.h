@@ -0,0 +1,122 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+#include "XimmerseLatency.h"
+
+DECLARE_STATS_GROUP(TEXT("Ximmerse"), STATGROUP_Ximmerse, STATCAT_Advanced);
+
+/** Time spent in every SDK entry point the plugin calls, with call counts, in stat Ximmerse */
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceInit"), STAT_XimmerseSdk_Init, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceExit"), STAT_XimmerseSdk_Exit, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceGetTickCount"), STAT_XimmerseSdk_GetTickCount, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceGetInputDeviceCount"), STAT_XimmerseSdk_GetInputDeviceCount, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceGetInputDevices"), STAT_XimmerseSdk_GetInputDevices, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceGetInputDeviceHandle"), STAT_XimmerseSdk_GetInputDeviceHandle, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceGetInputDeviceName"), STAT_XimmerseSdk_GetInputDeviceName, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceGetInputState"), STAT_XimmerseSdk_GetInputState, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceGetInt"), STAT_XimmerseSdk_GetInt, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceSetInt"), STAT_XimmerseSdk_SetInt, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceSetBool"), STAT_XimmerseSdk_SetBool, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceSetEventListener"), STAT_XimmerseSdk_SetEventListener, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceSendMessage"), STAT_XimmerseSdk_SendMessage, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceAddExternalControllerDevice"), STAT_XimmerseSdk_AddExternalControllerDevice, STATGROUP_Ximmerse, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("XDeviceRemoveInputDeviceAt"), STAT_XimmerseSdk_RemoveInputDeviceAt, STATGROUP_Ximmerse, );
+
+/** SDK entry points the plugin calls, named after the XDevice functions */
+namespace EXimmerseSdkFunction
+{
+	enum Type
+	{
+		Init,
+		Exit,
+		GetTickCount,
+		GetInputDeviceCount,
+		GetInputDevices,
+		GetInputDeviceHandle,
+		GetInputDeviceName,
+		GetInputState,
+		GetInt,
+		SetInt,
+		SetBool,
+		SetEventListener,
+		SendMessage,
+		AddExternalControllerDevice,
+		RemoveInputDeviceAt,
+		Count,
+	};
+}
+
+/** An SDK call that took longer than ximmerse.SdkSlowCallThreshold */
+struct FXimmerseSdkSlowCall
+{
+	EXimmerseSdkFunction::Type Function;
+
+	/** Device the call was about, -1 for calls about no device */
+	int32 Handle;
+
+	uint32 ThreadId;
+
+	/** How long the call took, and FPlatformTime::Seconds() when it returned */
+	double Seconds;
+	double EndTime;
+};
+
+/**
+* Counts and times every call into the SDK, on whatever thread it happens. Besides the cycle stats, every entry point
+* keeps a latency histogram, so a driver that stalls now and then shows in the tail rather than vanishing in an
+* average. Calls slower than ximmerse.SdkSlowCallThreshold are logged and kept, with the handle they were about,
+* for ximmerse.sdkstats.
+*/
+class FXimmerseSdkStats
+{
+public:
+	/** Records one call that took Cycles */
+	static void Record(EXimmerseSdkFunction::Type Function, int32 Handle, uint64 Cycles);
+
+	/** Prints the calls, time and latency percentiles of every entry point called so far, and the slow calls kept */
+	static void Dump(FOutputDevice& Ar);
+
+	/** Forgets every call. Calls recorded concurrently may survive. */
+	static void Reset();
+
+	/** Name of the XDevice function */
+	static const TCHAR* GetFunctionName(EXimmerseSdkFunction::Type Function);
+};
+
+/** Times the SDK call made during its lifetime */
+class FXimmerseSdkCallScope
+{
+public:
+	FXimmerseSdkCallScope(EXimmerseSdkFunction::Type InFunction, int32 InHandle)
+		: Function(InFunction)
+		, Handle(InHandle)
+		, StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~FXimmerseSdkCallScope()
+	{
+		FXimmerseSdkStats::Record(Function, Handle, FPlatformTime::Cycles64() - StartCycles);
+	}
+
+private:
+	EXimmerseSdkFunction::Type Function;
+	int32 Handle;
+	uint64 StartCycles;
+};
+
+/**
+* Makes the SDK call Call to the entry point Function about the device Handle (-1 for none), counted and timed,
+* and evaluates to what it returns: XIMMERSE_SDK_CALL(GetInt, Handle, XDeviceGetInt(Handle, Field, 0))
+*/
+#define XIMMERSE_SDK_CALL(Function, Handle, Call) \
+	([&]() \
+	{ \
+		SCOPE_CYCLE_COUNTER(STAT_XimmerseSdk_##Function); \
+		FXimmerseSdkCallScope SdkCallScope(EXimmerseSdkFunction::Function, Handle); \
+		return Call; \
+	}())
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,60 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/**
+* Single-writer sequence lock around a trivially copyable value.
+* The writer never waits; readers retry only while a write is in flight, and never observe a torn value.
+*/
+template<typename ValueType>
+class TXimmerseSeqLock
+{
+public:
+	TXimmerseSeqLock()
+		: Sequence(0)
+		, Value()
+	{
+	}
+
+	/** Publishes a new value. Only one thread may write at a time. */
+	void Write(const ValueType& InValue)
+	{
+		// an odd sequence marks a write in progress, the interlocked operations double as full barriers
+		FPlatformAtomics::InterlockedIncrement(&Sequence);
+		Value = InValue;
+		FPlatformAtomics::InterlockedIncrement(&Sequence);
+	}
+
+	/** Returns the newest completely written value, from any thread */
+	ValueType Read() const
+	{
+		ValueType Result;
+		for (;;)
+		{
+			const int32 Begin = Sequence;
+			FPlatformMisc::MemoryBarrier();
+
+			if ((Begin & 1) == 0)
+			{
+				Result = Value;
+				FPlatformMisc::MemoryBarrier();
+
+				if (Sequence == Begin)
+				{
+					return Result;
+				}
+			}
+
+			FPlatformProcess::Yield();
+		}
+	}
+
+	/** Number of completed writes so far */
+	int32 GetNumWrites() const
+	{
+		return Sequence >> 1;
+	}
+
+private:
+	volatile int32 Sequence;
+	ValueType Value;
+};
@@ -0,0 +1,132 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseSharedMemory.h"
+#include "XimmerseInputTranslator.h"
+#include "XimmersePose.h"
+#include <ControllerState.h>
+
+static_assert(sizeof(FXimmerseSharedMemoryHeader) == 128, "The shared-memory header must stay 128 bytes, readers rely on it");
+static_assert(sizeof(FXimmerseSharedSample) == 128, "Shared samples must stay 128 bytes, readers rely on it");
+static_assert((XIMMERSE_SHARED_MEMORY_SLOTS & (XIMMERSE_SHARED_MEMORY_SLOTS - 1)) == 0, "XIMMERSE_SHARED_MEMORY_SLOTS must be a power of two");
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+FXimmerseSharedMemoryPublisher::FXimmerseSharedMemoryPublisher()
+	: Region(nullptr)
+	, Header(nullptr)
+	, Samples(nullptr)
+	, NumWritten(0)
+{
+}
+
+FXimmerseSharedMemoryPublisher::~FXimmerseSharedMemoryPublisher()
+{
+	Close();
+}
+
+bool FXimmerseSharedMemoryPublisher::Open(const FString& InName)
+{
+	Close();
+
+	const SIZE_T Size = sizeof(FXimmerseSharedMemoryHeader) + XIMMERSE_SHARED_MEMORY_SLOTS * sizeof(FXimmerseSharedSample);
+	Region = FPlatformMemory::MapNamedSharedMemoryRegion(InName, true, (uint32)FPlatformMemory::ESharedMemoryAccess::Read | (uint32)FPlatformMemory::ESharedMemoryAccess::Write, Size);
+	if (Region == nullptr)
+	{
+		return false;
+	}
+
+	Header = (FXimmerseSharedMemoryHeader*)Region->GetAddress();
+	Samples = (FXimmerseSharedSample*)(Header + 1);
+	Name = InName;
+	NumWritten = 0;
+
+	// readers that kept the region of a previous writer open see it vanish before its samples are cleared
+	Header->Magic = 0;
+	FPlatformMisc::MemoryBarrier();
+	FMemory::Memzero(Region->GetAddress(), Size);
+
+	Header->Version = XIMMERSE_SHARED_MEMORY_VERSION;
+	Header->HeaderSize = sizeof(FXimmerseSharedMemoryHeader);
+	Header->SampleSize = sizeof(FXimmerseSharedSample);
+	Header->NumSlots = XIMMERSE_SHARED_MEMORY_SLOTS;
+	Header->WriterProcessId = FPlatformProcess::GetCurrentProcessId();
+	Header->StartTime = FPlatformTime::Seconds();
+
+	// the magic goes in last, a reader that sees it sees the rest of the header
+	FPlatformMisc::MemoryBarrier();
+	Header->Magic = XIMMERSE_SHARED_MEMORY_MAGIC;
+
+	FPlatformMisc::MemoryBarrier();
+	bPublishing = true;
+	return true;
+}
+
+void FXimmerseSharedMemoryPublisher::Close()
+{
+	if (Region == nullptr)
+	{
+		return;
+	}
+
+	// once no publish is in flight the region belongs to us
+	bPublishing = false;
+	while (NumPublishing.GetValue() > 0)
+	{
+		FPlatformProcess::Yield();
+	}
+
+	Header->Magic = 0;
+	FPlatformMisc::MemoryBarrier();
+
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+	Region = nullptr;
+	Header = nullptr;
+	Samples = nullptr;
+}
+
+void FXimmerseSharedMemoryPublisher::Publish(int32 DeviceIndex, int32 TrackingResult, const ControllerState& State, const FXimmersePose& Pose)
+{
+	NumPublishing.Increment();
+
+	if (bPublishing)
+	{
+		FXimmerseSharedSample& Sample = Samples[NumWritten & (XIMMERSE_SHARED_MEMORY_SLOTS - 1)];
+
+		// an odd sequence tells readers the slot is being overwritten, the interlocked exchanges double as full barriers
+		FPlatformAtomics::InterlockedExchange(&Sample.Sequence, 2 * NumWritten + 1);
+
+		Sample.WriteTime = FPlatformTime::Seconds();
+		Sample.SampleTime = Pose.SampleTime;
+		Sample.DeviceTime = Pose.DeviceTime;
+		Sample.DeviceIndex = DeviceIndex;
+		Sample.Timestamp = State.timestamp;
+		Sample.TrackingResult = TrackingResult;
+		Sample.Buttons = State.buttons;
+		ControllerState TranslatedState = State;
+		FXimmerseInputTranslator::ZeroUntouchedAxes(TranslatedState);
+		FMemory::Memcpy(Sample.Axes, TranslatedState.axes, sizeof(Sample.Axes));
+		Sample.Position[0] = Pose.Position.X;
+		Sample.Position[1] = Pose.Position.Y;
+		Sample.Position[2] = Pose.Position.Z;
+		Sample.Orientation[0] = Pose.Orientation.X;
+		Sample.Orientation[1] = Pose.Orientation.Y;
+		Sample.Orientation[2] = Pose.Orientation.Z;
+		Sample.Orientation[3] = Pose.Orientation.W;
+		Sample.AngularVelocity[0] = Pose.AngularVelocity.X;
+		Sample.AngularVelocity[1] = Pose.AngularVelocity.Y;
+		Sample.AngularVelocity[2] = Pose.AngularVelocity.Z;
+		Sample.LinearVelocity[0] = Pose.LinearVelocity.X;
+		Sample.LinearVelocity[1] = Pose.LinearVelocity.Y;
+		Sample.LinearVelocity[2] = Pose.LinearVelocity.Z;
+
+		FPlatformAtomics::InterlockedExchange(&Sample.Sequence, 2 * NumWritten + 2);
+
+		++NumWritten;
+		FPlatformAtomics::InterlockedExchange(&Header->NumWritten, NumWritten);
+	}
+
+	NumPublishing.Decrement();
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,137 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/**
+* Layout of the shared-memory ring external tools read the processed samples from, see FXimmerseSharedMemoryPublisher.
+* Tools/XimmerseSharedMemoryReader mirrors it, keep them in sync.
+*
+* The region starts with a header, followed by NumSlots samples. Sample N goes to slot N % NumSlots. The writer marks
+* a slot with Sequence 2 * N + 1 while it writes sample N into it and 2 * N + 2 once it is complete, then raises
+* NumWritten to N + 1. A reader copies a slot out and accepts it if Sequence read 2 * N + 2 both before and after the
+* copy; otherwise the writer lapped it and the sample is lost to that reader. Readers never write to the region.
+*/
+
+/** 'XSHM' */
+#define XIMMERSE_SHARED_MEMORY_MAGIC	0x4d485358
+#define XIMMERSE_SHARED_MEMORY_VERSION	1
+
+/** Region name used unless another one is given */
+#define XIMMERSE_SHARED_MEMORY_NAME		TEXT("XimmerseInput")
+
+/** Samples the ring holds, a few seconds of two controllers polled at 1 kHz. Must be a power of two. */
+#define XIMMERSE_SHARED_MEMORY_SLOTS	4096
+
+/** 128 bytes, its own cache line for the counter every reader polls */
+struct FXimmerseSharedMemoryHeader
+{
+	/** XIMMERSE_SHARED_MEMORY_MAGIC once the writer initialized the region, 0 before and after it published */
+	volatile uint32 Magic;
+	uint32 Version;
+	uint32 HeaderSize;
+	uint32 SampleSize;
+	uint32 NumSlots;
+	uint32 WriterProcessId;
+
+	/** FPlatformTime::Seconds() of the writer when it opened the region */
+	double StartTime;
+
+	uint8 Padding0[32];
+
+	/** Samples written since the region was opened */
+	volatile int64 NumWritten;
+
+	uint8 Padding1[56];
+};
+
+/** One processed sample, 128 bytes. Positions and orientations are in Unreal space, as published to the game. */
+struct FXimmerseSharedSample
+{
+	/** 2 * N + 1 while sample N is being written, 2 * N + 2 once it is complete */
+	volatile int64 Sequence;
+
+	/** FPlatformTime::Seconds() at which the sample was written into the ring */
+	double WriteTime;
+
+	/** FPlatformTime::Seconds() at which the sample was taken, and at which the device stamped it (0 if unknown) */
+	double SampleTime;
+	double DeviceTime;
+
+	int32 DeviceIndex;
+
+	/** SDK timestamp in milliseconds, tracking result and button bit mask, as the SDK reported them */
+	int32 Timestamp;
+	int32 TrackingResult;
+	uint32 Buttons;
+
+	float Axes[6];
+
+	/** cm, quaternion X Y Z W, rad/s in the controller's frame, cm/s */
+	float Position[3];
+	float Orientation[4];
+	float AngularVelocity[3];
+	float LinearVelocity[3];
+
+	uint32 Reserved;
+};
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+struct FXimmersePose;
+
+/**
+* Publishes every processed sample into a named shared-memory ring, so monitoring tools next to the game get the
+* plugin's view of the devices without opening them themselves. Publishing is a copy into the mapped region and
+* never blocks or calls into the system; there is a single writer, any number of readers, and no reader can hold
+* the writer up. Open and Close are called from the game thread, Publish from whichever thread samples the devices.
+*/
+class FXimmerseSharedMemoryPublisher
+{
+public:
+	FXimmerseSharedMemoryPublisher();
+	~FXimmerseSharedMemoryPublisher();
+
+	/** Maps the region Name and starts publishing into it, returns false if it cannot be mapped */
+	bool Open(const FString& Name);
+
+	/** Stops publishing and unmaps the region */
+	void Close();
+
+	bool IsPublishing() const
+	{
+		return bPublishing;
+	}
+
+	/**
+	* Writes one sample into the ring, does nothing unless publishing. The axes go out the way the translator sees
+	* them, touchpad axes zeroed while the pad is not touched, whether the poll thread, the replay or the game
+	* thread publishes.
+	*/
+	void Publish(int32 DeviceIndex, int32 TrackingResult, const ControllerState& State, const FXimmersePose& Pose);
+
+	/** Samples written since the region was opened */
+	int64 GetNumPublished() const
+	{
+		return (Header != nullptr) ? Header->NumWritten : 0;
+	}
+
+	const FString& GetName() const
+	{
+		return Name;
+	}
+
+private:
+	FPlatformMemory::FSharedMemoryRegion* Region;
+	FXimmerseSharedMemoryHeader* Header;
+	FXimmerseSharedSample* Samples;
+	FString Name;
+
+	/** Writer side: samples written so far */
+	int64 NumWritten;
+
+	/** Publishes currently running, Close waits for them before unmapping */
+	FThreadSafeCounter NumPublishing;
+
+	FThreadSafeBool bPublishing;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
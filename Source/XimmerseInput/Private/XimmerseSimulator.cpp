@@ -0,0 +1,201 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseSimulator.h"
+#include "XimmerseDevice.h"
+#include "XimmerseLatency.h"
+#include "XimmerseSdkStats.h"
+#include <ControllerState.h>
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** Period in seconds of the simulated motion */
+#define SIM_MOTION_PERIOD	2.0
+
+/** SDK timestamps count milliseconds, two samples within one would read as duplicates */
+#define SIM_MAX_SAMPLE_RATE	1000.0f
+
+/** Radius in meters of the circle the controllers move on */
+#define SIM_MOTION_RADIUS	0.3f
+
+static const TCHAR* SimPatternNames[EXimmerseSimPattern::Count] = { TEXT("still"), TEXT("motion"), TEXT("buttons"), TEXT("all") };
+
+/** Buttons the Buttons pattern flips, with the period in seconds of each */
+static const struct
+{
+	uint32 Button;
+	double Period;
+}
+SimButtons[] =
+{
+	{ CONTROLLER_BUTTON_APP, 0.5 },
+	{ CONTROLLER_BUTTON_CLICK, 0.7 },
+	{ CONTROLLER_BUTTON_LEFT_GRIP, 1.1 },
+	{ CONTROLLER_BUTTON_RIGHT_GRIP, 1.3 },
+};
+
+FXimmerseSimulator* volatile FXimmerseSimulator::Instance = nullptr;
+FThreadSafeCounter FXimmerseSimulator::NumCallbacksInFlight;
+
+FXimmerseSimulator::FXimmerseSimulator(int32 NumControllers, float InSampleRate, EXimmerseSimPattern::Type InPattern)
+	: SampleRate(FMath::Clamp(InSampleRate, 1.0f, SIM_MAX_SAMPLE_RATE))
+	, Pattern(InPattern)
+	, NumRegistered(0)
+	, StartTime(FPlatformTime::Seconds())
+	, StartMemory(FPlatformMemory::GetStats().UsedPhysical)
+	, NumStatesServed(0)
+	, NumMessagesReceived(0)
+{
+	check(Instance == nullptr);
+
+	Handles.Init(INDEX_NONE, FMath::Max(NumControllers, 0));
+	FPlatformAtomics::InterlockedExchangePtr((void**)&Instance, this);
+
+	for (int32 ControllerIndex = 0; ControllerIndex < Handles.Num(); ++ControllerIndex)
+	{
+		ANSICHAR Name[32];
+		FCStringAnsi::Sprintf(Name, "XSim-%d", ControllerIndex);
+
+		const int32 Handle = XIMMERSE_SDK_CALL(AddExternalControllerDevice, -1, XDeviceAddExternalControllerDevice(Name, &GetControllerState, &SendMessage));
+		if (Handle < 0)
+		{
+			UE_LOG(LogXimmerseInput, Warning, TEXT("The SDK refused simulated controller %s (error %d)"), ANSI_TO_TCHAR(Name), Handle);
+			break;
+		}
+
+		// the input path reads these like it reads the hardware's
+		XIMMERSE_SDK_CALL(SetInt, Handle, XDeviceSetInt(Handle, kField_ConnectionState, EXimmerseConnectionState::Connected));
+		XIMMERSE_SDK_CALL(SetInt, Handle, XDeviceSetInt(Handle, kField_TrackingResult, kTrackingResult_RotationTracked | kTrackingResult_PositionTracked));
+		XIMMERSE_SDK_CALL(SetInt, Handle, XDeviceSetInt(Handle, kField_BatteryLevel, 100));
+
+		FPlatformAtomics::InterlockedExchange(&Handles[ControllerIndex], Handle);
+		++NumRegistered;
+	}
+
+	UE_LOG(LogXimmerseInput, Log, TEXT("Simulating %d controllers at %.0f Hz, pattern %s"), NumRegistered, SampleRate, SimPatternNames[Pattern]);
+}
+
+FXimmerseSimulator::~FXimmerseSimulator()
+{
+	for (int32 ControllerIndex = 0; ControllerIndex < NumRegistered; ++ControllerIndex)
+	{
+		XIMMERSE_SDK_CALL(RemoveInputDeviceAt, Handles[ControllerIndex], XDeviceRemoveInputDeviceAt(Handles[ControllerIndex], true));
+	}
+
+	// a state request that picked up the simulator before it was cleared finishes first
+	FPlatformAtomics::InterlockedExchangePtr((void**)&Instance, nullptr);
+	while (NumCallbacksInFlight.GetValue() > 0)
+	{
+		FPlatformProcess::Yield();
+	}
+}
+
+void FXimmerseSimulator::DumpStats(FOutputDevice& Ar) const
+{
+	const double Elapsed = FMath::Max(FPlatformTime::Seconds() - StartTime, SMALL_NUMBER);
+	const int64 MemoryGrowth = (int64)FPlatformMemory::GetStats().UsedPhysical - (int64)StartMemory;
+
+	Ar.Logf(TEXT("Ximmerse simulator: %d controllers at %.0f Hz, pattern %s, running for %.0f s"), NumRegistered, SampleRate, SimPatternNames[Pattern], Elapsed);
+	Ar.Logf(TEXT("  %lld states served (%.0f per second), %lld vibration messages, memory %+.2f MB since the start"),
+		NumStatesServed, NumStatesServed / Elapsed, NumMessagesReceived, MemoryGrowth / (1024.0 * 1024.0));
+}
+
+EXimmerseSimPattern::Type FXimmerseSimulator::ParsePattern(const FString& Name)
+{
+	for (int32 PatternIndex = 0; PatternIndex < EXimmerseSimPattern::Count; ++PatternIndex)
+	{
+		if (Name == SimPatternNames[PatternIndex])
+		{
+			return (EXimmerseSimPattern::Type)PatternIndex;
+		}
+	}
+	return EXimmerseSimPattern::All;
+}
+
+void FXimmerseSimulator::ComputeState(int32 ControllerIndex, double Time, ControllerState& OutState) const
+{
+	// time snaps to the sample grid, so the state only changes SampleRate times per second
+	const double SampleIndex = FMath::FloorToDouble((Time - StartTime) * SampleRate);
+	const double SampleTime = SampleIndex / SampleRate;
+
+	FMemory::Memzero(OutState);
+	OutState.handle = Handles[ControllerIndex];
+	OutState.timestamp = FXimmerseSdkClock::ToTicks(StartTime + SampleTime);
+	OutState.rotation[3] = 1.0f;
+	OutState.accelerometer[1] = 1.0f;
+	OutState.position[1] = 1.2f;
+
+	// controllers are spread around the circle
+	const float Phase = (float)(2.0 * PI * SampleTime / SIM_MOTION_PERIOD) + (float)ControllerIndex;
+
+	if (Pattern == EXimmerseSimPattern::Motion || Pattern == EXimmerseSimPattern::All)
+	{
+		OutState.position[0] = SIM_MOTION_RADIUS * FMath::Cos(Phase);
+		OutState.position[2] = SIM_MOTION_RADIUS * FMath::Sin(Phase);
+		OutState.rotation[1] = FMath::Sin(Phase * 0.5f);
+		OutState.rotation[3] = FMath::Cos(Phase * 0.5f);
+		OutState.gyroscope[1] = (float)(2.0 * PI / SIM_MOTION_PERIOD);
+
+		// the thumb rests on the pad two thirds of the time and circles
+		if (FMath::Fmod(SampleTime, 3.0) < 2.0)
+		{
+			OutState.buttons |= CONTROLLER_BUTTON_TOUCH;
+			OutState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_X] = 0.8f * FMath::Cos(Phase * 2.0f);
+			OutState.axes[CONTROLLER_AXIS_PRIMARY_THUMB_Y] = 0.8f * FMath::Sin(Phase * 2.0f);
+		}
+	}
+
+	if (Pattern == EXimmerseSimPattern::Buttons || Pattern == EXimmerseSimPattern::All)
+	{
+		for (const auto& SimButton : SimButtons)
+		{
+			if (((int64)(SampleTime / SimButton.Period)) & 1)
+			{
+				OutState.buttons |= SimButton.Button;
+			}
+		}
+
+		const double TriggerPhase = FMath::Fmod(SampleTime, 1.0);
+		OutState.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER] = (float)(1.0 - FMath::Abs(2.0 * TriggerPhase - 1.0));
+	}
+}
+
+FXimmerseSimulator* FXimmerseSimulator::BeginCallback()
+{
+	NumCallbacksInFlight.Increment();
+	return Instance;
+}
+
+void FXimmerseSimulator::EndCallback()
+{
+	NumCallbacksInFlight.Decrement();
+}
+
+int FXimmerseSimulator::GetControllerState(int Which, ControllerState* State)
+{
+	int Result = -1;
+	if (FXimmerseSimulator* Simulator = BeginCallback())
+	{
+		const int32 ControllerIndex = Simulator->Handles.Find(Which);
+		if (ControllerIndex != INDEX_NONE && State != nullptr)
+		{
+			Simulator->ComputeState(ControllerIndex, FPlatformTime::Seconds(), *State);
+			FPlatformAtomics::InterlockedIncrement(&Simulator->NumStatesServed);
+			Result = 0;
+		}
+	}
+	EndCallback();
+	return Result;
+}
+
+int FXimmerseSimulator::SendMessage(int Which, int Msg, int WParam, int LParam)
+{
+	if (FXimmerseSimulator* Simulator = BeginCallback())
+	{
+		FPlatformAtomics::InterlockedIncrement(&Simulator->NumMessagesReceived);
+	}
+	EndCallback();
+	return 0;
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
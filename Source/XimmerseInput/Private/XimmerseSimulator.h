@@ -0,0 +1,84 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/** What the simulated controllers do */
+namespace EXimmerseSimPattern
+{
+	enum Type
+	{
+		/** Samples keep coming, nothing changes */
+		Still,
+
+		/** Poses circle and turn, a thumb circles on the touchpad */
+		Motion,
+
+		/** Buttons flip at different periods, the trigger ramps up and down */
+		Buttons,
+
+		/** Motion and Buttons at once */
+		All,
+
+		Count
+	};
+}
+
+/**
+* Virtual controllers registered with the SDK through XDeviceAddExternalControllerDevice, named XSim-N.
+* The SDK asks the simulator for their states like it asks the hardware, so every part of the plugin
+* sees them as controllers: the registry, polling, the poll thread, input messages, poses and vibration.
+* States are computed from the time, a new sample every 1 / SampleRate seconds up to 1 kHz, from any thread.
+*/
+class FXimmerseSimulator
+{
+public:
+	/** Registers NumControllers controllers with the SDK. There is at most one simulator at a time. */
+	FXimmerseSimulator(int32 NumControllers, float InSampleRate, EXimmerseSimPattern::Type InPattern);
+
+	/** Unregisters the controllers, waits for state requests in flight */
+	~FXimmerseSimulator();
+
+	/** Number of controllers the SDK accepted */
+	int32 GetNumControllers() const
+	{
+		return NumRegistered;
+	}
+
+	/** Prints the states served, the vibration messages received and the memory used since the start */
+	void DumpStats(FOutputDevice& Ar) const;
+
+	/** Pattern named by a console argument, All if the name is unknown */
+	static EXimmerseSimPattern::Type ParsePattern(const FString& Name);
+
+private:
+	/** Fills the state of a simulated controller at a platform time */
+	void ComputeState(int32 ControllerIndex, double Time, ControllerState& OutState) const;
+
+	// SDK delegates, forwarded to the running simulator
+	static int GetControllerState(int Which, ControllerState* State);
+	static int SendMessage(int Which, int Msg, int WParam, int LParam);
+
+	/** Returns the running simulator, which is not destroyed before the matching EndCallback */
+	static FXimmerseSimulator* BeginCallback();
+	static void EndCallback();
+
+	static FXimmerseSimulator* volatile Instance;
+	static FThreadSafeCounter NumCallbacksInFlight;
+
+	const float SampleRate;
+	const EXimmerseSimPattern::Type Pattern;
+
+	/** SDK handle of each controller, sized before the first registration so delegates may read it meanwhile */
+	TArray<int32> Handles;
+	int32 NumRegistered;
+
+	double StartTime;
+	uint64 StartMemory;
+
+	/** 64 bits, a soak test at kHz rates runs long enough to overflow 32 */
+	volatile int64 NumStatesServed;
+	volatile int64 NumMessagesReceived;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
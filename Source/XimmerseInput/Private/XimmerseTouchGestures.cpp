@@ -0,0 +1,202 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseTouchGestures.h"
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+//
+// Gesture thresholds, distances in pad units where the pad spans -1 to 1
+//
+#define TOUCH_TAP_SLOP					0.1f
+#define TOUCH_HOLD_TIME					0.4f
+#define TOUCH_SWIPE_MIN_DISTANCE		0.5f
+#define TOUCH_FLICK_MIN_DISTANCE		0.3f
+#define TOUCH_FLICK_MIN_SPEED			4.0f
+#define TOUCH_VELOCITY_SMOOTHING		0.02f
+#define TOUCH_SCROLL_MIN_RADIUS			0.4f
+#define TOUCH_SCROLL_RADIUS_TOLERANCE	0.25f
+#define TOUCH_SCROLL_START_ANGLE		(PI * 2.0f / 3.0f)
+#define TOUCH_SCROLL_STEP_ANGLE			(PI / 6.0f)
+
+FXimmerseTouchGestureRecognizer::FXimmerseTouchGestureRecognizer()
+	: TapSlop(TOUCH_TAP_SLOP)
+	, HoldTime(TOUCH_HOLD_TIME)
+	, SwipeMinDistance(TOUCH_SWIPE_MIN_DISTANCE)
+	, FlickMinDistance(TOUCH_FLICK_MIN_DISTANCE)
+	, FlickMinSpeed(TOUCH_FLICK_MIN_SPEED)
+	, VelocitySmoothing(TOUCH_VELOCITY_SMOOTHING)
+	, ScrollMinRadius(TOUCH_SCROLL_MIN_RADIUS)
+	, ScrollRadiusTolerance(TOUCH_SCROLL_RADIUS_TOLERANCE)
+	, ScrollStartAngle(TOUCH_SCROLL_START_ANGLE)
+	, ScrollStepAngle(TOUCH_SCROLL_STEP_ANGLE)
+{
+}
+
+FXimmerseTouchGestureEvents FXimmerseTouchGestureRecognizer::Update(FXimmerseTouchGestureState& State, bool bTouching, const FVector2D& Position, int32 Timestamp) const
+{
+	FXimmerseTouchGestureEvents Events;
+
+	if (!bTouching)
+	{
+		if (State.bTouching)
+		{
+			FinishTouch(State, Events);
+			Reset(State);
+		}
+		return Events;
+	}
+
+	if (!State.bTouching)
+	{
+		const float Radius = Position.Size();
+
+		FMemory::Memzero(State);
+		State.bTouching = true;
+		State.StartTimestamp = Timestamp;
+		State.LastTimestamp = Timestamp;
+		State.StartPosition = Position;
+		State.LastPosition = Position;
+		State.MinScrollRadius = Radius;
+		State.MaxScrollRadius = Radius;
+		return Events;
+	}
+
+	// SDK timestamps count milliseconds, differences stay right across a wrap
+	const float DeltaTime = (float)(Timestamp - State.LastTimestamp) * 0.001f;
+	if (DeltaTime > 0.0f)
+	{
+		const FVector2D SampleVelocity = (Position - State.LastPosition) / DeltaTime;
+		State.Velocity += (SampleVelocity - State.Velocity) * (DeltaTime / (DeltaTime + VelocitySmoothing));
+	}
+
+	if (!State.bMoved && FVector2D::DistSquared(Position, State.StartPosition) > FMath::Square(TapSlop))
+	{
+		State.bMoved = true;
+	}
+
+	if (!State.bMoved && !State.bHolding && (float)(Timestamp - State.StartTimestamp) * 0.001f >= HoldTime)
+	{
+		State.bHolding = true;
+		Events.Pressed |= 1u << EXimmerseTouchGesture::Hold;
+	}
+
+	if (State.bMoved)
+	{
+		UpdateScroll(State, Position, Events);
+	}
+
+	State.LastTimestamp = Timestamp;
+	State.LastPosition = Position;
+	return Events;
+}
+
+void FXimmerseTouchGestureRecognizer::UpdateScroll(FXimmerseTouchGestureState& State, const FVector2D& Position, FXimmerseTouchGestureEvents& Events) const
+{
+	// strokes through the middle of the pad sweep large angles without circling
+	const float Radius = Position.Size();
+	if (Radius < ScrollMinRadius || State.LastPosition.SizeSquared() < FMath::Square(ScrollMinRadius))
+	{
+		if (!State.bScrolling)
+		{
+			State.ScrollAngle = 0.0f;
+			State.MinScrollRadius = Radius;
+			State.MaxScrollRadius = Radius;
+		}
+		return;
+	}
+
+	// signed angle between the last and the current position, counter-clockwise is positive with +Y up
+	const FVector2D& Last = State.LastPosition;
+	State.ScrollAngle += FMath::Atan2(Last.X * Position.Y - Last.Y * Position.X, Last | Position);
+
+	if (!State.bScrolling)
+	{
+		State.MinScrollRadius = FMath::Min(State.MinScrollRadius, Radius);
+		State.MaxScrollRadius = FMath::Max(State.MaxScrollRadius, Radius);
+
+		// a straight stroke off the center sweeps an angle too, but its radius changes on the way
+		if (State.MaxScrollRadius - State.MinScrollRadius > ScrollRadiusTolerance)
+		{
+			State.ScrollAngle = 0.0f;
+			State.MinScrollRadius = Radius;
+			State.MaxScrollRadius = Radius;
+			return;
+		}
+
+		if (FMath::Abs(State.ScrollAngle) < ScrollStartAngle)
+		{
+			return;
+		}
+
+		// the angle swept to recognize the circle is scrolled as well, a step per sample until it caught up
+		State.bScrolling = true;
+	}
+
+	if (State.ScrollAngle >= ScrollStepAngle)
+	{
+		Events.Pulse(EXimmerseTouchGesture::ScrollCounterClockwise);
+		State.ScrollAngle -= ScrollStepAngle;
+	}
+	else if (State.ScrollAngle <= -ScrollStepAngle)
+	{
+		Events.Pulse(EXimmerseTouchGesture::ScrollClockwise);
+		State.ScrollAngle += ScrollStepAngle;
+	}
+}
+
+void FXimmerseTouchGestureRecognizer::FinishTouch(const FXimmerseTouchGestureState& State, FXimmerseTouchGestureEvents& Events) const
+{
+	if (State.bHolding)
+	{
+		Events.Released |= 1u << EXimmerseTouchGesture::Hold;
+		return;
+	}
+
+	if (State.bScrolling)
+	{
+		return;
+	}
+
+	if (!State.bMoved)
+	{
+		Events.Pulse(EXimmerseTouchGesture::Tap);
+		return;
+	}
+
+	const FVector2D Stroke = State.LastPosition - State.StartPosition;
+	const float Distance = Stroke.Size();
+
+	bool bFlick = false;
+	if (Distance >= FlickMinDistance && State.Velocity.SizeSquared() >= FMath::Square(FlickMinSpeed))
+	{
+		bFlick = true;
+	}
+	else if (Distance < SwipeMinDistance)
+	{
+		return;
+	}
+
+	// the dominant axis of the whole stroke decides the direction
+	int32 Direction;
+	if (FMath::Abs(Stroke.Y) >= FMath::Abs(Stroke.X))
+	{
+		Direction = (Stroke.Y > 0.0f) ? 0 : 1;
+	}
+	else
+	{
+		Direction = (Stroke.X < 0.0f) ? 2 : 3;
+	}
+
+	const int32 FirstGesture = bFlick ? EXimmerseTouchGesture::FlickUp : EXimmerseTouchGesture::SwipeUp;
+	Events.Pulse((EXimmerseTouchGesture::Type)(FirstGesture + Direction));
+}
+
+bool FXimmerseTouchGestureRecognizer::Reset(FXimmerseTouchGestureState& State)
+{
+	const bool bWasHolding = State.bHolding;
+	FMemory::Memzero(State);
+	return bWasHolding;
+}
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,146 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/**
+* Gestures recognized on the touchpad, each sent as a button of its own
+*/
+struct EXimmerseTouchGesture
+{
+	enum Type
+	{
+		/** Short touch that hardly moved */
+		Tap,
+
+		/** Touch that rests in place, held down until the thumb lifts */
+		Hold,
+
+		/** Stroke that slowed down before the thumb lifted */
+		SwipeUp,
+		SwipeDown,
+		SwipeLeft,
+		SwipeRight,
+
+		/** Stroke that was still fast when the thumb lifted */
+		FlickUp,
+		FlickDown,
+		FlickLeft,
+		FlickRight,
+
+		/** One step of a thumb circling the pad, sent every ScrollStepAngle */
+		ScrollClockwise,
+		ScrollCounterClockwise,
+
+		/** Max number of gestures. Must be <= 32 */
+		Count
+	};
+};
+
+#if XIMMERSE_INPUT_SUPPORTED_PLATFORMS
+
+/**
+* What the recognizer knows about the touch in progress on one controller. A fixed size, whatever the touch
+* does or how long it lasts, and all zero when the pad is not touched.
+*/
+struct FXimmerseTouchGestureState
+{
+	bool bTouching;
+
+	/** The thumb left the tap area around the start position, it is no tap or hold anymore */
+	bool bMoved;
+
+	/** Hold was pressed and still needs its release */
+	bool bHolding;
+
+	/** The touch was recognized as a circular scroll, it ends without a swipe or flick */
+	bool bScrolling;
+
+	/** SDK timestamps, in milliseconds */
+	int32 StartTimestamp;
+	int32 LastTimestamp;
+
+	FVector2D StartPosition;
+	FVector2D LastPosition;
+
+	/** Smoothed velocity in pad units per second */
+	FVector2D Velocity;
+
+	/** Angle around the pad center swept since the radius last drifted, or since the last scroll step, in radians */
+	float ScrollAngle;
+
+	/** Radius range of the circle being swept, a stroke whose radius varies more is not circling */
+	float MinScrollRadius;
+	float MaxScrollRadius;
+};
+
+/** Gestures that went down and up with one sample, as bit masks of EXimmerseTouchGesture */
+struct FXimmerseTouchGestureEvents
+{
+	uint32 Pressed;
+	uint32 Released;
+
+	FXimmerseTouchGestureEvents()
+		: Pressed(0)
+		, Released(0)
+	{
+	}
+
+	/** A gesture that is over as soon as it is recognized goes down and up at once */
+	void Pulse(EXimmerseTouchGesture::Type Gesture)
+	{
+		Pressed |= 1u << Gesture;
+		Released |= 1u << Gesture;
+	}
+};
+
+/**
+* Recognizes taps, holds, swipes, flicks and circular scrolls from every touchpad sample as it arrives.
+* A sample costs the same whatever came before, at most one square root and one arc tangent, and nothing
+* but FXimmerseTouchGestureState is kept, so it keeps up with the device's native rate.
+* Positions are in the UE4 convention, -1 to 1 with +Y up, so the directions match the thumbstick axes.
+*/
+class FXimmerseTouchGestureRecognizer
+{
+public:
+	FXimmerseTouchGestureRecognizer();
+
+	/** Feeds one sample, the position is ignored while the pad is not touched */
+	FXimmerseTouchGestureEvents Update(FXimmerseTouchGestureState& State, bool bTouching, const FVector2D& Position, int32 Timestamp) const;
+
+	/** Forgets the touch in progress. Returns true if Hold was down and needs a release. */
+	static bool Reset(FXimmerseTouchGestureState& State);
+
+	/** Distance from the start within which a touch may still be a tap or a hold */
+	float TapSlop;
+
+	/** Time in seconds after which a touch that did not move is a hold, a shorter one is a tap */
+	float HoldTime;
+
+	/** Shortest stroke recognized as a swipe */
+	float SwipeMinDistance;
+
+	/** Shortest stroke and lowest release speed, in pad units per second, recognized as a flick */
+	float FlickMinDistance;
+	float FlickMinSpeed;
+
+	/** Time constant in seconds of the velocity smoothing, which keeps a single noisy sample from making a flick */
+	float VelocitySmoothing;
+
+	/** Positions closer to the center than this do not count towards a circular scroll */
+	float ScrollMinRadius;
+
+	/** Largest radius change allowed while the circle is being recognized */
+	float ScrollRadiusTolerance;
+
+	/** Angle in radians to sweep before a touch counts as circling, then the angle per scroll step */
+	float ScrollStartAngle;
+	float ScrollStepAngle;
+
+private:
+	/** Adds the angle swept from the last position, sends a scroll step when it is due */
+	void UpdateScroll(FXimmerseTouchGestureState& State, const FVector2D& Position, FXimmerseTouchGestureEvents& Events) const;
+
+	/** Decides what the touch was once the thumb lifted */
+	void FinishTouch(const FXimmerseTouchGestureState& State, FXimmerseTouchGestureEvents& Events) const;
+};
+
+#endif // XIMMERSE_INPUT_SUPPORTED_PLATFORMS
@@ -0,0 +1,190 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "XimmerseInputPrivatePCH.h"
+#include "XimmerseTrace.h"
+
+static_assert(sizeof(FXimmerseTraceRecord) == 64, "Trace records must stay 64 bytes, the decoder relies on it");
+
+#if XIMMERSE_INPUT_TRACE_ENABLED
+
+/** Records kept per thread, the oldest are overwritten */
+#define TRACE_RECORDS_PER_THREAD	16384
+
+namespace XimmerseTrace
+{
+	/** Ring of one thread. Only the owning thread writes, dumps read whatever has been written so far. */
+	struct FThreadBuffer
+	{
+		uint32 ThreadId;
+		volatile int32 NumWritten;
+		FXimmerseTraceRecord Records[TRACE_RECORDS_PER_THREAD];
+	};
+
+	/** Guards the lists of buffers, taken once per thread and when dumping */
+	static FCriticalSection BuffersCritical;
+	static TArray<FThreadBuffer*> Buffers;
+	static uint32 TlsSlot = FPlatformTLS::AllocTlsSlot();
+
+	/** Buffers of threads that exited, still in Buffers, waiting for the next thread that traces */
+	static TArray<FThreadBuffer*> FreeBuffers;
+
+	static FThreadBuffer& GetThreadBuffer()
+	{
+		FThreadBuffer* Buffer = (FThreadBuffer*)FPlatformTLS::GetTlsValue(TlsSlot);
+		if (Buffer == nullptr)
+		{
+			FScopeLock Lock(&BuffersCritical);
+			if (FreeBuffers.Num() > 0)
+			{
+				Buffer = FreeBuffers.Pop(false);
+			}
+			else
+			{
+				Buffer = new FThreadBuffer;
+				Buffers.Add(Buffer);
+			}
+
+			// under the lock, a dump never sees a reused ring half reset
+			Buffer->ThreadId = FPlatformTLS::GetCurrentThreadId();
+			Buffer->NumWritten = 0;
+			FPlatformTLS::SetTlsValue(TlsSlot, Buffer);
+		}
+		return *Buffer;
+	}
+}
+
+void FXimmerseTrace::Write(FXimmerseTraceRecord& Record, EXimmerseTraceRecord::Type Type, int32 DeviceIndex)
+{
+	XimmerseTrace::FThreadBuffer& Buffer = XimmerseTrace::GetThreadBuffer();
+
+	Record.Cycles = FPlatformTime::Cycles64();
+	Record.Type = (uint16)Type;
+	Record.DeviceIndex = (uint16)DeviceIndex;
+	Record.ThreadId = Buffer.ThreadId;
+	Buffer.Records[Buffer.NumWritten % TRACE_RECORDS_PER_THREAD] = Record;
+
+	// the record only counts as written once the counter moves
+	FPlatformMisc::MemoryBarrier();
+	Buffer.NumWritten = Buffer.NumWritten + 1;
+}
+
+void FXimmerseTrace::Sample(int32 DeviceIndex, const ControllerState& XControllerState)
+{
+	FXimmerseTraceRecord Record;
+	Record.Sample.Timestamp = XControllerState.timestamp;
+	Record.Sample.Buttons = XControllerState.buttons;
+	Record.Sample.Trigger = XControllerState.axes[CONTROLLER_AXIS_PRIMARY_TRIGGER];
+	FMemory::Memcpy(Record.Sample.Position, XControllerState.position, sizeof(Record.Sample.Position));
+	FMemory::Memcpy(Record.Sample.Rotation, XControllerState.rotation, sizeof(Record.Sample.Rotation));
+	Write(Record, EXimmerseTraceRecord::Sample, DeviceIndex);
+}
+
+void FXimmerseTrace::Tracking(int32 DeviceIndex, int32 Result, const FVector& Position, const FRotator& Rotation)
+{
+	FXimmerseTraceRecord Record;
+	Record.Tracking.Result = Result;
+	Record.Tracking.Position[0] = Position.X;
+	Record.Tracking.Position[1] = Position.Y;
+	Record.Tracking.Position[2] = Position.Z;
+	Record.Tracking.Rotation[0] = Rotation.Pitch;
+	Record.Tracking.Rotation[1] = Rotation.Yaw;
+	Record.Tracking.Rotation[2] = Rotation.Roll;
+	Write(Record, EXimmerseTraceRecord::Tracking, DeviceIndex);
+}
+
+void FXimmerseTrace::Events(int32 DeviceIndex, int32 Timestamp, int32 NumPressed, int32 NumReleased, int32 NumAnalog)
+{
+	FXimmerseTraceRecord Record;
+	Record.Events.Timestamp = Timestamp;
+	Record.Events.NumPressed = NumPressed;
+	Record.Events.NumReleased = NumReleased;
+	Record.Events.NumAnalog = NumAnalog;
+	Write(Record, EXimmerseTraceRecord::Events, DeviceIndex);
+}
+
+void FXimmerseTrace::Timing(uint64 Cycles, int32 NumSamples)
+{
+	FXimmerseTraceRecord Record;
+	Record.Timing.Cycles = Cycles;
+	Record.Timing.NumSamples = NumSamples;
+	Write(Record, EXimmerseTraceRecord::Timing, INDEX_NONE);
+}
+
+bool FXimmerseTrace::Dump(const FString& Filename)
+{
+	TArray<uint8> Data;
+	Data.AddZeroed(sizeof(FXimmerseTraceFileHeader));
+
+	uint32 NumRecords = 0;
+	{
+		FScopeLock Lock(&XimmerseTrace::BuffersCritical);
+		for (XimmerseTrace::FThreadBuffer* Buffer : XimmerseTrace::Buffers)
+		{
+			// skip the oldest slot once the ring has wrapped, the owner may be overwriting it right now
+			const int32 NumWritten = Buffer->NumWritten;
+			const int32 First = FMath::Max(NumWritten - TRACE_RECORDS_PER_THREAD + 1, 0);
+			for (int32 Index = First; Index < NumWritten; ++Index)
+			{
+				Data.Append((const uint8*)&Buffer->Records[Index % TRACE_RECORDS_PER_THREAD], sizeof(FXimmerseTraceRecord));
+				++NumRecords;
+			}
+		}
+	}
+
+	FXimmerseTraceFileHeader& Header = *(FXimmerseTraceFileHeader*)Data.GetData();
+	Header.Magic = XIMMERSE_TRACE_MAGIC;
+	Header.Version = XIMMERSE_TRACE_VERSION;
+	Header.RecordSize = sizeof(FXimmerseTraceRecord);
+	Header.NumRecords = NumRecords;
+	Header.SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+
+	return FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+void FXimmerseTrace::Reset()
+{
+	FScopeLock Lock(&XimmerseTrace::BuffersCritical);
+	for (XimmerseTrace::FThreadBuffer* Buffer : XimmerseTrace::Buffers)
+	{
+		Buffer->NumWritten = 0;
+	}
+}
+
+void FXimmerseTrace::ReleaseThreadBuffer()
+{
+	XimmerseTrace::FThreadBuffer* Buffer = (XimmerseTrace::FThreadBuffer*)FPlatformTLS::GetTlsValue(XimmerseTrace::TlsSlot);
+	if (Buffer == nullptr)
+	{
+		return;
+	}
+
+	FPlatformTLS::SetTlsValue(XimmerseTrace::TlsSlot, nullptr);
+
+	FScopeLock Lock(&XimmerseTrace::BuffersCritical);
+	XimmerseTrace::FreeBuffers.Add(Buffer);
+}
+
+static void DumpTrace(const TArray<FString>& Args)
+{
+	const FString Filename = (Args.Num() > 0) ? Args[0] : FPaths::Combine(*FPaths::GameLogDir(), TEXT("XimmerseTrace.bin"));
+	if (FXimmerseTrace::Dump(Filename))
+	{
+		UE_LOG(LogXimmerseInput, Display, TEXT("Ximmerse input trace written to %s"), *Filename);
+	}
+	else
+	{
+		UE_LOG(LogXimmerseInput, Warning, TEXT("Failed to write the Ximmerse input trace to %s"), *Filename);
+	}
+}
+
+static FAutoConsoleCommand CmdTraceDump(
+    TEXT("ximmerse.TraceDump"),
+    TEXT("Writes the Ximmerse input trace to the given file, or to XimmerseTrace.bin in the log directory."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&DumpTrace));
+
+static FAutoConsoleCommand CmdTraceReset(
+    TEXT("ximmerse.TraceReset"),
+    TEXT("Discards the recorded Ximmerse input trace."),
+    FConsoleCommandDelegate::CreateStatic(&FXimmerseTrace::Reset));
+
+#endif // XIMMERSE_INPUT_TRACE_ENABLED
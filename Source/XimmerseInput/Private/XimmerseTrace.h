@@ -0,0 +1,122 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/**
+* Binary trace of the input path. Every thread writes fixed-size records into its own ring without locks,
+* the rings are only gathered when dumped with ximmerse.TraceDump. Tools/XimmerseTraceDecoder reads the dump.
+*/
+
+/** 'XTRC' */
+#define XIMMERSE_TRACE_MAGIC	0x43525458
+#define XIMMERSE_TRACE_VERSION	1
+
+namespace EXimmerseTraceRecord
+{
+	enum Type
+	{
+		/** Raw SDK sample, as returned by XDeviceGetInputState */
+		Sample,
+		/** Tracking result and converted pose of a processed sample */
+		Tracking,
+		/** Messages sent to the message handler for one sample */
+		Events,
+		/** Time spent in one SendControllerEvents call */
+		Timing,
+	};
+}
+
+#if PLATFORM_SUPPORTS_PRAGMA_PACK
+#pragma pack(push, 4)
+#endif
+
+/** One trace record, 64 bytes. The decoder mirrors this layout, keep them in sync. */
+struct FXimmerseTraceRecord
+{
+	uint64 Cycles;
+	uint16 Type;
+	uint16 DeviceIndex;
+	uint32 ThreadId;
+
+	union
+	{
+		struct
+		{
+			int32 Timestamp;
+			uint32 Buttons;
+			float Trigger;
+			float Position[3];
+			float Rotation[4];
+		} Sample;
+
+		struct
+		{
+			int32 Result;
+			float Position[3];
+			float Rotation[3];
+		} Tracking;
+
+		struct
+		{
+			int32 Timestamp;
+			int32 NumPressed;
+			int32 NumReleased;
+			int32 NumAnalog;
+		} Events;
+
+		struct
+		{
+			uint64 Cycles;
+			int32 NumSamples;
+		} Timing;
+
+		uint8 Payload[48];
+	};
+};
+
+/** Header of a dump file, followed by NumRecords records ordered by thread */
+struct FXimmerseTraceFileHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 RecordSize;
+	uint32 NumRecords;
+	double SecondsPerCycle;
+};
+
+#if PLATFORM_SUPPORTS_PRAGMA_PACK
+#pragma pack(pop)
+#endif
+
+#if XIMMERSE_INPUT_TRACE_ENABLED
+
+class FXimmerseTrace
+{
+public:
+	/** Stamps Record and appends it to the calling thread's ring */
+	static void Write(FXimmerseTraceRecord& Record, EXimmerseTraceRecord::Type Type, int32 DeviceIndex);
+
+	static void Sample(int32 DeviceIndex, const ControllerState& XControllerState);
+	static void Tracking(int32 DeviceIndex, int32 Result, const FVector& Position, const FRotator& Rotation);
+	static void Events(int32 DeviceIndex, int32 Timestamp, int32 NumPressed, int32 NumReleased, int32 NumAnalog);
+	static void Timing(uint64 Cycles, int32 NumSamples);
+
+	/** Writes the records of all threads to Filename, returns false if the file could not be written */
+	static bool Dump(const FString& Filename);
+
+	/** Forgets all recorded records */
+	static void Reset();
+
+	/**
+	* Hands the calling thread's ring to the next thread that starts tracing, so restarted threads do not pile up
+	* rings. Call it before a thread that traced exits; its records stay in dumps until the ring is reused.
+	*/
+	static void ReleaseThreadBuffer();
+};
+
+#define XIMMERSE_TRACE(Call)	FXimmerseTrace::Call
+
+#else
+
+#define XIMMERSE_TRACE(Call)
+
+#endif // XIMMERSE_INPUT_TRACE_ENABLED
@@ -7,7 +7,9 @@
 #ifndef XIMMERSE_INPUT_SUPPORTED_PLATFORMS
 #define XIMMERSE_INPUT_SUPPORTED_PLATFORMS (PLATFORM_WINDOWS && WINVER > 0x0502)
 #endif
-#define XIMMERSE_INPUT_VIBRATION_ENABLED	0
+#ifndef XIMMERSE_INPUT_TRACE_ENABLED
+#define XIMMERSE_INPUT_TRACE_ENABLED	(XIMMERSE_INPUT_SUPPORTED_PLATFORMS && !UE_BUILD_SHIPPING)
+#endif
 
 /**
 * The public interface to this module.  In most cases, this interface is only public to sibling modules
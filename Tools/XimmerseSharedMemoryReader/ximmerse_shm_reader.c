@@ -0,0 +1,539 @@
+/*
+ * Reference reader of the shared-memory ring the Ximmerse input plugin publishes its processed samples into
+ * (ximmerse.shm console command, or -XimmerseSharedMemory[=<name>] on the command line).
+ *
+ * Usage: ximmerse_shm_reader [name] [--csv]
+ *        ximmerse_shm_reader --selftest [samples]
+ *
+ * The first form follows the ring and prints every sample as it is published, XimmerseInput being the default
+ * name. The second form runs a writer and a reader in two processes on one named region (Linux and other POSIX
+ * systems) and reports throughput, lost samples and latency, first with the writer publishing as fast as it can,
+ * then paced at the poll thread's 1 kHz.
+ *
+ * Build: cc -O2 -o ximmerse_shm_reader ximmerse_shm_reader.c -lrt
+ *        cl /O2 ximmerse_shm_reader.c
+ *
+ * The layout mirrors Source/XimmerseInput/Private/XimmerseSharedMemory.h, keep them in sync. Readers only ever
+ * read the region, any number of them can follow it without slowing the game down.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define XIMMERSE_SHARED_MEMORY_MAGIC	0x4d485358
+#define XIMMERSE_SHARED_MEMORY_VERSION	1
+#define XIMMERSE_SHARED_MEMORY_NAME		"XimmerseInput"
+
+/* Slots of the self test's region, the plugin's XIMMERSE_SHARED_MEMORY_SLOTS */
+#define SELFTEST_SLOTS					4096
+#define SELFTEST_DEFAULT_SAMPLES		1000000
+#define SELFTEST_PACED_RATE				1000.0
+#define SELFTEST_PACED_SAMPLES			2000
+
+typedef struct
+{
+	volatile uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderSize;
+	uint32_t SampleSize;
+	uint32_t NumSlots;
+	uint32_t WriterProcessId;
+	double StartTime;
+	uint8_t Padding0[32];
+	volatile int64_t NumWritten;
+	uint8_t Padding1[56];
+} XimmerseSharedMemoryHeader;
+
+typedef struct
+{
+	volatile int64_t Sequence;
+	double WriteTime;
+	double SampleTime;
+	double DeviceTime;
+	int32_t DeviceIndex;
+	int32_t Timestamp;
+	int32_t TrackingResult;
+	uint32_t Buttons;
+	float Axes[6];
+	float Position[3];
+	float Orientation[4];
+	float AngularVelocity[3];
+	float LinearVelocity[3];
+	uint32_t Reserved;
+} XimmerseSharedSample;
+
+typedef char HeaderSizeCheck[(sizeof(XimmerseSharedMemoryHeader) == 128) ? 1 : -1];
+typedef char SampleSizeCheck[(sizeof(XimmerseSharedSample) == 128) ? 1 : -1];
+
+#if defined(_MSC_VER)
+/* volatile accesses are acquires and releases on x86 and x64 */
+#define LOAD_ACQUIRE(Pointer)		(*(Pointer))
+#define FENCE_ACQUIRE()				_ReadWriteBarrier()
+#define EXCHANGE(Pointer, Value)	InterlockedExchange64((volatile LONG64*)(Pointer), (Value))
+#else
+#define LOAD_ACQUIRE(Pointer)		__atomic_load_n((Pointer), __ATOMIC_ACQUIRE)
+#define FENCE_ACQUIRE()				__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define EXCHANGE(Pointer, Value)	__atomic_exchange_n((Pointer), (Value), __ATOMIC_SEQ_CST)
+#endif
+
+/* A mapped region and the reader's position in it */
+typedef struct
+{
+	XimmerseSharedMemoryHeader* Header;
+	XimmerseSharedSample* Samples;
+	int64_t Cursor;
+	int64_t NumRead;
+	int64_t NumLost;
+} Reader;
+
+static double NowSeconds(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER Counter, Frequency;
+	QueryPerformanceCounter(&Counter);
+	QueryPerformanceFrequency(&Frequency);
+	return (double)Counter.QuadPart / (double)Frequency.QuadPart;
+#else
+	/* FPlatformTime::Seconds() on Linux, so latencies against the game's WriteTime are meaningful */
+	struct timespec Time;
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return Time.tv_sec + Time.tv_nsec * 1e-9;
+#endif
+}
+
+/* Maps the region Name read-only, returns NULL if no writer created it yet */
+static void* MapRegion(const char* Name, size_t* OutSize)
+{
+#if defined(_WIN32)
+	HANDLE Mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, Name);
+	MEMORY_BASIC_INFORMATION Info;
+	void* Address;
+	if (Mapping == NULL)
+	{
+		return NULL;
+	}
+	Address = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(Mapping);
+	if (Address == NULL || VirtualQuery(Address, &Info, sizeof(Info)) == 0)
+	{
+		return NULL;
+	}
+	*OutSize = Info.RegionSize;
+	return Address;
+#else
+	/* the engine prefixes the name with a slash on POSIX systems */
+	char Path[256];
+	struct stat Stat;
+	void* Address;
+	int Fd;
+	snprintf(Path, sizeof(Path), "/%s", Name);
+	Fd = shm_open(Path, O_RDONLY, 0);
+	if (Fd < 0)
+	{
+		return NULL;
+	}
+	if (fstat(Fd, &Stat) != 0 || Stat.st_size < (off_t)sizeof(XimmerseSharedMemoryHeader))
+	{
+		close(Fd);
+		return NULL;
+	}
+	Address = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+	close(Fd);
+	if (Address == MAP_FAILED)
+	{
+		return NULL;
+	}
+	*OutSize = (size_t)Stat.st_size;
+	return Address;
+#endif
+}
+
+/* Checks the header of a mapped region, returns 0 while no writer initialized it */
+static int OpenReader(Reader* OutReader, void* Address, size_t Size)
+{
+	XimmerseSharedMemoryHeader* Header = (XimmerseSharedMemoryHeader*)Address;
+	if (LOAD_ACQUIRE(&Header->Magic) != XIMMERSE_SHARED_MEMORY_MAGIC)
+	{
+		return 0;
+	}
+	if (Header->Version != XIMMERSE_SHARED_MEMORY_VERSION || Header->SampleSize != sizeof(XimmerseSharedSample)
+		|| Header->NumSlots == 0 || (Header->NumSlots & (Header->NumSlots - 1)) != 0
+		|| Header->HeaderSize + (size_t)Header->NumSlots * Header->SampleSize > Size)
+	{
+		fprintf(stderr, "The region is not a version %d Ximmerse sample ring\n", XIMMERSE_SHARED_MEMORY_VERSION);
+		exit(1);
+	}
+
+	OutReader->Header = Header;
+	OutReader->Samples = (XimmerseSharedSample*)((uint8_t*)Address + Header->HeaderSize);
+	OutReader->Cursor = LOAD_ACQUIRE(&Header->NumWritten);
+	OutReader->NumRead = 0;
+	OutReader->NumLost = 0;
+	return 1;
+}
+
+/*
+ * Copies the next sample out of the ring. Returns 1 and fills OutSample if there was one, 0 if the reader caught up
+ * with the writer. Samples the writer lapped before they could be copied are counted as lost and skipped.
+ */
+static int ReadNext(Reader* InReader, XimmerseSharedSample* OutSample)
+{
+	const int64_t NumSlots = InReader->Header->NumSlots;
+	for (;;)
+	{
+		const int64_t NumWritten = LOAD_ACQUIRE(&InReader->Header->NumWritten);
+		const XimmerseSharedSample* Slot;
+		int64_t Expected, Before, After;
+
+		/* a writer that reopened the region starts counting from 0 again */
+		if (NumWritten < InReader->Cursor)
+		{
+			InReader->Cursor = NumWritten;
+		}
+		if (InReader->Cursor == NumWritten)
+		{
+			return 0;
+		}
+		if (NumWritten - InReader->Cursor > NumSlots)
+		{
+			InReader->NumLost += NumWritten - NumSlots - InReader->Cursor;
+			InReader->Cursor = NumWritten - NumSlots;
+		}
+
+		Slot = &InReader->Samples[InReader->Cursor & (NumSlots - 1)];
+		Expected = 2 * InReader->Cursor + 2;
+		Before = LOAD_ACQUIRE(&Slot->Sequence);
+		if (Before == Expected)
+		{
+			memcpy(OutSample, (const void*)Slot, sizeof(*OutSample));
+			FENCE_ACQUIRE();
+			After = Slot->Sequence;
+			if (After == Expected)
+			{
+				++InReader->Cursor;
+				++InReader->NumRead;
+				return 1;
+			}
+		}
+
+		/* overwritten while or before it was copied */
+		++InReader->NumLost;
+		++InReader->Cursor;
+	}
+}
+
+static void PrintSample(const XimmerseSharedSample* Sample, double StartTime, int bCsv)
+{
+	if (bCsv)
+	{
+		printf("%.6f,%d,%d,%d,0x%05x,%.3f,%.3f,%.3f,%.5f,%.5f,%.5f,%.5f,%.4f,%.4f\n",
+			Sample->SampleTime - StartTime, Sample->DeviceIndex, Sample->Timestamp, Sample->TrackingResult, Sample->Buttons,
+			Sample->Position[0], Sample->Position[1], Sample->Position[2],
+			Sample->Orientation[0], Sample->Orientation[1], Sample->Orientation[2], Sample->Orientation[3],
+			Sample->Axes[0], Sample->Axes[1]);
+	}
+	else
+	{
+		printf("%12.6f  device %-2d ts=%d result=%d buttons=0x%05x pos=(%.1f, %.1f, %.1f) rot=(%.4f, %.4f, %.4f, %.4f) trigger=%.3f\n",
+			Sample->SampleTime - StartTime, Sample->DeviceIndex, Sample->Timestamp, Sample->TrackingResult, Sample->Buttons,
+			Sample->Position[0], Sample->Position[1], Sample->Position[2],
+			Sample->Orientation[0], Sample->Orientation[1], Sample->Orientation[2], Sample->Orientation[3],
+			Sample->Axes[0]);
+	}
+}
+
+static void SleepMilliseconds(int Milliseconds)
+{
+#if defined(_WIN32)
+	Sleep(Milliseconds);
+#else
+	usleep(Milliseconds * 1000);
+#endif
+}
+
+static int Follow(const char* Name, int bCsv)
+{
+	size_t Size = 0;
+	void* Address = NULL;
+	Reader SampleReader;
+	XimmerseSharedSample Sample;
+
+	fprintf(stderr, "Waiting for the Ximmerse input plugin to publish into %s\n", Name);
+	while ((Address = MapRegion(Name, &Size)) == NULL || !OpenReader(&SampleReader, Address, Size))
+	{
+		SleepMilliseconds(100);
+	}
+	fprintf(stderr, "Following %s, %u slots, written by process %u\n", Name, SampleReader.Header->NumSlots, SampleReader.Header->WriterProcessId);
+
+	if (bCsv)
+	{
+		printf("time,device,timestamp,result,buttons,x,y,z,qx,qy,qz,qw,axis0,axis1\n");
+	}
+
+	for (;;)
+	{
+		const int64_t NumLost = SampleReader.NumLost;
+		while (ReadNext(&SampleReader, &Sample))
+		{
+			PrintSample(&Sample, SampleReader.Header->StartTime, bCsv);
+		}
+		if (SampleReader.NumLost != NumLost)
+		{
+			fprintf(stderr, "%lld samples lost, the output could not keep up\n", (long long)(SampleReader.NumLost - NumLost));
+		}
+		fflush(stdout);
+
+		/* the plugin clears the magic when it stops publishing, after its last sample */
+		if (LOAD_ACQUIRE(&SampleReader.Header->Magic) != XIMMERSE_SHARED_MEMORY_MAGIC)
+		{
+			while (ReadNext(&SampleReader, &Sample))
+			{
+				PrintSample(&Sample, SampleReader.Header->StartTime, bCsv);
+			}
+			fprintf(stderr, "The writer closed %s\n", Name);
+			return 0;
+		}
+		SleepMilliseconds(1);
+	}
+}
+
+#if defined(_WIN32)
+
+static int SelfTest(int64_t NumSamples)
+{
+	(void)NumSamples;
+	fprintf(stderr, "The self test runs on POSIX systems only\n");
+	return 1;
+}
+
+#else
+
+/* Creates and initializes the region like FXimmerseSharedMemoryPublisher::Open */
+static XimmerseSharedMemoryHeader* CreateRegion(const char* Name)
+{
+	const size_t Size = sizeof(XimmerseSharedMemoryHeader) + SELFTEST_SLOTS * sizeof(XimmerseSharedSample);
+	XimmerseSharedMemoryHeader* Header;
+	char Path[256];
+	int Fd;
+
+	snprintf(Path, sizeof(Path), "/%s", Name);
+	Fd = shm_open(Path, O_CREAT | O_RDWR, 0666);
+	if (Fd < 0 || ftruncate(Fd, (off_t)Size) != 0)
+	{
+		perror("shm_open");
+		exit(1);
+	}
+	Header = (XimmerseSharedMemoryHeader*)mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+	close(Fd);
+	if (Header == MAP_FAILED)
+	{
+		perror("mmap");
+		exit(1);
+	}
+
+	memset(Header, 0, Size);
+	Header->Version = XIMMERSE_SHARED_MEMORY_VERSION;
+	Header->HeaderSize = sizeof(XimmerseSharedMemoryHeader);
+	Header->SampleSize = sizeof(XimmerseSharedSample);
+	Header->NumSlots = SELFTEST_SLOTS;
+	Header->WriterProcessId = (uint32_t)getpid();
+	Header->StartTime = NowSeconds();
+	__atomic_store_n(&Header->Magic, XIMMERSE_SHARED_MEMORY_MAGIC, __ATOMIC_SEQ_CST);
+	return Header;
+}
+
+/* Publishes NumSamples samples like FXimmerseSharedMemoryPublisher::Publish, Rate per second or as fast as possible if 0 */
+static void RunWriter(const char* Name, int64_t NumSamples, double Rate)
+{
+	XimmerseSharedMemoryHeader* Header = CreateRegion(Name);
+	XimmerseSharedSample* Samples = (XimmerseSharedSample*)(Header + 1);
+	double StartTime;
+	int64_t NumWritten;
+
+	/* give the reader time to attach before the ring laps */
+	usleep(200 * 1000);
+	StartTime = NowSeconds();
+
+	for (NumWritten = 0; NumWritten < NumSamples; ++NumWritten)
+	{
+		XimmerseSharedSample* Sample = &Samples[NumWritten & (SELFTEST_SLOTS - 1)];
+
+		if (Rate > 0.0)
+		{
+			const double DueTime = StartTime + NumWritten / Rate;
+			while (NowSeconds() < DueTime)
+			{
+				sched_yield();
+			}
+		}
+
+		EXCHANGE(&Sample->Sequence, 2 * NumWritten + 1);
+		Sample->SampleTime = NowSeconds();
+		Sample->DeviceTime = 0.0;
+		Sample->DeviceIndex = (int32_t)(NumWritten & 1);
+		Sample->Timestamp = (int32_t)NumWritten;
+		Sample->TrackingResult = 3;
+		Sample->Buttons = (uint32_t)NumWritten;
+		Sample->Position[0] = (float)NumWritten;
+		Sample->Orientation[3] = 1.0f;
+		Sample->WriteTime = NowSeconds();
+		EXCHANGE(&Sample->Sequence, 2 * NumWritten + 2);
+		EXCHANGE(&Header->NumWritten, NumWritten + 1);
+	}
+
+	__atomic_store_n(&Header->Magic, 0, __ATOMIC_SEQ_CST);
+}
+
+static int CompareDoubles(const void* A, const void* B)
+{
+	const double Left = *(const double*)A;
+	const double Right = *(const double*)B;
+	return (Left > Right) - (Left < Right);
+}
+
+/* Runs a writer process and reads it from this one, reports what arrived and how late */
+static int RunPair(const char* Label, int64_t NumSamples, double Rate)
+{
+	char Name[64];
+	char Path[80];
+	double* Latencies = (double*)malloc((size_t)NumSamples * sizeof(double));
+	int64_t NumCorrupt = 0;
+	size_t Size = 0;
+	void* Address = NULL;
+	double FirstTime = 0.0, LastTime = 0.0;
+	XimmerseSharedSample First, Last;
+	Reader SampleReader;
+	XimmerseSharedSample Sample;
+	int Status = 0;
+	pid_t Writer;
+
+	snprintf(Name, sizeof(Name), "XimmerseSelfTest-%d", (int)getpid());
+	snprintf(Path, sizeof(Path), "/%s", Name);
+	shm_unlink(Path);
+
+	Writer = fork();
+	if (Writer < 0)
+	{
+		perror("fork");
+		return 1;
+	}
+	if (Writer == 0)
+	{
+		RunWriter(Name, NumSamples, Rate);
+		_exit(0);
+	}
+
+	while ((Address = MapRegion(Name, &Size)) == NULL || !OpenReader(&SampleReader, Address, Size))
+	{
+		if (Address != NULL)
+		{
+			munmap(Address, Size);
+			Address = NULL;
+		}
+		sched_yield();
+	}
+
+	/* read from the first sample on, samples published before we attached are still in the ring or counted as lost */
+	SampleReader.Cursor = 0;
+
+	while (SampleReader.NumRead + SampleReader.NumLost < NumSamples)
+	{
+		if (!ReadNext(&SampleReader, &Sample))
+		{
+			if (waitpid(Writer, &Status, WNOHANG) == Writer && LOAD_ACQUIRE(&SampleReader.Header->NumWritten) == SampleReader.Cursor)
+			{
+				Writer = 0;
+				break;
+			}
+			continue;
+		}
+
+		LastTime = NowSeconds();
+		if (SampleReader.NumRead == 1)
+		{
+			FirstTime = LastTime;
+			First = Sample;
+		}
+		Last = Sample;
+		Latencies[SampleReader.NumRead - 1] = LastTime - Sample.WriteTime;
+		NumCorrupt += (Sample.Timestamp != (int32_t)(SampleReader.Cursor - 1) || Sample.Position[0] != (float)(SampleReader.Cursor - 1)) ? 1 : 0;
+	}
+	if (Writer != 0)
+	{
+		waitpid(Writer, &Status, 0);
+	}
+
+	qsort(Latencies, (size_t)SampleReader.NumRead, sizeof(double), CompareDoubles);
+	if (SampleReader.NumRead > 0)
+	{
+		const int64_t Count = SampleReader.NumRead;
+		printf("%-8s %lld samples read, %lld lost, %lld corrupt, written at %.0f/s, read at %.0f/s, latency p50 %.2f us p99 %.2f us p99.9 %.2f us max %.2f us\n",
+			Label, (long long)Count, (long long)SampleReader.NumLost, (long long)NumCorrupt,
+			(Last.WriteTime > First.WriteTime) ? (Last.Timestamp - First.Timestamp) / (Last.WriteTime - First.WriteTime) : 0.0,
+			(LastTime > FirstTime) ? (Count - 1) / (LastTime - FirstTime) : 0.0,
+			Latencies[Count / 2] * 1e6, Latencies[Count * 99 / 100] * 1e6, Latencies[Count * 999 / 1000] * 1e6, Latencies[Count - 1] * 1e6);
+	}
+	else
+	{
+		printf("%-8s no samples read\n", Label);
+	}
+
+	munmap(Address, Size);
+	shm_unlink(Path);
+	free(Latencies);
+	return (SampleReader.NumRead > 0 && NumCorrupt == 0) ? 0 : 1;
+}
+
+static int SelfTest(int64_t NumSamples)
+{
+	int Result = RunPair("unpaced", NumSamples, 0.0);
+	Result |= RunPair("1kHz", SELFTEST_PACED_SAMPLES, SELFTEST_PACED_RATE);
+	return Result;
+}
+
+#endif
+
+int main(int argc, char** argv)
+{
+	const char* Name = XIMMERSE_SHARED_MEMORY_NAME;
+	int bCsv = 0;
+	int Arg;
+
+	if (argc > 1 && strcmp(argv[1], "--selftest") == 0)
+	{
+		return SelfTest((argc > 2) ? atoll(argv[2]) : SELFTEST_DEFAULT_SAMPLES);
+	}
+
+	for (Arg = 1; Arg < argc; ++Arg)
+	{
+		if (strcmp(argv[Arg], "--csv") == 0)
+		{
+			bCsv = 1;
+		}
+		else if (argv[Arg][0] == '-')
+		{
+			fprintf(stderr, "Usage: %s [name] [--csv]\n       %s --selftest [samples]\n", argv[0], argv[0]);
+			return 1;
+		}
+		else
+		{
+			Name = argv[Arg];
+		}
+	}
+
+	return Follow(Name, bCsv);
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+"""Decodes a Ximmerse input trace written by the ximmerse.TraceDump console command.
+
+Usage: decode_trace.py XimmerseTrace.bin [--csv]
+
+The record layout mirrors FXimmerseTraceRecord in Source/XimmerseInput/Private/XimmerseTrace.h.
+"""
+import struct
+import sys
+
+MAGIC = 0x43525458
+VERSION = 1
+HEADER = struct.Struct('<IIIId')
+RECORD = struct.Struct('<QHHI48s')
+
+SAMPLE = struct.Struct('<iIf3f4f')
+TRACKING = struct.Struct('<i3f3f')
+EVENTS = struct.Struct('<iiii')
+TIMING = struct.Struct('<Qi')
+
+TYPES = ('Sample', 'Tracking', 'Events', 'Timing')
+
+
+def decode_payload(record_type, payload, seconds_per_cycle):
+    if record_type == 0:
+        v = SAMPLE.unpack_from(payload)
+        return 'ts=%d buttons=0x%05x trigger=%.3f pos=(%.4f, %.4f, %.4f) rot=(%.4f, %.4f, %.4f, %.4f)' % v
+    if record_type == 1:
+        v = TRACKING.unpack_from(payload)
+        return 'result=%d pos=(%.1f, %.1f, %.1f) rot=(P=%.1f, Y=%.1f, R=%.1f)' % v
+    if record_type == 2:
+        v = EVENTS.unpack_from(payload)
+        return 'ts=%d pressed=%d released=%d analog=%d' % v
+    if record_type == 3:
+        cycles, samples = TIMING.unpack_from(payload)
+        return 'time=%.1fus samples=%d' % (cycles * seconds_per_cycle * 1e6, samples)
+    return 'unknown record type %d' % record_type
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write(__doc__)
+        return 1
+
+    csv = '--csv' in argv[2:]
+    with open(argv[1], 'rb') as f:
+        data = f.read()
+
+    magic, version, record_size, num_records, seconds_per_cycle = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION or record_size != RECORD.size:
+        sys.stderr.write('%s is not a version %d Ximmerse trace\n' % (argv[1], VERSION))
+        return 1
+
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(num_records)]
+    records.sort(key=lambda r: r[0])
+    if not records:
+        return 0
+
+    first_cycles = records[0][0]
+    for cycles, record_type, device, thread, payload in records:
+        seconds = (cycles - first_cycles) * seconds_per_cycle
+        device = -1 if device == 0xffff else device
+        name = TYPES[record_type] if record_type < len(TYPES) else str(record_type)
+        text = decode_payload(record_type, payload, seconds_per_cycle)
+        if csv:
+            print('%.6f,%d,%d,%s,"%s"' % (seconds, thread, device, name, text))
+        else:
+            print('%12.6f  thread %-6d device %-2d %-8s %s' % (seconds, thread, device, name, text))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))